@@ -24,6 +24,7 @@
 
 #include "config.h"
 
+#include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -46,6 +47,7 @@
 #include "shared/cairo-util.h"
 #include "shared/config-parser.h"
 #include "shared/helpers.h"
+#include "shared/image-loader.h"
 #include "shared/xalloc.h"
 #include "shared/zalloc.h"
 
@@ -100,6 +102,15 @@ struct background {
 	char *image;
 	int type;
 	uint32_t color;
+
+	/* The image is decoded on a worker thread, for the size it is
+	 * drawn at, and kept until that size changes. */
+	struct image_load *image_load;
+	struct task image_task;
+	int load_width, load_height;
+	cairo_surface_t *image_surface;
+	int image_width, image_height;
+	bool image_loaded;
 };
 
 struct output {
@@ -696,11 +707,77 @@ enum {
 	BACKGROUND_TILE
 };
 
+static void
+background_image_loaded(struct task *task, uint32_t events)
+{
+	struct background *background =
+		container_of(task, struct background, image_task);
+	struct display *display = window_get_display(background->window);
+
+	display_unwatch_fd(display, image_load_get_fd(background->image_load));
+
+	if (background->image_surface)
+		cairo_surface_destroy(background->image_surface);
+
+	background->image_surface =
+		load_cairo_surface_finish(background->image_load);
+	background->image_load = NULL;
+	background->image_width = background->load_width;
+	background->image_height = background->load_height;
+	background->image_loaded = true;
+
+	widget_schedule_redraw(background->widget);
+}
+
+/* Returns the image to draw at width x height buffer pixels, or NULL if
+ * it failed to load. While it is being decoded, sets *pending and
+ * returns the image decoded for the previous size, if any; the
+ * background is redrawn once the new image arrives. */
+static cairo_surface_t *
+background_get_image(struct background *background, const char *filename,
+		     int width, int height, bool *pending)
+{
+	struct display *display = window_get_display(background->window);
+
+	/* Tiles are drawn at their own size. */
+	if (background->type == BACKGROUND_TILE)
+		width = height = 0;
+
+	*pending = false;
+	if (background->image_loaded &&
+	    background->image_width == width &&
+	    background->image_height == height)
+		return background->image_surface;
+
+	if (!background->image_load) {
+		background->image_load =
+			image_load_start(filename, width, height);
+		if (!background->image_load)
+			return NULL;
+
+		background->load_width = width;
+		background->load_height = height;
+		background->image_task.run = background_image_loaded;
+		display_watch_fd(display,
+				 image_load_get_fd(background->image_load),
+				 EPOLLIN, &background->image_task);
+	}
+
+	*pending = true;
+
+	if (background->image_loaded)
+		return background->image_surface;
+
+	return NULL;
+}
+
 static void
 background_draw(struct widget *widget, void *data)
 {
 	struct background *background = data;
 	cairo_surface_t *surface, *image;
+	const char *filename = NULL;
+	bool pending = false;
 	cairo_pattern_t *pattern;
 	cairo_matrix_t matrix;
 	cairo_t *cr;
@@ -708,6 +785,7 @@ background_draw(struct widget *widget, void *data)
 	double sx, sy, s;
 	double tx, ty;
 	struct rectangle allocation;
+	int32_t scale;
 
 	surface = window_get_surface(background->window);
 
@@ -719,11 +797,20 @@ background_draw(struct widget *widget, void *data)
 	widget_get_allocation(widget, &allocation);
 	image = NULL;
 	if (background->image)
-		image = load_cairo_surface(background->image);
+		filename = background->image;
 	else if (background->color == 0)
-		image = load_cairo_surface(DATADIR "/weston/pattern.png");
-
-	if (image && background->type != -1) {
+		filename = DATADIR "/weston/pattern.png";
+
+	/* Decode for the buffer, not the logical size, so the image stays
+	 * sharp on scaled outputs. */
+	scale = window_get_buffer_scale(background->window);
+	if (filename && background->type != -1)
+		image = background_get_image(background, filename,
+					     allocation.width * scale,
+					     allocation.height * scale,
+					     &pending);
+
+	if (image) {
 		im_w = cairo_image_surface_get_width(image);
 		im_h = cairo_image_surface_get_height(image);
 		sx = im_w / allocation.width;
@@ -754,8 +841,7 @@ background_draw(struct widget *widget, void *data)
 
 		cairo_set_source(cr, pattern);
 		cairo_pattern_destroy (pattern);
-		cairo_surface_destroy(image);
-	} else {
+	} else if (!pending) {
 		set_hex_color(cr, background->color);
 	}
 
@@ -763,6 +849,10 @@ background_draw(struct widget *widget, void *data)
 	cairo_destroy(cr);
 	cairo_surface_destroy(surface);
 
+	/* Hold the desktop back until the image is there. */
+	if (pending)
+		return;
+
 	background->painted = 1;
 	check_desktop_ready(background->window);
 }
@@ -1041,6 +1131,17 @@ static const struct weston_desktop_shell_listener listener = {
 static void
 background_destroy(struct background *background)
 {
+	struct display *display = window_get_display(background->window);
+
+	if (background->image_load) {
+		display_unwatch_fd(display,
+				   image_load_get_fd(background->image_load));
+		cairo_surface_destroy(
+			load_cairo_surface_finish(background->image_load));
+	}
+	if (background->image_surface)
+		cairo_surface_destroy(background->image_surface);
+
 	widget_destroy(background->widget);
 	window_destroy(background->window);
 
@@ -33,11 +33,17 @@
 #include <sys/mman.h>
 #include <signal.h>
 
+#ifdef HAVE_LIBDRM
+#include <drm_fourcc.h>
+#endif
+
 #include <wayland-client.h>
+#include "shared/helpers.h"
 #include "shared/os-compatibility.h"
 #include "shared/zalloc.h"
 #include "xdg-shell-unstable-v5-client-protocol.h"
 #include "fullscreen-shell-unstable-v1-client-protocol.h"
+#include "linux-dmabuf-unstable-v1-client-protocol.h"
 
 #include <sys/types.h>
 #include "ivi-application-client-protocol.h"
@@ -51,13 +57,18 @@ struct display {
 	struct zwp_fullscreen_shell_v1 *fshell;
 	struct wl_shm *shm;
 	bool has_xrgb;
+	struct zwp_linux_dmabuf_v1 *dmabuf;
+	bool has_dmabuf_xrgb;
 	struct ivi_application *ivi_application;
 };
 
 struct buffer {
+	struct window *window;
 	struct wl_buffer *buffer;
 	void *shm_data;
+	int shm_size;
 	int busy;
+	struct zwp_linux_buffer_params_v1 *params;
 };
 
 struct window {
@@ -69,6 +80,7 @@ struct window {
 	struct buffer buffers[2];
 	struct buffer *prev_buffer;
 	struct wl_callback *callback;
+	bool wait_for_buffer;
 };
 
 static int running = 1;
@@ -85,16 +97,102 @@ static const struct wl_buffer_listener buffer_listener = {
 	buffer_release
 };
 
+static void
+redraw(void *data, struct wl_callback *callback, uint32_t time);
+
+#ifdef HAVE_LIBDRM
+static void
+create_succeeded(void *data,
+		 struct zwp_linux_buffer_params_v1 *params,
+		 struct wl_buffer *new_buffer)
+{
+	struct buffer *buffer = data;
+	struct window *window = buffer->window;
+
+	zwp_linux_buffer_params_v1_destroy(params);
+	buffer->params = NULL;
+	buffer->buffer = new_buffer;
+	wl_buffer_add_listener(buffer->buffer, &buffer_listener, buffer);
+
+	if (window->wait_for_buffer)
+		redraw(window, NULL, 0);
+}
+
+static void
+create_failed(void *data, struct zwp_linux_buffer_params_v1 *params)
+{
+	struct buffer *buffer = data;
+	struct window *window = buffer->window;
+
+	zwp_linux_buffer_params_v1_destroy(params);
+	buffer->params = NULL;
+
+	/* Do not try again if the compositor could not import it, the
+	 * buffer is made again through wl_shm on the next redraw. */
+	window->display->has_dmabuf_xrgb = false;
+	munmap(buffer->shm_data, buffer->shm_size);
+	buffer->shm_data = NULL;
+
+	if (window->wait_for_buffer)
+		redraw(window, NULL, 0);
+}
+
+static const struct zwp_linux_buffer_params_v1_listener params_listener = {
+	create_succeeded,
+	create_failed
+};
+
+/* Hands the compositor the same memory as a dma-buf made by udmabuf, so
+ * that a GL compositor can texture from it directly instead of copying
+ * every frame. The answer comes back asynchronously, buffer->params is
+ * set until then. Returns false if the compositor or the kernel can not
+ * do it, and the buffer is then shared through wl_shm as usual.
+ */
+static bool
+create_udmabuf_buffer(struct display *display, struct buffer *buffer,
+		      int fd, int size, int width, int height, int stride)
+{
+	int dmabuf;
+
+	if (!display->dmabuf || !display->has_dmabuf_xrgb)
+		return false;
+
+	dmabuf = os_create_udmabuf(fd, 0, size);
+	if (dmabuf < 0)
+		return false;
+
+	buffer->params = zwp_linux_dmabuf_v1_create_params(display->dmabuf);
+	zwp_linux_buffer_params_v1_add(buffer->params, dmabuf, 0, 0, stride,
+				       0, 0);
+	zwp_linux_buffer_params_v1_add_listener(buffer->params,
+						&params_listener, buffer);
+	zwp_linux_buffer_params_v1_create(buffer->params, width, height,
+					  DRM_FORMAT_XRGB8888, 0);
+	close(dmabuf);
+
+	return true;
+}
+#else
+static bool
+create_udmabuf_buffer(struct display *display, struct buffer *buffer,
+		      int fd, int size, int width, int height, int stride)
+{
+	return false;
+}
+#endif
+
 static int
 create_shm_buffer(struct display *display, struct buffer *buffer,
 		  int width, int height, uint32_t format)
 {
 	struct wl_shm_pool *pool;
+	long page_size = sysconf(_SC_PAGESIZE);
 	int fd, size, stride;
 	void *data;
 
 	stride = width * 4;
-	size = stride * height;
+	/* udmabuf can only wrap whole pages */
+	size = (stride * height + page_size - 1) & ~(page_size - 1);
 
 	fd = os_create_anonymous_file(size);
 	if (fd < 0) {
@@ -110,15 +208,21 @@ create_shm_buffer(struct display *display, struct buffer *buffer,
 		return -1;
 	}
 
-	pool = wl_shm_create_pool(display->shm, fd, size);
-	buffer->buffer = wl_shm_pool_create_buffer(pool, 0,
-						   width, height,
-						   stride, format);
-	wl_buffer_add_listener(buffer->buffer, &buffer_listener, buffer);
-	wl_shm_pool_destroy(pool);
-	close(fd);
-
 	buffer->shm_data = data;
+	buffer->shm_size = size;
+
+	if (format != WL_SHM_FORMAT_XRGB8888 ||
+	    !create_udmabuf_buffer(display, buffer, fd, size,
+				   width, height, stride)) {
+		pool = wl_shm_create_pool(display->shm, fd, size);
+		buffer->buffer = wl_shm_pool_create_buffer(pool, 0,
+							   width, height,
+							   stride, format);
+		wl_buffer_add_listener(buffer->buffer, &buffer_listener,
+				       buffer);
+		wl_shm_pool_destroy(pool);
+	}
+	close(fd);
 
 	return 0;
 }
@@ -164,6 +268,8 @@ create_window(struct display *display, int width, int height)
 
 	window->callback = NULL;
 	window->display = display;
+	window->buffers[0].window = window;
+	window->buffers[1].window = window;
 	window->width = width;
 	window->height = height;
 	window->surface = wl_compositor_create_surface(display->compositor);
@@ -208,13 +314,19 @@ create_window(struct display *display, int width, int height)
 static void
 destroy_window(struct window *window)
 {
+	struct buffer *buffer;
+	unsigned int i;
+
 	if (window->callback)
 		wl_callback_destroy(window->callback);
 
-	if (window->buffers[0].buffer)
-		wl_buffer_destroy(window->buffers[0].buffer);
-	if (window->buffers[1].buffer)
-		wl_buffer_destroy(window->buffers[1].buffer);
+	for (i = 0; i < ARRAY_LENGTH(window->buffers); i++) {
+		buffer = &window->buffers[i];
+		if (buffer->params)
+			zwp_linux_buffer_params_v1_destroy(buffer->params);
+		if (buffer->buffer)
+			wl_buffer_destroy(buffer->buffer);
+	}
 
 	if (window->xdg_surface)
 		xdg_surface_destroy(window->xdg_surface);
@@ -235,7 +347,7 @@ window_next_buffer(struct window *window)
 	else
 		return NULL;
 
-	if (!buffer->buffer) {
+	if (!buffer->buffer && !buffer->params) {
 		ret = create_shm_buffer(window->display, buffer,
 					window->width, window->height,
 					WL_SHM_FORMAT_XRGB8888);
@@ -313,15 +425,21 @@ redraw(void *data, struct wl_callback *callback, uint32_t time)
 		abort();
 	}
 
+	if (callback)
+		wl_callback_destroy(callback);
+	window->callback = NULL;
+
+	/* Redrawn again once the compositor has answered. */
+	window->wait_for_buffer = buffer->params != NULL;
+	if (window->wait_for_buffer)
+		return;
+
 	paint_pixels(buffer->shm_data, 20, window->width, window->height, time);
 
 	wl_surface_attach(window->surface, buffer->buffer, 0, 0);
 	wl_surface_damage(window->surface,
 			  20, 20, window->width - 40, window->height - 40);
 
-	if (callback)
-		wl_callback_destroy(callback);
-
 	window->callback = wl_surface_frame(window->surface);
 	wl_callback_add_listener(window->callback, &frame_listener, window);
 	wl_surface_commit(window->surface);
@@ -345,6 +463,22 @@ struct wl_shm_listener shm_listener = {
 	shm_format
 };
 
+#ifdef HAVE_LIBDRM
+static void
+dmabuf_format(void *data, struct zwp_linux_dmabuf_v1 *zwp_linux_dmabuf,
+	      uint32_t format)
+{
+	struct display *d = data;
+
+	if (format == DRM_FORMAT_XRGB8888)
+		d->has_dmabuf_xrgb = true;
+}
+
+static const struct zwp_linux_dmabuf_v1_listener dmabuf_listener = {
+	dmabuf_format
+};
+#endif
+
 static void
 xdg_shell_ping(void *data, struct xdg_shell *shell, uint32_t serial)
 {
@@ -383,6 +517,12 @@ registry_handle_global(void *data, struct wl_registry *registry,
 		d->shm = wl_registry_bind(registry,
 					  id, &wl_shm_interface, 1);
 		wl_shm_add_listener(d->shm, &shm_listener, d);
+#ifdef HAVE_LIBDRM
+	} else if (strcmp(interface, "zwp_linux_dmabuf_v1") == 0) {
+		d->dmabuf = wl_registry_bind(registry,
+					     id, &zwp_linux_dmabuf_v1_interface, 1);
+		zwp_linux_dmabuf_v1_add_listener(d->dmabuf, &dmabuf_listener, d);
+#endif
 	}
 	else if (strcmp(interface, "ivi_application") == 0) {
 		d->ivi_application =
@@ -416,6 +556,8 @@ create_display(void)
 	assert(display->display);
 
 	display->has_xrgb = false;
+	display->dmabuf = NULL;
+	display->has_dmabuf_xrgb = false;
 	display->registry = wl_display_get_registry(display->display);
 	wl_registry_add_listener(display->registry,
 				 &registry_listener, display);
@@ -481,6 +623,9 @@ destroy_display(struct display *display)
 	if (display->shm)
 		wl_shm_destroy(display->shm);
 
+	if (display->dmabuf)
+		zwp_linux_dmabuf_v1_destroy(display->dmabuf);
+
 	if (display->shell)
 		xdg_shell_destroy(display->shell);
 
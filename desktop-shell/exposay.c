@@ -26,6 +26,7 @@
 #include "config.h"
 
 #include <linux/input.h>
+#include <string.h>
 
 #include "shell.h"
 #include "shared/helpers.h"
@@ -59,9 +60,34 @@ static void exposay_set_state(struct desktop_shell *shell,
 			      struct weston_seat *seat);
 static void exposay_check_state(struct desktop_shell *shell);
 
+static struct exposay_surface **
+exposay_grid_slot(struct exposay_output *eoutput, int row, int column)
+{
+	struct exposay_surface **grid = eoutput->grid.data;
+	size_t index;
+
+	if (row < 0 || column < 0 ||
+	    row >= eoutput->grid_size || column >= eoutput->grid_size)
+		return NULL;
+
+	index = row * eoutput->grid_size + column;
+	if (index >= eoutput->grid.size / sizeof *grid)
+		return NULL;
+
+	return &grid[index];
+}
+
 static void
 exposay_surface_destroy(struct exposay_surface *esurface)
 {
+	struct exposay_surface **slot = NULL;
+
+	if (esurface->eoutput)
+		slot = exposay_grid_slot(esurface->eoutput,
+					 esurface->row, esurface->column);
+	if (slot && *slot == esurface)
+		*slot = NULL;
+
 	wl_list_remove(&esurface->link);
 	wl_list_remove(&esurface->view_destroy_listener.link);
 
@@ -176,18 +202,58 @@ exposay_is_animating(struct desktop_shell *shell)
 	return (shell->exposay.in_flight > 0);
 }
 
+/* Finds the grid cell under x, y with the inverse of the placement maths
+ * in exposay_layout(), rather than testing every surface. */
+static struct exposay_surface *
+exposay_output_pick(struct shell_output *shell_output, int x, int y)
+{
+	struct exposay_output *eoutput = &shell_output->eoutput;
+	struct weston_output *output = shell_output->output;
+	struct exposay_surface **slot;
+	struct exposay_surface *esurface;
+	int pad = eoutput->surface_size + eoutput->padding_inner;
+	int row, column;
+
+	if (eoutput->grid_size == 0 || pad <= 0)
+		return NULL;
+
+	x -= output->x + eoutput->hpadding_outer;
+	y -= output->y + eoutput->vpadding_outer;
+	if (y < 0)
+		return NULL;
+
+	row = y / pad;
+	if (row == eoutput->grid_size - 1)
+		x -= eoutput->last_row_offset;
+	if (x < 0)
+		return NULL;
+
+	column = x / pad;
+	slot = exposay_grid_slot(eoutput, row, column);
+	if (!slot || !*slot)
+		return NULL;
+
+	/* the cell is the full surface_size, the thumbnail may be smaller */
+	esurface = *slot;
+	if (x - column * pad > esurface->width ||
+	    y - row * pad > esurface->height)
+		return NULL;
+
+	return esurface;
+}
+
 static void
 exposay_pick(struct desktop_shell *shell, int x, int y)
 {
+	struct shell_output *shell_output;
 	struct exposay_surface *esurface;
 
         if (exposay_is_animating(shell))
             return;
 
-	wl_list_for_each(esurface, &shell->exposay.surface_list, link) {
-		if (x < esurface->x || x > esurface->x + esurface->width)
-			continue;
-		if (y < esurface->y || y > esurface->y + esurface->height)
+	wl_list_for_each(shell_output, &shell->output_list, link) {
+		esurface = exposay_output_pick(shell_output, x, y);
+		if (!esurface)
 			continue;
 
 		exposay_highlight_surface(shell, esurface);
@@ -216,6 +282,7 @@ exposay_layout(struct desktop_shell *shell, struct shell_output *shell_output)
 	struct exposay_output *eoutput = &shell_output->eoutput;
 	struct weston_view *view;
 	struct exposay_surface *esurface, *highlight = NULL;
+	struct exposay_surface **grid;
 	int w, h;
 	int i;
 	int last_row_removed = 0;
@@ -229,12 +296,15 @@ exposay_layout(struct desktop_shell *shell, struct shell_output *shell_output)
 		eoutput->num_surfaces++;
 	}
 
+	eoutput->grid.size = 0;
+
 	if (eoutput->num_surfaces == 0) {
 		eoutput->grid_size = 0;
 		eoutput->hpadding_outer = 0;
 		eoutput->vpadding_outer = 0;
 		eoutput->padding_inner = 0;
 		eoutput->surface_size = 0;
+		eoutput->last_row_offset = 0;
 		return EXPOSAY_LAYOUT_OVERVIEW;
 	}
 
@@ -273,6 +343,20 @@ exposay_layout(struct desktop_shell *shell, struct shell_output *shell_output)
 	if (eoutput->surface_size > (output->height / 2))
 		eoutput->surface_size = output->height / 2;
 
+	eoutput->last_row_offset =
+		(eoutput->surface_size + eoutput->padding_inner) * last_row_removed / 2;
+
+	/* The grid array keeps its allocation between activations. */
+	grid = wl_array_add(&eoutput->grid,
+			    eoutput->num_surfaces * sizeof *grid);
+	if (!grid) {
+		eoutput->grid_size = 0;
+		exposay_set_state(shell, EXPOSAY_TARGET_CANCEL,
+		                  shell->exposay.seat);
+		return EXPOSAY_LAYOUT_OVERVIEW;
+	}
+	memset(grid, 0, eoutput->num_surfaces * sizeof *grid);
+
 	i = 0;
 	wl_list_for_each(view, &workspace->layer.view_list.link, layer_link.link) {
 		int pad;
@@ -305,7 +389,8 @@ exposay_layout(struct desktop_shell *shell, struct shell_output *shell_output)
 		esurface->y += pad * esurface->row;
 
 		if (esurface->row == eoutput->grid_size - 1)
-			esurface->x += (eoutput->surface_size + eoutput->padding_inner) * last_row_removed / 2;
+			esurface->x += eoutput->last_row_offset;
+		grid[i] = esurface;
 
 		if (view->surface->width > view->surface->height)
 			esurface->scale = eoutput->surface_size / (float) view->surface->width;
@@ -423,18 +508,17 @@ static const struct weston_pointer_grab_interface exposay_ptr_grab = {
 static int
 exposay_maybe_move(struct desktop_shell *shell, int row, int column)
 {
-	struct exposay_surface *esurface;
+	struct exposay_surface **slot;
 
-	wl_list_for_each(esurface, &shell->exposay.surface_list, link) {
-		if (esurface->eoutput != shell->exposay.cur_output ||
-		    esurface->row != row || esurface->column != column)
-			continue;
+	if (!shell->exposay.cur_output)
+		return 0;
 
-		exposay_highlight_surface(shell, esurface);
-		return 1;
-	}
+	slot = exposay_grid_slot(shell->exposay.cur_output, row, column);
+	if (!slot || !*slot)
+		return 0;
 
-	return 0;
+	exposay_highlight_surface(shell, *slot);
+	return 1;
 }
 
 static void
@@ -465,6 +549,7 @@ exposay_key(struct weston_keyboard_grab *grab, uint32_t time, uint32_t key,
 		 * has fewer items than all the others. */
 		if (!exposay_maybe_move(shell, shell->exposay.row_current + 1,
 		                        shell->exposay.column_current) &&
+		    shell->exposay.cur_output &&
 		    shell->exposay.row_current < (shell->exposay.cur_output->grid_size - 1)) {
 			exposay_maybe_move(shell, shell->exposay.row_current + 1,
 					   (shell->exposay.cur_output->num_surfaces %
@@ -687,3 +772,25 @@ exposay_binding(struct weston_keyboard *keyboard, enum weston_keyboard_modifier
 
 	exposay_set_state(shell, EXPOSAY_TARGET_OVERVIEW, keyboard->seat);
 }
+
+/* Called before shell_output is freed: esurfaces on that output stay
+ * alive until their view goes away, so they must not reach its grid. */
+void
+exposay_output_destroy(struct desktop_shell *shell,
+		       struct shell_output *shell_output)
+{
+	struct exposay_output *eoutput = &shell_output->eoutput;
+	struct exposay_surface *esurface;
+
+	if (shell->exposay.state_cur != EXPOSAY_LAYOUT_INACTIVE) {
+		wl_list_for_each(esurface, &shell->exposay.surface_list, link) {
+			if (esurface->eoutput == eoutput)
+				esurface->eoutput = NULL;
+		}
+	}
+
+	if (shell->exposay.cur_output == eoutput)
+		shell->exposay.cur_output = NULL;
+
+	wl_array_release(&eoutput->grid);
+}
@@ -1143,9 +1143,15 @@ view_translate(struct workspace *ws, struct weston_view *view, double d)
 		transform = &shsurf->workspace_transform;
 	}
 
+	/* Whole pixels keep the view on the compositor's cheap translation
+	 * path, and frames that don't move it cost nothing. */
+	d = round(d);
+
 	if (wl_list_empty(&transform->link))
 		wl_list_insert(view->geometry.transformation_list.prev,
 			       &transform->link);
+	else if (transform->matrix.d[13] == d)
+		return;
 
 	weston_matrix_init(&transform->matrix);
 	weston_matrix_translate(&transform->matrix,
@@ -6375,6 +6381,7 @@ handle_output_destroy(struct wl_listener *listener, void *data)
 	struct desktop_shell *shell = output_listener->shell;
 
 	shell_for_each_layer(shell, shell_output_destroy_move_layer, output);
+	exposay_output_destroy(shell, output_listener);
 
 	wl_list_remove(&output_listener->destroy_listener.link);
 	wl_list_remove(&output_listener->link);
@@ -6483,6 +6490,7 @@ shell_destroy(struct wl_listener *listener, void *data)
 	wl_list_for_each_safe(shell_output, tmp, &shell->output_list, link) {
 		wl_list_remove(&shell_output->destroy_listener.link);
 		wl_list_remove(&shell_output->link);
+		wl_array_release(&shell_output->eoutput.grid);
 		free(shell_output);
 	}
 
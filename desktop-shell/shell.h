@@ -64,6 +64,11 @@ struct exposay_output {
 	int hpadding_outer;
 	int vpadding_outer;
 	int padding_inner;
+	/* the partial bottom row is centred by this many pixels */
+	int last_row_offset;
+
+	/* struct exposay_surface *, indexed by row * grid_size + column */
+	struct wl_array grid;
 };
 
 struct exposay {
@@ -235,6 +240,9 @@ void
 exposay_binding(struct weston_keyboard *keyboard,
 		enum weston_keyboard_modifier modifier,
 		void *data);
+void
+exposay_output_destroy(struct desktop_shell *shell,
+		       struct shell_output *shell_output);
 int
 input_panel_setup(struct desktop_shell *shell);
 void
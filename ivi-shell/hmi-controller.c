@@ -125,6 +125,9 @@ struct hmi_controller {
 	struct wl_array                     ui_widgets;
 	int32_t                             is_initialized;
 
+	/* reused buffer for ivi_layout_surface queries */
+	struct wl_array                     surface_scratch;
+
 	struct weston_compositor           *compositor;
 	struct wl_listener                  destroy_listener;
 
@@ -164,6 +167,22 @@ mem_alloc(size_t size, char *file, int32_t line)
 
 #define MEM_ALLOC(s) mem_alloc((s),__FILE__,__LINE__)
 
+/*
+ * Returns the scratch buffer with room for at least count surfaces. The
+ * buffer only ever grows, so queries stop allocating once it is large
+ * enough for the busiest scene.
+ */
+static struct ivi_layout_surface **
+surface_scratch_reserve(struct hmi_controller *hmi_ctrl, int32_t count)
+{
+	struct wl_array *scratch = &hmi_ctrl->surface_scratch;
+	size_t size = count * sizeof(struct ivi_layout_surface *);
+
+	scratch->size = 0;
+	return fail_on_null(wl_array_add(scratch, size), size,
+			    __FILE__, __LINE__);
+}
+
 static int32_t
 is_surf_in_ui_widget(struct hmi_controller *hmi_ctrl,
 		     struct ivi_layout_surface *ivisurf)
@@ -200,9 +219,32 @@ compare_launcher_info(const void *lhs, const void *rhs)
 	return 0;
 }
 
+/**
+ * Fills two batch entries which make ivisurf visible at the given
+ * destination rectangle.
+ */
+static void
+show_surface_at(struct ivi_layout_surface_update *updates,
+		struct ivi_layout_surface *ivisurf,
+		int32_t x, int32_t y, int32_t width, int32_t height)
+{
+	updates[0].surface = ivisurf;
+	updates[0].property = IVI_LAYOUT_SURFACE_VISIBILITY;
+	updates[0].value.visibility = true;
+
+	updates[1].surface = ivisurf;
+	updates[1].property = IVI_LAYOUT_SURFACE_DESTINATION_RECTANGLE;
+	updates[1].value.rect.x = x;
+	updates[1].value.rect.y = y;
+	updates[1].value.rect.width = width;
+	updates[1].value.rect.height = height;
+}
+
 /**
  * Internal methods called by mainly ivi_hmi_controller_switch_mode
  * This reference shows 4 examples how to use ivi_layout APIs.
+ * pp_surface holds the application ivi_surfaces only, ui widgets are
+ * filtered out by get_application_surfaces.
  */
 static void
 mode_divided_into_tiling(struct hmi_controller *hmi_ctrl,
@@ -216,39 +258,25 @@ mode_divided_into_tiling(struct hmi_controller *hmi_ctrl,
 	int32_t surface_x = 0;
 	int32_t surface_y = 0;
 	struct ivi_layout_surface *ivisurf  = NULL;
-	struct ivi_layout_surface **surfaces;
-	struct ivi_layout_surface **new_order;
+	struct ivi_layout_surface *new_order[8];
+	struct ivi_layout_surface_update updates[2 * ARRAY_LENGTH(new_order)];
 	const uint32_t duration = hmi_ctrl->hmi_setting->transition_duration;
 	struct ivi_layout_layer *ivilayer = NULL;
 
 	int32_t i = 0;
-	int32_t surf_num = 0;
 	int32_t idx = 0;
 
-	surfaces = MEM_ALLOC(sizeof(*surfaces) * surface_length);
-	new_order = MEM_ALLOC(sizeof(*surfaces) * surface_length);
-
-	for (i = 0; i < surface_length; i++) {
-		ivisurf = pp_surface[i];
-
-		/* skip ui widgets */
-		if (is_surf_in_ui_widget(hmi_ctrl, ivisurf))
-			continue;
-
-		surfaces[surf_num++] = ivisurf;
-	}
-
 	wl_list_for_each_reverse(layer, layer_list, link) {
-		if (idx >= surf_num)
+		if (idx >= surface_length)
 			break;
 
 		ivilayer = layer->ivilayer;
 
-		for (i = 0; i < 8; i++, idx++) {
-			if (idx >= surf_num)
+		for (i = 0; i < (int32_t)ARRAY_LENGTH(new_order); i++, idx++) {
+			if (idx >= surface_length)
 				break;
 
-			ivisurf = surfaces[idx];
+			ivisurf = pp_surface[idx];
 			new_order[i] = ivisurf;
 			if (i < 4) {
 				surface_x = (int32_t)(i * (surface_width));
@@ -261,24 +289,20 @@ mode_divided_into_tiling(struct hmi_controller *hmi_ctrl,
 			ivi_layout_interface->surface_set_transition(ivisurf,
 					IVI_LAYOUT_TRANSITION_VIEW_DEFAULT,
 					duration);
-			ivi_layout_interface->surface_set_visibility(ivisurf, true);
-			ivi_layout_interface->surface_set_destination_rectangle(ivisurf,
+			show_surface_at(&updates[2 * i], ivisurf,
 					surface_x, surface_y,
 					(int32_t)surface_width,
 					(int32_t)surface_height);
-
 		}
+		ivi_layout_interface->surface_set_properties(updates, 2 * i);
 		ivi_layout_interface->layer_set_render_order(ivilayer, new_order, i);
 
 		ivi_layout_interface->layer_set_transition(ivilayer,
 					IVI_LAYOUT_TRANSITION_LAYER_VIEW_ORDER,
 					duration);
 	}
-	for (i = idx; i < surf_num; i++)
-		ivi_layout_interface->surface_set_visibility(surfaces[i], false);
-
-	free(surfaces);
-	free(new_order);
+	for (i = idx; i < surface_length; i++)
+		ivi_layout_interface->surface_set_visibility(pp_surface[i], false);
 }
 
 static void
@@ -294,60 +318,41 @@ mode_divided_into_sidebyside(struct hmi_controller *hmi_ctrl,
 
 	const uint32_t duration = hmi_ctrl->hmi_setting->transition_duration;
 	int32_t i = 0;
-	struct ivi_layout_surface **surfaces;
-	struct ivi_layout_surface **new_order;
+	struct ivi_layout_surface *new_order[2];
+	struct ivi_layout_surface_update updates[2 * ARRAY_LENGTH(new_order)];
 	struct ivi_layout_layer *ivilayer = NULL;
-	int32_t surf_num = 0;
 	int32_t idx = 0;
 
-	surfaces = MEM_ALLOC(sizeof(*surfaces) * surface_length);
-	new_order = MEM_ALLOC(sizeof(*surfaces) * surface_length);
-
-	for (i = 0; i < surface_length; i++) {
-		ivisurf = pp_surface[i];
-
-		/* skip ui widgets */
-		if (is_surf_in_ui_widget(hmi_ctrl, ivisurf))
-			continue;
-
-		surfaces[surf_num++] = ivisurf;
-	}
-
 	wl_list_for_each_reverse(layer, layer_list, link) {
-		if (idx >= surf_num)
+		if (idx >= surface_length)
 			break;
 
 		ivilayer = layer->ivilayer;
 
-		for (i = 0; i < 2; i++, idx++) {
-			if (idx >= surf_num)
+		for (i = 0; i < (int32_t)ARRAY_LENGTH(new_order); i++, idx++) {
+			if (idx >= surface_length)
 				break;
 
-			ivisurf = surfaces[idx];
+			ivisurf = pp_surface[idx];
 			new_order[i] = ivisurf;
 
 			ivi_layout_interface->surface_set_transition(ivisurf,
 					IVI_LAYOUT_TRANSITION_VIEW_DEFAULT,
 					duration);
-			ivi_layout_interface->surface_set_visibility(ivisurf, true);
-
-			ivi_layout_interface->surface_set_destination_rectangle(ivisurf,
-								i * surface_width, 0,
-								surface_width,
-								surface_height);
+			show_surface_at(&updates[2 * i], ivisurf,
+					i * surface_width, 0,
+					surface_width, surface_height);
 		}
+		ivi_layout_interface->surface_set_properties(updates, 2 * i);
 		ivi_layout_interface->layer_set_render_order(ivilayer, new_order, i);
 	}
 
-	for (i = idx; i < surf_num; i++) {
-		ivi_layout_interface->surface_set_transition(surfaces[i],
+	for (i = idx; i < surface_length; i++) {
+		ivi_layout_interface->surface_set_transition(pp_surface[i],
 						IVI_LAYOUT_TRANSITION_VIEW_FADE_ONLY,
 						duration);
-		ivi_layout_interface->surface_set_visibility(surfaces[i], false);
+		ivi_layout_interface->surface_set_visibility(pp_surface[i], false);
 	}
-
-	free(surfaces);
-	free(new_order);
 }
 
 static void
@@ -362,25 +367,13 @@ mode_fullscreen_someone(struct hmi_controller *hmi_ctrl,
 	struct ivi_layout_surface *ivisurf  = NULL;
 	int32_t i = 0;
 	const uint32_t duration = hmi_ctrl->hmi_setting->transition_duration;
-	int32_t surf_num = 0;
-	struct ivi_layout_surface **surfaces;
 
-	surfaces = MEM_ALLOC(sizeof(*surfaces) * surface_length);
+	ivi_layout_interface->layer_set_render_order(layer->ivilayer, pp_surface,
+						     surface_length);
 
 	for (i = 0; i < surface_length; i++) {
 		ivisurf = pp_surface[i];
 
-		/* skip ui widgets */
-		if (is_surf_in_ui_widget(hmi_ctrl, ivisurf))
-			continue;
-
-		surfaces[surf_num++] = ivisurf;
-	}
-	ivi_layout_interface->layer_set_render_order(layer->ivilayer, surfaces, surf_num);
-
-	for (i = 0; i < surf_num; i++) {
-		ivisurf = surfaces[i];
-
 		if ((i > 0) && (i < hmi_ctrl->screen_num)) {
 			layer = wl_container_of(layer->link.prev, layer, link);
 			ivi_layout_interface->layer_set_render_order(layer->ivilayer, &ivisurf, 1);
@@ -394,8 +387,6 @@ mode_fullscreen_someone(struct hmi_controller *hmi_ctrl,
 							     surface_width,
 							     surface_height);
 	}
-
-	free(surfaces);
 }
 
 static void
@@ -405,7 +396,6 @@ mode_random_replace(struct hmi_controller *hmi_ctrl,
 		    struct wl_list *layer_list)
 {
 	struct hmi_controller_layer *application_layer = NULL;
-	struct hmi_controller_layer **layers = NULL;
 	int32_t surface_width  = 0;
 	int32_t surface_height = 0;
 	int32_t surface_x = 0;
@@ -415,22 +405,15 @@ mode_random_replace(struct hmi_controller *hmi_ctrl,
 	int32_t i = 0;
 	int32_t layer_idx = 0;
 
-	layers = MEM_ALLOC(sizeof(*layers) * hmi_ctrl->screen_num);
-
-	wl_list_for_each(application_layer, layer_list, link) {
-		layers[layer_idx] = application_layer;
-		layer_idx++;
-	}
-
 	for (i = 0; i < surface_length; i++) {
 		ivisurf = pp_surface[i];
 
-		/* skip ui widgets */
-		if (is_surf_in_ui_widget(hmi_ctrl, ivisurf))
-			continue;
-
 		/* surface determined at random a layer that belongs */
 		layer_idx = rand() % hmi_ctrl->screen_num;
+		wl_list_for_each(application_layer, layer_list, link) {
+			if (layer_idx-- == 0)
+				break;
+		}
 
 		ivi_layout_interface->surface_set_transition(ivisurf,
 					IVI_LAYOUT_TRANSITION_VIEW_DEFAULT,
@@ -438,10 +421,10 @@ mode_random_replace(struct hmi_controller *hmi_ctrl,
 
 		ivi_layout_interface->surface_set_visibility(ivisurf, true);
 
-		surface_width  = (int32_t)(layers[layer_idx]->width * 0.25f);
-		surface_height = (int32_t)(layers[layer_idx]->height * 0.25f);
-		surface_x = rand() % (layers[layer_idx]->width - surface_width);
-		surface_y = rand() % (layers[layer_idx]->height - surface_height);
+		surface_width  = (int32_t)(application_layer->width * 0.25f);
+		surface_height = (int32_t)(application_layer->height * 0.25f);
+		surface_x = rand() % (application_layer->width - surface_width);
+		surface_y = rand() % (application_layer->height - surface_height);
 
 		ivi_layout_interface->surface_set_destination_rectangle(ivisurf,
 							     surface_x,
@@ -449,31 +432,41 @@ mode_random_replace(struct hmi_controller *hmi_ctrl,
 							     surface_width,
 							     surface_height);
 
-		ivi_layout_interface->layer_add_surface(layers[layer_idx]->ivilayer, ivisurf);
+		ivi_layout_interface->layer_add_surface(application_layer->ivilayer,
+							ivisurf);
 	}
-
-	free(layers);
 }
 
+/**
+ * Collects the application ivi_surfaces, i.e. all but the ui widgets,
+ * into the scratch buffer and returns how many there are.
+ */
 static int32_t
-has_application_surface(struct hmi_controller *hmi_ctrl,
-			struct ivi_layout_surface **pp_surface,
-			int32_t surface_length)
+get_application_surfaces(struct hmi_controller *hmi_ctrl,
+			 struct ivi_layout_surface ***pp_surface)
 {
-	struct ivi_layout_surface *ivisurf  = NULL;
-	int32_t i = 0;
+	struct ivi_layout_surface **surfaces;
+	int32_t length;
+	int32_t i;
+	int32_t n = 0;
 
-	for (i = 0; i < surface_length; i++) {
-		ivisurf = pp_surface[i];
+	length = ivi_layout_interface->get_surfaces_into(NULL, 0);
+	assert(length >= 0);
 
+	surfaces = surface_scratch_reserve(hmi_ctrl, length);
+	ivi_layout_interface->get_surfaces_into(surfaces, length);
+
+	for (i = 0; i < length; i++) {
 		/* skip ui widgets */
-		if (is_surf_in_ui_widget(hmi_ctrl, ivisurf))
+		if (is_surf_in_ui_widget(hmi_ctrl, surfaces[i]))
 			continue;
 
-		return 1;
+		surfaces[n++] = surfaces[i];
 	}
 
-	return 0;
+	*pp_surface = surfaces;
+
+	return n;
 }
 
 /**
@@ -487,21 +480,15 @@ switch_mode(struct hmi_controller *hmi_ctrl,
 	struct wl_list *layer = &hmi_ctrl->application_layer_list;
 	struct ivi_layout_surface **pp_surface = NULL;
 	int32_t surface_length = 0;
-	int32_t ret = 0;
 
 	if (!hmi_ctrl->is_initialized)
 		return;
 
 	hmi_ctrl->layout_mode = layout_mode;
 
-	ret = ivi_layout_interface->get_surfaces(&surface_length, &pp_surface);
-	assert(!ret);
-
-	if (!has_application_surface(hmi_ctrl, pp_surface, surface_length)) {
-		free(pp_surface);
-		pp_surface = NULL;
+	surface_length = get_application_surfaces(hmi_ctrl, &pp_surface);
+	if (surface_length == 0)
 		return;
-	}
 
 	switch (layout_mode) {
 	case IVI_HMI_CONTROLLER_LAYOUT_MODE_TILING:
@@ -523,7 +510,6 @@ switch_mode(struct hmi_controller *hmi_ctrl,
 	}
 
 	ivi_layout_interface->commit_changes();
-	free(pp_surface);
 }
 
 /**
@@ -649,8 +635,11 @@ set_notification_configure_surface(struct wl_listener *listener, void *data)
 	 */
 	wl_list_for_each_reverse(layer_link, &hmi_ctrl->application_layer_list, link) {
 		application_layer = layer_link->ivilayer;
-		ivi_layout_interface->get_surfaces_on_layer(application_layer,
-							&length, &ivisurfs);
+		length = ivi_layout_interface->get_surfaces_on_layer_into(
+					application_layer, NULL, 0);
+		ivisurfs = surface_scratch_reserve(hmi_ctrl, length);
+		ivi_layout_interface->get_surfaces_on_layer_into(
+					application_layer, ivisurfs, length);
 		for (i = 0; i < length; i++) {
 			if (ivisurf == ivisurfs[i]) {
 				/*
@@ -658,12 +647,9 @@ set_notification_configure_surface(struct wl_listener *listener, void *data)
 				 * commit_changes to apply source_rectangle.
 				 */
 				ivi_layout_interface->commit_changes();
-				free(ivisurfs);
 				return;
 			}
 		}
-		free(ivisurfs);
-		ivisurfs = NULL;
 	}
 
 	switch_mode(hmi_ctrl, hmi_ctrl->layout_mode);
@@ -744,6 +730,7 @@ hmi_controller_destroy(struct wl_listener *listener, void *data)
 	}
 
 	wl_array_release(&hmi_ctrl->ui_widgets);
+	wl_array_release(&hmi_ctrl->surface_scratch);
 	free(hmi_ctrl->hmi_setting);
 	free(hmi_ctrl);
 }
@@ -776,6 +763,7 @@ hmi_controller_create(struct weston_compositor *ec)
 	int32_t i = 0;
 
 	wl_array_init(&hmi_ctrl->ui_widgets);
+	wl_array_init(&hmi_ctrl->surface_scratch);
 	hmi_ctrl->layout_mode = IVI_HMI_CONTROLLER_LAYOUT_MODE_TILING;
 	hmi_ctrl->hmi_setting = hmi_server_setting_create(ec);
 	hmi_ctrl->compositor = ec;
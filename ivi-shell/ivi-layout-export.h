@@ -138,6 +138,53 @@ enum ivi_layout_transition_type{
 	IVI_LAYOUT_TRANSITION_MAX,
 };
 
+enum ivi_layout_surface_property {
+	IVI_LAYOUT_SURFACE_VISIBILITY,
+	IVI_LAYOUT_SURFACE_OPACITY,
+	IVI_LAYOUT_SURFACE_SOURCE_RECTANGLE,
+	IVI_LAYOUT_SURFACE_DESTINATION_RECTANGLE,
+	IVI_LAYOUT_SURFACE_ORIENTATION,
+};
+
+/**
+ * One entry of a surface_set_properties() batch. Only the member of
+ * value matching property is read; both rectangle properties use rect.
+ */
+struct ivi_layout_surface_update {
+	struct ivi_layout_surface *surface;
+	enum ivi_layout_surface_property property;
+	union {
+		bool visibility;
+		wl_fixed_t opacity;
+		struct {
+			int32_t x, y;
+			int32_t width, height;
+		} rect;
+		enum wl_output_transform orientation;
+	} value;
+};
+
+struct ivi_layout_surface_change {
+	struct ivi_layout_surface *surface;
+	uint32_t event_mask;	/* enum ivi_layout_notification_mask */
+};
+
+struct ivi_layout_layer_change {
+	struct ivi_layout_layer *layer;
+	uint32_t event_mask;	/* enum ivi_layout_notification_mask */
+};
+
+/**
+ * Everything one commit_changes() changed, in one place. The arrays are
+ * owned by ivi-layout and only valid while the listener runs.
+ */
+struct ivi_layout_commit_event {
+	const struct ivi_layout_surface_change *surfaces;
+	int32_t surface_count;
+	const struct ivi_layout_layer_change *layers;
+	int32_t layer_count;
+};
+
 struct ivi_layout_interface {
 
 	/**
@@ -576,6 +623,65 @@ struct ivi_layout_interface {
 	 */
 	struct ivi_layout_surface *
 		(*get_surface)(struct weston_surface *surface);
+
+	/**
+	 * Non-allocating variants of the getters above.
+	 *
+	 * These fill the caller-provided array with at most size entries,
+	 * in the same order as the allocating getters, and return the
+	 * total number of entries, which may be larger than size. Calling
+	 * with a NULL array and size 0 only counts. Nothing needs to be
+	 * freed.
+	 *
+	 * \return the number of entries if the method call was successful
+	 * \return IVI_FAILED if the method call was failed
+	 */
+	int32_t (*get_surfaces_into)(struct ivi_layout_surface **array,
+				     int32_t size);
+
+	int32_t (*get_surfaces_on_layer_into)(struct ivi_layout_layer *ivilayer,
+					      struct ivi_layout_surface **array,
+					      int32_t size);
+
+	int32_t (*get_layers_into)(struct ivi_layout_layer **array,
+				   int32_t size);
+
+	int32_t (*get_layers_on_screen_into)(struct weston_output *output,
+					     struct ivi_layout_layer **array,
+					     int32_t size);
+
+	/**
+	 * \brief Apply a batch of surface property changes
+	 *
+	 * Equivalent to calling the matching surface_set_* method for each
+	 * entry in order, except that all entries are checked first: if
+	 * any of them is invalid, nothing is changed. As with the single
+	 * setters, the changes take effect and are notified on the next
+	 * commit_changes().
+	 *
+	 * \return IVI_SUCCEEDED if the method call was successful
+	 * \return IVI_FAILED if the method call was failed
+	 */
+	int32_t (*surface_set_properties)(
+			const struct ivi_layout_surface_update *updates,
+			int32_t count);
+
+	/**
+	 * \brief add a listener for notification of a whole commit
+	 *
+	 * After each commit_changes() which changed the properties of any
+	 * ivi_surface or ivi_layer, a signal is emitted once with a
+	 * struct ivi_layout_commit_event listing all of them and their
+	 * event masks, as the void *data argument. This is emitted before
+	 * the per-object listeners of surface_add_listener() and
+	 * layer_add_listener(), which keep working as before. If the
+	 * list cannot be allocated, the signal is skipped for that commit
+	 * rather than sent with part of the changes.
+	 *
+	 * \return IVI_SUCCEEDED if the method call was successful
+	 * \return IVI_FAILED if the method call was failed
+	 */
+	int32_t (*add_listener_commit)(struct wl_listener *listener);
 };
 
 #ifdef __cplusplus
@@ -48,6 +48,9 @@ struct ivi_layout_surface {
 		struct wl_list link;
 	} pending;
 
+	/* ivi_layout::dirty_surface_list */
+	struct wl_list dirty_link;
+
 	struct {
 		struct wl_list link;
 		struct wl_list layer_list;
@@ -76,9 +79,14 @@ struct ivi_layout_layer {
 		struct wl_list link;
 	} order;
 
+	/* ivi_layout::dirty_layer_list */
+	struct wl_list dirty_link;
+
 	int32_t ref_count;
 };
 
+struct hash_table;
+
 struct ivi_layout {
 	struct weston_compositor *compositor;
 
@@ -86,6 +94,16 @@ struct ivi_layout {
 	struct wl_list layer_list;
 	struct wl_list screen_list;
 
+	/* id -> object, for the lookups controllers do all the time */
+	struct hash_table *surface_ids;
+	struct hash_table *layer_ids;
+
+	/* surfaces and layers ivi_layout_commit_changes has to look at */
+	struct wl_list dirty_surface_list;
+	struct wl_list dirty_layer_list;
+	/* layout_layer.view_list needs to be rebuilt */
+	bool view_list_dirty;
+
 	struct {
 		struct wl_signal created;
 		struct wl_signal removed;
@@ -97,6 +115,11 @@ struct ivi_layout {
 		struct wl_signal configure_changed;
 	} surface_notification;
 
+	/* one ivi_layout_commit_event per commit_changes, see send_prop */
+	struct wl_signal commit_notification;
+	struct wl_array changed_surfaces;
+	struct wl_array changed_layers;
+
 	struct weston_layer layout_layer;
 	struct wl_signal warning_signal;
 
@@ -109,7 +132,9 @@ struct ivi_layout *get_instance(void);
 struct ivi_layout_transition;
 
 struct ivi_layout_transition_set {
-	struct wl_event_source  *event_source;
+	struct weston_compositor *compositor;
+	struct weston_animation animation;
+	struct wl_listener      output_destroyed;
 	struct wl_list          transition_list;
 };
 
@@ -118,6 +143,9 @@ typedef void (*ivi_layout_transition_destroy_user_func)(void *user_data);
 struct ivi_layout_transition_set *
 ivi_layout_transition_set_create(struct weston_compositor *ec);
 
+void
+ivi_layout_transition_set_start(struct ivi_layout_transition_set *transitions);
+
 void
 ivi_layout_transition_move_resize_view(struct ivi_layout_surface *surface,
 				       int32_t dest_x, int32_t dest_y,
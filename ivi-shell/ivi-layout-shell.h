@@ -46,11 +46,14 @@ void
 ivi_layout_surface_configure(struct ivi_layout_surface *ivisurf,
 			     int32_t width, int32_t height);
 
+void
+ivi_layout_surface_remap(struct ivi_layout_surface *ivisurf);
+
 struct ivi_layout_surface*
 ivi_layout_surface_create(struct weston_surface *wl_surface,
 			  uint32_t id_surface);
 
-void
+int
 ivi_layout_init_with_compositor(struct weston_compositor *ec);
 
 void
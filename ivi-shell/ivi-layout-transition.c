@@ -25,7 +25,6 @@
 
 #include "config.h"
 
-#include <time.h>
 #include <assert.h>
 #include <stdlib.h>
 #include <stdio.h>
@@ -151,39 +150,82 @@ do_transition_frame(struct ivi_layout_transition *transition,
 		layout_transition_destroy(transition);
 }
 
-static int32_t
-layout_transition_frame(void *data)
+/*
+ * Transitions are ticked from the repaint loop of one output, with the
+ * presentation time of its frames. The hook is only on the animation
+ * list while there are transitions to run, so an idle shell does not
+ * wake up.
+ */
+static void
+layout_transition_frame(struct weston_animation *animation,
+			struct weston_output *output, uint32_t msecs)
 {
-	struct ivi_layout_transition_set *transitions = data;
-	uint32_t fps = 30;
-	struct timespec timestamp = {};
-	uint32_t msec = 0;
+	struct ivi_layout_transition_set *transitions =
+		container_of(animation, struct ivi_layout_transition_set,
+			     animation);
 	struct transition_node *node = NULL;
 	struct transition_node *next = NULL;
 
+	wl_list_for_each_safe(node, next, &transitions->transition_list, link) {
+		do_transition_frame(node->transition, msecs);
+	}
+
+	ivi_layout_commit_changes();
+
 	if (wl_list_empty(&transitions->transition_list)) {
-		wl_event_source_timer_update(transitions->event_source, 0);
-		return 1;
+		wl_list_remove(&animation->link);
+		wl_list_init(&animation->link);
 	}
+}
 
-	wl_event_source_timer_update(transitions->event_source, 1000 / fps);
+static void
+transition_set_attach_output(struct ivi_layout_transition_set *transitions)
+{
+	struct weston_output *output;
 
-	clock_gettime(CLOCK_MONOTONIC, &timestamp);/* FIXME */
-	msec = (1e+3 * timestamp.tv_sec + 1e-6 * timestamp.tv_nsec);
+	if (wl_list_empty(&transitions->compositor->output_list))
+		return;
 
-	wl_list_for_each_safe(node, next, &transitions->transition_list, link) {
-		do_transition_frame(node->transition, msec);
-	}
+	output = container_of(transitions->compositor->output_list.next,
+			      struct weston_output, link);
 
-	ivi_layout_commit_changes();
-	return 1;
+	wl_list_insert(&output->animation_list, &transitions->animation.link);
+	weston_output_schedule_repaint(output);
+}
+
+static void
+transition_set_output_destroyed(struct wl_listener *listener, void *data)
+{
+	struct ivi_layout_transition_set *transitions =
+		container_of(listener, struct ivi_layout_transition_set,
+			     output_destroyed);
+
+	if (wl_list_empty(&transitions->animation.link))
+		return;
+
+	/* Could have been on the destroyed output, move to a live one. */
+	wl_list_remove(&transitions->animation.link);
+	wl_list_init(&transitions->animation.link);
+	transition_set_attach_output(transitions);
+}
+
+/**
+ * Starts ticking the transitions on the next frame, unless already running.
+ */
+void
+ivi_layout_transition_set_start(struct ivi_layout_transition_set *transitions)
+{
+	if (!wl_list_empty(&transitions->animation.link))
+		return;
+
+	transitions->animation.frame_counter = 0;
+	transition_set_attach_output(transitions);
 }
 
 struct ivi_layout_transition_set *
 ivi_layout_transition_set_create(struct weston_compositor *ec)
 {
 	struct ivi_layout_transition_set *transitions;
-	struct wl_event_loop *loop;
 
 	transitions = malloc(sizeof(*transitions));
 	if (transitions == NULL) {
@@ -193,10 +235,13 @@ ivi_layout_transition_set_create(struct weston_compositor *ec)
 
 	wl_list_init(&transitions->transition_list);
 
-	loop = wl_display_get_event_loop(ec->wl_display);
-	transitions->event_source =
-		wl_event_loop_add_timer(loop, layout_transition_frame,
-					transitions);
+	transitions->compositor = ec;
+	transitions->animation.frame = layout_transition_frame;
+	wl_list_init(&transitions->animation.link);
+
+	transitions->output_destroyed.notify = transition_set_output_destroyed;
+	wl_signal_add(&ec->output_destroyed_signal,
+		      &transitions->output_destroyed);
 
 	return transitions;
 }
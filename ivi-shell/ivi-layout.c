@@ -67,6 +67,7 @@
 #include "ivi-layout-private.h"
 #include "ivi-layout-shell.h"
 
+#include "shared/hash.h"
 #include "shared/helpers.h"
 #include "shared/os-compatibility.h"
 
@@ -109,34 +110,18 @@ get_instance(void)
 }
 
 /**
- * Internal API to add/remove an ivi_layer to/from ivi_screen.
+ * Internal API to look up ivi_surfaces and ivi_layers by id.
  */
 static struct ivi_layout_surface *
-get_surface(struct wl_list *surf_list, uint32_t id_surface)
+get_surface(struct ivi_layout *layout, uint32_t id_surface)
 {
-	struct ivi_layout_surface *ivisurf;
-
-	wl_list_for_each(ivisurf, surf_list, link) {
-		if (ivisurf->id_surface == id_surface) {
-			return ivisurf;
-		}
-	}
-
-	return NULL;
+	return hash_table_lookup(layout->surface_ids, id_surface);
 }
 
 static struct ivi_layout_layer *
-get_layer(struct wl_list *layer_list, uint32_t id_layer)
+get_layer(struct ivi_layout *layout, uint32_t id_layer)
 {
-	struct ivi_layout_layer *ivilayer;
-
-	wl_list_for_each(ivilayer, layer_list, link) {
-		if (ivilayer->id_layer == id_layer) {
-			return ivilayer;
-		}
-	}
-
-	return NULL;
+	return hash_table_lookup(layout->layer_ids, id_layer);
 }
 
 static struct weston_view *
@@ -185,8 +170,12 @@ ivi_layout_surface_destroy(struct ivi_layout_surface *ivisurf)
 	wl_list_remove(&ivisurf->transform.link);
 	wl_list_remove(&ivisurf->pending.link);
 	wl_list_remove(&ivisurf->order.link);
+	wl_list_remove(&ivisurf->dirty_link);
 	wl_list_remove(&ivisurf->link);
 
+	if (get_surface(layout, ivisurf->id_surface) == ivisurf)
+		hash_table_remove(layout->surface_ids, ivisurf->id_surface);
+
 	wl_signal_emit(&layout->surface_notification.removed, ivisurf);
 
 	ivi_layout_remove_all_surface_transitions(ivisurf);
@@ -253,6 +242,27 @@ init_surface_properties(struct ivi_layout_surface_properties *prop)
 	prop->dest_height = 1;
 }
 
+/**
+ * Internal APIs to queue ivi_surface/ivi_layer for the next commit.
+ * Only objects on these lists are looked at by ivi_layout_commit_changes,
+ * every setter touching pending state has to call them.
+ */
+static void
+surface_mark_dirty(struct ivi_layout_surface *ivisurf)
+{
+	if (wl_list_empty(&ivisurf->dirty_link))
+		wl_list_insert(ivisurf->layout->dirty_surface_list.prev,
+			       &ivisurf->dirty_link);
+}
+
+static void
+layer_mark_dirty(struct ivi_layout_layer *ivilayer)
+{
+	if (wl_list_empty(&ivilayer->dirty_link))
+		wl_list_insert(ivilayer->layout->dirty_layer_list.prev,
+			       &ivilayer->dirty_link);
+}
+
 /**
  * Internal APIs to be called from ivi_layout_commit_changes.
  */
@@ -565,19 +575,35 @@ update_prop(struct ivi_layout_screen  *iviscrn,
 	    struct ivi_layout_layer *ivilayer,
 	    struct ivi_layout_surface *ivisurf)
 {
+	uint32_t event_mask = ivilayer->prop.event_mask |
+			      ivisurf->prop.event_mask;
 	struct weston_view *tmpview;
 	struct ivi_rectangle r;
 	bool can_calc = true;
+	bool was_opaque;
 
 	/*In case of no prop change, this just returns*/
-	if (!ivilayer->prop.event_mask && !ivisurf->prop.event_mask)
+	if (!event_mask)
 		return;
 
-	update_opacity(ivilayer, ivisurf);
-
 	tmpview = get_weston_view(ivisurf);
 	assert(tmpview != NULL);
 
+	was_opaque = tmpview->alpha == 1.0;
+	update_opacity(ivilayer, ivisurf);
+
+	/*
+	 * An opacity change keeps the transformation, only the visible part
+	 * of the view needs repainting. Becoming (non-)opaque changes the
+	 * opaque region, which is computed with the transformation.
+	 */
+	if (event_mask == IVI_NOTIFICATION_OPACITY &&
+	    was_opaque == (tmpview->alpha == 1.0)) {
+		ivisurf->update_count++;
+		weston_view_damage_below(tmpview);
+		return;
+	}
+
 	if (ivisurf->prop.source_width == 0 || ivisurf->prop.source_height == 0) {
 		weston_log("ivi-shell: source rectangle is not yet set by ivi_layout_surface_set_source_rectangle\n");
 		can_calc = false;
@@ -604,39 +630,55 @@ update_prop(struct ivi_layout_screen  *iviscrn,
 
 	ivisurf->update_count++;
 
+	/*
+	 * Damages the old and the new bounding box of the view, the content
+	 * of the surface did not change.
+	 */
 	weston_view_geometry_dirty(tmpview);
-
-	weston_surface_damage(ivisurf->surface);
 }
 
 static void
 commit_changes(struct ivi_layout *layout)
 {
-	struct ivi_layout_screen  *iviscrn  = NULL;
 	struct ivi_layout_layer   *ivilayer = NULL;
 	struct ivi_layout_surface *ivisurf  = NULL;
 
-	wl_list_for_each(iviscrn, &layout->screen_list, link) {
-		wl_list_for_each(ivilayer, &iviscrn->order.layer_list, order.link) {
-			/*
-			 * If ivilayer is invisible, weston_view of ivisurf doesn't
-			 * need to be modified.
-			 */
-			if (ivilayer->prop.visibility == false)
-				continue;
+	/*
+	 * A changed ivilayer moves all of its surfaces, an unchanged one
+	 * only the surfaces which changed themselves.
+	 */
+	wl_list_for_each(ivilayer, &layout->dirty_layer_list, dirty_link) {
+		/*
+		 * If ivilayer is invisible, weston_view of ivisurf doesn't
+		 * need to be modified.
+		 */
+		if (ivilayer->on_screen == NULL ||
+		    ivilayer->prop.visibility == false ||
+		    !ivilayer->prop.event_mask)
+			continue;
 
-			wl_list_for_each(ivisurf, &ivilayer->order.surface_list, order.link) {
-				/*
-				 * If ivilayer is invisible, weston_view of ivisurf doesn't
-				 * need to be modified.
-				 */
-				if (ivisurf->prop.visibility == false)
-					continue;
+		wl_list_for_each(ivisurf, &ivilayer->order.surface_list, order.link) {
+			if (ivisurf->prop.visibility == false)
+				continue;
 
-				update_prop(iviscrn, ivilayer, ivisurf);
-			}
+			update_prop(ivilayer->on_screen, ivilayer, ivisurf);
 		}
 	}
+
+	wl_list_for_each(ivisurf, &layout->dirty_surface_list, dirty_link) {
+		ivilayer = ivisurf->on_layer;
+
+		if (ivilayer == NULL || ivilayer->on_screen == NULL ||
+		    ivilayer->prop.visibility == false ||
+		    ivisurf->prop.visibility == false)
+			continue;
+
+		/* already done along with its layer */
+		if (ivilayer->prop.event_mask)
+			continue;
+
+		update_prop(ivilayer->on_screen, ivilayer, ivisurf);
+	}
 }
 
 static void
@@ -649,7 +691,10 @@ commit_surface_list(struct ivi_layout *layout)
 	int32_t dest_height = 0;
 	int32_t configured = 0;
 
-	wl_list_for_each(ivisurf, &layout->surface_list, link) {
+	wl_list_for_each(ivisurf, &layout->dirty_surface_list, dirty_link) {
+		if (ivisurf->prop.visibility != ivisurf->pending.prop.visibility)
+			layout->view_list_dirty = true;
+
 		if (ivisurf->pending.prop.transition_type == IVI_LAYOUT_TRANSITION_VIEW_DEFAULT) {
 			dest_x = ivisurf->prop.dest_x;
 			dest_y = ivisurf->prop.dest_y;
@@ -748,7 +793,10 @@ commit_layer_list(struct ivi_layout *layout)
 	struct ivi_layout_surface *ivisurf  = NULL;
 	struct ivi_layout_surface *next     = NULL;
 
-	wl_list_for_each(ivilayer, &layout->layer_list, link) {
+	wl_list_for_each(ivilayer, &layout->dirty_layer_list, dirty_link) {
+		if (ivilayer->prop.visibility != ivilayer->pending.prop.visibility)
+			layout->view_list_dirty = true;
+
 		if (ivilayer->pending.prop.transition_type == IVI_LAYOUT_TRANSITION_LAYER_MOVE) {
 			ivi_layout_transition_move_layer(ivilayer, ivilayer->pending.prop.dest_x, ivilayer->pending.prop.dest_y, ivilayer->pending.prop.transition_duration);
 		} else if (ivilayer->pending.prop.transition_type == IVI_LAYOUT_TRANSITION_LAYER_FADE) {
@@ -771,6 +819,7 @@ commit_layer_list(struct ivi_layout *layout)
 			wl_list_remove(&ivisurf->order.link);
 			wl_list_init(&ivisurf->order.link);
 			ivisurf->prop.event_mask |= IVI_NOTIFICATION_REMOVE;
+			surface_mark_dirty(ivisurf);
 		}
 
 		assert(wl_list_empty(&ivilayer->order.surface_list));
@@ -782,9 +831,11 @@ commit_layer_list(struct ivi_layout *layout)
 				       &ivisurf->order.link);
 			ivisurf->on_layer = ivilayer;
 			ivisurf->prop.event_mask |= IVI_NOTIFICATION_ADD;
+			surface_mark_dirty(ivisurf);
 		}
 
 		ivilayer->order.dirty = 0;
+		layout->view_list_dirty = true;
 	}
 }
 
@@ -796,9 +847,8 @@ commit_screen_list(struct ivi_layout *layout)
 	struct ivi_layout_layer   *next     = NULL;
 	struct ivi_layout_surface *ivisurf  = NULL;
 	struct weston_view *tmpview = NULL;
-
-	/* Clear view list of layout ivi_layer */
-	wl_list_init(&layout->layout_layer.view_list.link);
+	struct weston_view *tmpnext = NULL;
+	struct wl_list old_views;
 
 	wl_list_for_each(iviscrn, &layout->screen_list, link) {
 		if (iviscrn->order.dirty) {
@@ -808,6 +858,7 @@ commit_screen_list(struct ivi_layout *layout)
 				wl_list_remove(&ivilayer->order.link);
 				wl_list_init(&ivilayer->order.link);
 				ivilayer->prop.event_mask |= IVI_NOTIFICATION_REMOVE;
+				layer_mark_dirty(ivilayer);
 			}
 
 			assert(wl_list_empty(&iviscrn->order.layer_list));
@@ -821,11 +872,28 @@ commit_screen_list(struct ivi_layout *layout)
 					       &ivilayer->order.link);
 				ivilayer->on_screen = iviscrn;
 				ivilayer->prop.event_mask |= IVI_NOTIFICATION_ADD;
+				layer_mark_dirty(ivilayer);
 			}
 
 			iviscrn->order.dirty = 0;
+			layout->view_list_dirty = true;
 		}
+	}
+
+	/*
+	 * The view list only depends on the render orders and visibilities,
+	 * leave it alone when none of them changed.
+	 */
+	if (!layout->view_list_dirty)
+		return;
+
+	/* Clear view list of layout ivi_layer, keeping the old entries to
+	 * find the views which are gone. */
+	wl_list_init(&old_views);
+	wl_list_insert_list(&old_views, &layout->layout_layer.view_list.link);
+	wl_list_init(&layout->layout_layer.view_list.link);
 
+	wl_list_for_each(iviscrn, &layout->screen_list, link) {
 		wl_list_for_each(ivilayer, &iviscrn->order.layer_list, order.link) {
 			if (ivilayer->prop.visibility == false)
 				continue;
@@ -837,6 +905,7 @@ commit_screen_list(struct ivi_layout *layout)
 				tmpview = get_weston_view(ivisurf);
 				assert(tmpview != NULL);
 
+				wl_list_remove(&tmpview->layer_link.link);
 				weston_layer_entry_insert(&layout->layout_layer.view_list,
 							  &tmpview->layer_link);
 
@@ -844,6 +913,14 @@ commit_screen_list(struct ivi_layout *layout)
 			}
 		}
 	}
+
+	/* Hidden or removed views leave their area to what is below. */
+	wl_list_for_each_safe(tmpview, tmpnext, &old_views, layer_link.link) {
+		weston_view_damage_below(tmpview);
+		weston_layer_entry_remove(&tmpview->layer_link);
+	}
+
+	layout->view_list_dirty = false;
 }
 
 static void
@@ -858,7 +935,7 @@ commit_transition(struct ivi_layout* layout)
 
 	wl_list_init(&layout->pending_transition_list);
 
-	wl_event_source_timer_update(layout->transitions->event_source, 1);
+	ivi_layout_transition_set_start(layout->transitions);
 }
 
 static void
@@ -875,20 +952,121 @@ send_layer_prop(struct ivi_layout_layer *ivilayer)
 	ivilayer->pending.prop.event_mask = 0;
 }
 
+/*
+ * Sends the whole commit as one event to the commit listeners. The
+ * arrays are reused from commit to commit and only valid during the
+ * emission.
+ */
+static void
+send_commit_event(struct ivi_layout *layout,
+		  struct wl_list *layer_list, struct wl_list *surface_list)
+{
+	struct ivi_layout_commit_event event;
+	struct ivi_layout_layer_change *layer_change;
+	struct ivi_layout_surface_change *surface_change;
+	struct ivi_layout_layer *ivilayer;
+	struct ivi_layout_surface *ivisurf;
+
+	layout->changed_layers.size = 0;
+	wl_list_for_each(ivilayer, layer_list, dirty_link) {
+		if (!ivilayer->prop.event_mask)
+			continue;
+
+		layer_change = wl_array_add(&layout->changed_layers,
+					    sizeof *layer_change);
+		if (layer_change == NULL)
+			goto out_of_memory;
+
+		layer_change->layer = ivilayer;
+		layer_change->event_mask = ivilayer->prop.event_mask;
+	}
+
+	layout->changed_surfaces.size = 0;
+	wl_list_for_each(ivisurf, surface_list, dirty_link) {
+		if (!ivisurf->prop.event_mask)
+			continue;
+
+		surface_change = wl_array_add(&layout->changed_surfaces,
+					      sizeof *surface_change);
+		if (surface_change == NULL)
+			goto out_of_memory;
+
+		surface_change->surface = ivisurf;
+		surface_change->event_mask = ivisurf->prop.event_mask;
+	}
+
+	if (layout->changed_layers.size == 0 &&
+	    layout->changed_surfaces.size == 0)
+		return;
+
+	event.layers = layout->changed_layers.data;
+	event.layer_count =
+		layout->changed_layers.size / sizeof *layer_change;
+	event.surfaces = layout->changed_surfaces.data;
+	event.surface_count =
+		layout->changed_surfaces.size / sizeof *surface_change;
+
+	wl_signal_emit(&layout->commit_notification, &event);
+	return;
+
+out_of_memory:
+	/* A partial list would look like a complete one to the listeners,
+	 * so rather send none. */
+	weston_log("%s: fails to allocate memory\n", __func__);
+}
+
+/*
+ * Notifies the listeners of everything committed and empties the dirty
+ * lists. Objects which sent a notification stay on them for one more
+ * commit, to get the event_mask in prop cleared.
+ */
 static void
 send_prop(struct ivi_layout *layout)
 {
 	struct ivi_layout_layer   *ivilayer = NULL;
 	struct ivi_layout_surface *ivisurf  = NULL;
+	struct wl_list layer_list;
+	struct wl_list surface_list;
 
-	wl_list_for_each_reverse(ivilayer, &layout->layer_list, link) {
-		if (ivilayer->prop.event_mask)
+	/* Listeners may set properties again, those go to the fresh lists. */
+	wl_list_init(&layer_list);
+	wl_list_insert_list(&layer_list, &layout->dirty_layer_list);
+	wl_list_init(&layout->dirty_layer_list);
+
+	wl_list_init(&surface_list);
+	wl_list_insert_list(&surface_list, &layout->dirty_surface_list);
+	wl_list_init(&layout->dirty_surface_list);
+
+	/*
+	 * The batched event goes first: a per-object listener destroying
+	 * a surface or layer would leave a stale entry in the arrays, while
+	 * the destroy paths already unlink objects from the lists below.
+	 */
+	if (!wl_list_empty(&layout->commit_notification.listener_list))
+		send_commit_event(layout, &layer_list, &surface_list);
+
+	while (!wl_list_empty(&layer_list)) {
+		ivilayer = container_of(layer_list.next,
+					struct ivi_layout_layer, dirty_link);
+		wl_list_remove(&ivilayer->dirty_link);
+		wl_list_init(&ivilayer->dirty_link);
+
+		if (ivilayer->prop.event_mask) {
 			send_layer_prop(ivilayer);
+			layer_mark_dirty(ivilayer);
+		}
 	}
 
-	wl_list_for_each_reverse(ivisurf, &layout->surface_list, link) {
-		if (ivisurf->prop.event_mask)
+	while (!wl_list_empty(&surface_list)) {
+		ivisurf = container_of(surface_list.next,
+				       struct ivi_layout_surface, dirty_link);
+		wl_list_remove(&ivisurf->dirty_link);
+		wl_list_init(&ivisurf->dirty_link);
+
+		if (ivisurf->prop.event_mask) {
 			send_surface_prop(ivisurf);
+			surface_mark_dirty(ivisurf);
+		}
 	}
 }
 
@@ -983,6 +1161,21 @@ ivi_layout_add_listener_remove_surface(struct wl_listener *listener)
 	return IVI_SUCCEEDED;
 }
 
+static int32_t
+ivi_layout_add_listener_commit(struct wl_listener *listener)
+{
+	struct ivi_layout *layout = get_instance();
+
+	if (listener == NULL) {
+		weston_log("ivi_layout_add_listener_commit: invalid argument\n");
+		return IVI_FAILED;
+	}
+
+	wl_signal_add(&layout->commit_notification, listener);
+
+	return IVI_SUCCEEDED;
+}
+
 static int32_t
 ivi_layout_add_listener_configure_surface(struct wl_listener *listener)
 {
@@ -1013,31 +1206,13 @@ ivi_layout_get_id_of_layer(struct ivi_layout_layer *ivilayer)
 static struct ivi_layout_layer *
 ivi_layout_get_layer_from_id(uint32_t id_layer)
 {
-	struct ivi_layout *layout = get_instance();
-	struct ivi_layout_layer *ivilayer = NULL;
-
-	wl_list_for_each(ivilayer, &layout->layer_list, link) {
-		if (ivilayer->id_layer == id_layer) {
-			return ivilayer;
-		}
-	}
-
-	return NULL;
+	return get_layer(get_instance(), id_layer);
 }
 
 struct ivi_layout_surface *
 ivi_layout_get_surface_from_id(uint32_t id_surface)
 {
-	struct ivi_layout *layout = get_instance();
-	struct ivi_layout_surface *ivisurf = NULL;
-
-	wl_list_for_each(ivisurf, &layout->surface_list, link) {
-		if (ivisurf->id_surface == id_surface) {
-			return ivisurf;
-		}
-	}
-
-	return NULL;
+	return get_surface(get_instance(), id_surface);
 }
 
 static int32_t
@@ -1264,6 +1439,96 @@ ivi_layout_get_surfaces_on_layer(struct ivi_layout_layer *ivilayer,
 	return IVI_SUCCEEDED;
 }
 
+static int32_t
+ivi_layout_get_surfaces_into(struct ivi_layout_surface **array, int32_t size)
+{
+	struct ivi_layout *layout = get_instance();
+	struct ivi_layout_surface *ivisurf;
+	int32_t n = 0;
+
+	if (size < 0 || (array == NULL && size > 0)) {
+		weston_log("ivi_layout_get_surfaces_into: invalid argument\n");
+		return IVI_FAILED;
+	}
+
+	wl_list_for_each(ivisurf, &layout->surface_list, link) {
+		if (n < size)
+			array[n] = ivisurf;
+		n++;
+	}
+
+	return n;
+}
+
+static int32_t
+ivi_layout_get_surfaces_on_layer_into(struct ivi_layout_layer *ivilayer,
+				      struct ivi_layout_surface **array,
+				      int32_t size)
+{
+	struct ivi_layout_surface *ivisurf;
+	int32_t n = 0;
+
+	if (ivilayer == NULL || size < 0 || (array == NULL && size > 0)) {
+		weston_log("ivi_layout_get_surfaces_on_layer_into: "
+			   "invalid argument\n");
+		return IVI_FAILED;
+	}
+
+	wl_list_for_each(ivisurf, &ivilayer->order.surface_list, order.link) {
+		if (n < size)
+			array[n] = ivisurf;
+		n++;
+	}
+
+	return n;
+}
+
+static int32_t
+ivi_layout_get_layers_into(struct ivi_layout_layer **array, int32_t size)
+{
+	struct ivi_layout *layout = get_instance();
+	struct ivi_layout_layer *ivilayer;
+	int32_t n = 0;
+
+	if (size < 0 || (array == NULL && size > 0)) {
+		weston_log("ivi_layout_get_layers_into: invalid argument\n");
+		return IVI_FAILED;
+	}
+
+	wl_list_for_each(ivilayer, &layout->layer_list, link) {
+		if (n < size)
+			array[n] = ivilayer;
+		n++;
+	}
+
+	return n;
+}
+
+static int32_t
+ivi_layout_get_layers_on_screen_into(struct weston_output *output,
+				     struct ivi_layout_layer **array,
+				     int32_t size)
+{
+	struct ivi_layout_screen *iviscrn;
+	struct ivi_layout_layer *ivilayer;
+	int32_t n = 0;
+
+	if (output == NULL || size < 0 || (array == NULL && size > 0)) {
+		weston_log("ivi_layout_get_layers_on_screen_into: "
+			   "invalid argument\n");
+		return IVI_FAILED;
+	}
+
+	iviscrn = get_screen_from_output(output);
+	wl_list_for_each(ivilayer, &iviscrn->order.layer_list, order.link) {
+		if (n < size)
+			array[n] = ivilayer;
+		n++;
+	}
+
+	return n;
+}
+
 static struct ivi_layout_layer *
 ivi_layout_layer_create_with_dimension(uint32_t id_layer,
 				       int32_t width, int32_t height)
@@ -1271,7 +1536,7 @@ ivi_layout_layer_create_with_dimension(uint32_t id_layer,
 	struct ivi_layout *layout = get_instance();
 	struct ivi_layout_layer *ivilayer = NULL;
 
-	ivilayer = get_layer(&layout->layer_list, id_layer);
+	ivilayer = get_layer(layout, id_layer);
 	if (ivilayer != NULL) {
 		weston_log("id_layer is already created\n");
 		++ivilayer->ref_count;
@@ -1298,6 +1563,14 @@ ivi_layout_layer_create_with_dimension(uint32_t id_layer,
 	wl_list_init(&ivilayer->order.surface_list);
 	wl_list_init(&ivilayer->order.link);
 
+	wl_list_init(&ivilayer->dirty_link);
+
+	if (hash_table_insert(layout->layer_ids, id_layer, ivilayer) < 0) {
+		weston_log("fails to allocate memory\n");
+		free(ivilayer);
+		return NULL;
+	}
+
 	wl_list_insert(&layout->layer_list, &ivilayer->link);
 
 	wl_signal_emit(&layout->layer_notification.created, ivilayer);
@@ -1325,8 +1598,14 @@ ivi_layout_layer_destroy(struct ivi_layout_layer *ivilayer)
 
 	wl_list_remove(&ivilayer->pending.link);
 	wl_list_remove(&ivilayer->order.link);
+	wl_list_remove(&ivilayer->dirty_link);
 	wl_list_remove(&ivilayer->link);
 
+	/* The views of its surfaces must leave the layout layer. */
+	layout->view_list_dirty = true;
+
+	hash_table_remove(layout->layer_ids, ivilayer->id_layer);
+
 	free(ivilayer);
 }
 
@@ -1349,6 +1628,8 @@ ivi_layout_layer_set_visibility(struct ivi_layout_layer *ivilayer,
 	else
 		prop->event_mask &= ~IVI_NOTIFICATION_VISIBILITY;
 
+	layer_mark_dirty(ivilayer);
+
 	return IVI_SUCCEEDED;
 }
 
@@ -1373,6 +1654,8 @@ ivi_layout_layer_set_opacity(struct ivi_layout_layer *ivilayer,
 	else
 		prop->event_mask &= ~IVI_NOTIFICATION_OPACITY;
 
+	layer_mark_dirty(ivilayer);
+
 	return IVI_SUCCEEDED;
 }
 
@@ -1401,6 +1684,8 @@ ivi_layout_layer_set_source_rectangle(struct ivi_layout_layer *ivilayer,
 	else
 		prop->event_mask &= ~IVI_NOTIFICATION_SOURCE_RECT;
 
+	layer_mark_dirty(ivilayer);
+
 	return IVI_SUCCEEDED;
 }
 
@@ -1429,6 +1714,8 @@ ivi_layout_layer_set_destination_rectangle(struct ivi_layout_layer *ivilayer,
 	else
 		prop->event_mask &= ~IVI_NOTIFICATION_DEST_RECT;
 
+	layer_mark_dirty(ivilayer);
+
 	return IVI_SUCCEEDED;
 }
 
@@ -1451,6 +1738,8 @@ ivi_layout_layer_set_orientation(struct ivi_layout_layer *ivilayer,
 	else
 		prop->event_mask &= ~IVI_NOTIFICATION_ORIENTATION;
 
+	layer_mark_dirty(ivilayer);
+
 	return IVI_SUCCEEDED;
 }
 
@@ -1475,22 +1764,30 @@ ivi_layout_layer_set_render_order(struct ivi_layout_layer *ivilayer,
 	}
 
 	ivilayer->order.dirty = 1;
+	layer_mark_dirty(ivilayer);
 
 	return IVI_SUCCEEDED;
 }
 
-int32_t
-ivi_layout_surface_set_visibility(struct ivi_layout_surface *ivisurf,
-				  bool newVisibility)
+/*
+ * The surface property setters below are split into argument checking,
+ * done by the public entry points, and the pending state update, which
+ * ivi_layout_surface_set_properties() reuses after checking a whole
+ * batch up front.
+ */
+static bool
+opacity_is_valid(wl_fixed_t opacity)
 {
-	struct ivi_layout_surface_properties *prop = NULL;
+	return opacity >= wl_fixed_from_double(0.0) &&
+	       opacity <= wl_fixed_from_double(1.0);
+}
 
-	if (ivisurf == NULL) {
-		weston_log("ivi_layout_surface_set_visibility: invalid argument\n");
-		return IVI_FAILED;
-	}
+static void
+surface_pending_visibility(struct ivi_layout_surface *ivisurf,
+			   bool newVisibility)
+{
+	struct ivi_layout_surface_properties *prop = &ivisurf->pending.prop;
 
-	prop = &ivisurf->pending.prop;
 	prop->visibility = newVisibility;
 
 	if (ivisurf->prop.visibility != newVisibility)
@@ -1498,23 +1795,15 @@ ivi_layout_surface_set_visibility(struct ivi_layout_surface *ivisurf,
 	else
 		prop->event_mask &= ~IVI_NOTIFICATION_VISIBILITY;
 
-	return IVI_SUCCEEDED;
+	surface_mark_dirty(ivisurf);
 }
 
-int32_t
-ivi_layout_surface_set_opacity(struct ivi_layout_surface *ivisurf,
-			       wl_fixed_t opacity)
+static void
+surface_pending_opacity(struct ivi_layout_surface *ivisurf,
+			wl_fixed_t opacity)
 {
-	struct ivi_layout_surface_properties *prop = NULL;
-
-	if (ivisurf == NULL ||
-	    opacity < wl_fixed_from_double(0.0) ||
-	    wl_fixed_from_double(1.0) < opacity) {
-		weston_log("ivi_layout_surface_set_opacity: invalid argument\n");
-		return IVI_FAILED;
-	}
+	struct ivi_layout_surface_properties *prop = &ivisurf->pending.prop;
 
-	prop = &ivisurf->pending.prop;
 	prop->opacity = opacity;
 
 	if (ivisurf->prop.opacity != opacity)
@@ -1522,22 +1811,38 @@ ivi_layout_surface_set_opacity(struct ivi_layout_surface *ivisurf,
 	else
 		prop->event_mask &= ~IVI_NOTIFICATION_OPACITY;
 
-	return IVI_SUCCEEDED;
+	surface_mark_dirty(ivisurf);
 }
 
-int32_t
-ivi_layout_surface_set_destination_rectangle(struct ivi_layout_surface *ivisurf,
-					     int32_t x, int32_t y,
-					     int32_t width, int32_t height)
+static void
+surface_pending_source_rectangle(struct ivi_layout_surface *ivisurf,
+				 int32_t x, int32_t y,
+				 int32_t width, int32_t height)
 {
-	struct ivi_layout_surface_properties *prop = NULL;
+	struct ivi_layout_surface_properties *prop = &ivisurf->pending.prop;
 
-	if (ivisurf == NULL) {
-		weston_log("ivi_layout_surface_set_destination_rectangle: invalid argument\n");
-		return IVI_FAILED;
-	}
+	prop->source_x = x;
+	prop->source_y = y;
+	prop->source_width = width;
+	prop->source_height = height;
+
+	if (ivisurf->prop.source_x != x || ivisurf->prop.source_y != y ||
+	    ivisurf->prop.source_width != width ||
+	    ivisurf->prop.source_height != height)
+		prop->event_mask |= IVI_NOTIFICATION_SOURCE_RECT;
+	else
+		prop->event_mask &= ~IVI_NOTIFICATION_SOURCE_RECT;
+
+	surface_mark_dirty(ivisurf);
+}
+
+static void
+surface_pending_destination_rectangle(struct ivi_layout_surface *ivisurf,
+				      int32_t x, int32_t y,
+				      int32_t width, int32_t height)
+{
+	struct ivi_layout_surface_properties *prop = &ivisurf->pending.prop;
 
-	prop = &ivisurf->pending.prop;
 	prop->start_x = prop->dest_x;
 	prop->start_y = prop->dest_y;
 	prop->dest_x = x;
@@ -1554,6 +1859,65 @@ ivi_layout_surface_set_destination_rectangle(struct ivi_layout_surface *ivisurf,
 	else
 		prop->event_mask &= ~IVI_NOTIFICATION_DEST_RECT;
 
+	surface_mark_dirty(ivisurf);
+}
+
+static void
+surface_pending_orientation(struct ivi_layout_surface *ivisurf,
+			    enum wl_output_transform orientation)
+{
+	struct ivi_layout_surface_properties *prop = &ivisurf->pending.prop;
+
+	prop->orientation = orientation;
+
+	if (ivisurf->prop.orientation != orientation)
+		prop->event_mask |= IVI_NOTIFICATION_ORIENTATION;
+	else
+		prop->event_mask &= ~IVI_NOTIFICATION_ORIENTATION;
+
+	surface_mark_dirty(ivisurf);
+}
+
+int32_t
+ivi_layout_surface_set_visibility(struct ivi_layout_surface *ivisurf,
+				  bool newVisibility)
+{
+	if (ivisurf == NULL) {
+		weston_log("ivi_layout_surface_set_visibility: invalid argument\n");
+		return IVI_FAILED;
+	}
+
+	surface_pending_visibility(ivisurf, newVisibility);
+
+	return IVI_SUCCEEDED;
+}
+
+int32_t
+ivi_layout_surface_set_opacity(struct ivi_layout_surface *ivisurf,
+			       wl_fixed_t opacity)
+{
+	if (ivisurf == NULL || !opacity_is_valid(opacity)) {
+		weston_log("ivi_layout_surface_set_opacity: invalid argument\n");
+		return IVI_FAILED;
+	}
+
+	surface_pending_opacity(ivisurf, opacity);
+
+	return IVI_SUCCEEDED;
+}
+
+int32_t
+ivi_layout_surface_set_destination_rectangle(struct ivi_layout_surface *ivisurf,
+					     int32_t x, int32_t y,
+					     int32_t width, int32_t height)
+{
+	if (ivisurf == NULL) {
+		weston_log("ivi_layout_surface_set_destination_rectangle: invalid argument\n");
+		return IVI_FAILED;
+	}
+
+	surface_pending_destination_rectangle(ivisurf, x, y, width, height);
+
 	return IVI_SUCCEEDED;
 }
 
@@ -1561,20 +1925,12 @@ static int32_t
 ivi_layout_surface_set_orientation(struct ivi_layout_surface *ivisurf,
 				   enum wl_output_transform orientation)
 {
-	struct ivi_layout_surface_properties *prop = NULL;
-
 	if (ivisurf == NULL) {
 		weston_log("ivi_layout_surface_set_orientation: invalid argument\n");
 		return IVI_FAILED;
 	}
 
-	prop = &ivisurf->pending.prop;
-	prop->orientation = orientation;
-
-	if (ivisurf->prop.orientation != orientation)
-		prop->event_mask |= IVI_NOTIFICATION_ORIENTATION;
-	else
-		prop->event_mask &= ~IVI_NOTIFICATION_ORIENTATION;
+	surface_pending_orientation(ivisurf, orientation);
 
 	return IVI_SUCCEEDED;
 }
@@ -1721,6 +2077,7 @@ ivi_layout_layer_add_surface(struct ivi_layout_layer *ivilayer,
 	wl_list_insert(&ivilayer->pending.surface_list, &addsurf->pending.link);
 
 	ivilayer->order.dirty = 1;
+	layer_mark_dirty(ivilayer);
 
 	return IVI_SUCCEEDED;
 }
@@ -1738,6 +2095,7 @@ ivi_layout_layer_remove_surface(struct ivi_layout_layer *ivilayer,
 	wl_list_init(&remsurf->pending.link);
 
 	ivilayer->order.dirty = 1;
+	layer_mark_dirty(ivilayer);
 }
 
 static int32_t
@@ -1745,25 +2103,88 @@ ivi_layout_surface_set_source_rectangle(struct ivi_layout_surface *ivisurf,
 					int32_t x, int32_t y,
 					int32_t width, int32_t height)
 {
-	struct ivi_layout_surface_properties *prop = NULL;
-
 	if (ivisurf == NULL) {
 		weston_log("ivi_layout_surface_set_source_rectangle: invalid argument\n");
 		return IVI_FAILED;
 	}
 
-	prop = &ivisurf->pending.prop;
-	prop->source_x = x;
-	prop->source_y = y;
-	prop->source_width = width;
-	prop->source_height = height;
+	surface_pending_source_rectangle(ivisurf, x, y, width, height);
 
-	if (ivisurf->prop.source_x != x || ivisurf->prop.source_y != y ||
-	    ivisurf->prop.source_width != width ||
-	    ivisurf->prop.source_height != height)
-		prop->event_mask |= IVI_NOTIFICATION_SOURCE_RECT;
-	else
-		prop->event_mask &= ~IVI_NOTIFICATION_SOURCE_RECT;
+	return IVI_SUCCEEDED;
+}
+
+static bool
+surface_update_is_valid(const struct ivi_layout_surface_update *update)
+{
+	if (update->surface == NULL)
+		return false;
+
+	switch (update->property) {
+	case IVI_LAYOUT_SURFACE_VISIBILITY:
+	case IVI_LAYOUT_SURFACE_SOURCE_RECTANGLE:
+	case IVI_LAYOUT_SURFACE_DESTINATION_RECTANGLE:
+	case IVI_LAYOUT_SURFACE_ORIENTATION:
+		return true;
+	case IVI_LAYOUT_SURFACE_OPACITY:
+		return opacity_is_valid(update->value.opacity);
+	}
+
+	return false;
+}
+
+static int32_t
+ivi_layout_surface_set_properties(const struct ivi_layout_surface_update *updates,
+				  int32_t count)
+{
+	const struct ivi_layout_surface_update *update;
+	int32_t i;
+
+	if (count < 0 || (updates == NULL && count > 0)) {
+		weston_log("ivi_layout_surface_set_properties: invalid argument\n");
+		return IVI_FAILED;
+	}
+
+	/* all or nothing: reject the batch before touching any state */
+	for (i = 0; i < count; i++) {
+		if (!surface_update_is_valid(&updates[i])) {
+			weston_log("ivi_layout_surface_set_properties: "
+				   "invalid update %d\n", i);
+			return IVI_FAILED;
+		}
+	}
+
+	for (i = 0; i < count; i++) {
+		update = &updates[i];
+
+		switch (update->property) {
+		case IVI_LAYOUT_SURFACE_VISIBILITY:
+			surface_pending_visibility(update->surface,
+						   update->value.visibility);
+			break;
+		case IVI_LAYOUT_SURFACE_OPACITY:
+			surface_pending_opacity(update->surface,
+						update->value.opacity);
+			break;
+		case IVI_LAYOUT_SURFACE_SOURCE_RECTANGLE:
+			surface_pending_source_rectangle(update->surface,
+					update->value.rect.x,
+					update->value.rect.y,
+					update->value.rect.width,
+					update->value.rect.height);
+			break;
+		case IVI_LAYOUT_SURFACE_DESTINATION_RECTANGLE:
+			surface_pending_destination_rectangle(update->surface,
+					update->value.rect.x,
+					update->value.rect.y,
+					update->value.rect.width,
+					update->value.rect.height);
+			break;
+		case IVI_LAYOUT_SURFACE_ORIENTATION:
+			surface_pending_orientation(update->surface,
+						    update->value.orientation);
+			break;
+		}
+	}
 
 	return IVI_SUCCEEDED;
 }
@@ -1799,6 +2220,8 @@ ivi_layout_layer_set_transition(struct ivi_layout_layer *ivilayer,
 	ivilayer->pending.prop.transition_type = type;
 	ivilayer->pending.prop.transition_duration = duration;
 
+	layer_mark_dirty(ivilayer);
+
 	return 0;
 }
 
@@ -1816,6 +2239,8 @@ ivi_layout_layer_set_fade_info(struct ivi_layout_layer* ivilayer,
 	ivilayer->pending.prop.start_alpha = start_alpha;
 	ivilayer->pending.prop.end_alpha = end_alpha;
 
+	layer_mark_dirty(ivilayer);
+
 	return 0;
 }
 
@@ -1832,6 +2257,9 @@ ivi_layout_surface_set_transition_duration(struct ivi_layout_surface *ivisurf,
 
 	prop = &ivisurf->pending.prop;
 	prop->transition_duration = duration*10;
+
+	surface_mark_dirty(ivisurf);
+
 	return 0;
 }
 
@@ -1850,6 +2278,9 @@ ivi_layout_surface_set_transition(struct ivi_layout_surface *ivisurf,
 	prop = &ivisurf->pending.prop;
 	prop->transition_type = type;
 	prop->transition_duration = duration;
+
+	surface_mark_dirty(ivisurf);
+
 	return 0;
 }
 
@@ -1895,6 +2326,26 @@ ivi_layout_surface_configure(struct ivi_layout_surface *ivisurf,
 		       ivisurf);
 }
 
+/**
+ * Called when the wl_surface of ivi_surface gets a buffer while it is
+ * unmapped. Attaching a NULL buffer took the view out of the layout layer,
+ * the next commit has to put it back if the ivi_surface is shown.
+ */
+void
+ivi_layout_surface_remap(struct ivi_layout_surface *ivisurf)
+{
+	struct ivi_layout_layer *ivilayer = ivisurf->on_layer;
+	struct weston_view *view;
+
+	if (ivilayer == NULL || ivilayer->on_screen == NULL ||
+	    !ivilayer->prop.visibility || !ivisurf->prop.visibility)
+		return;
+
+	view = get_weston_view(ivisurf);
+	if (view != NULL && view->layer_link.layer == NULL)
+		ivisurf->layout->view_list_dirty = true;
+}
+
 struct ivi_layout_surface*
 ivi_layout_surface_create(struct weston_surface *wl_surface,
 			  uint32_t id_surface)
@@ -1908,7 +2359,7 @@ ivi_layout_surface_create(struct weston_surface *wl_surface,
 		return NULL;
 	}
 
-	ivisurf = get_surface(&layout->surface_list, id_surface);
+	ivisurf = get_surface(layout, id_surface);
 	if (ivisurf != NULL) {
 		if (ivisurf->surface != NULL) {
 			weston_log("id_surface(%d) is already created\n", id_surface);
@@ -1922,6 +2373,12 @@ ivi_layout_surface_create(struct weston_surface *wl_surface,
 		return NULL;
 	}
 
+	if (hash_table_insert(layout->surface_ids, id_surface, ivisurf) < 0) {
+		weston_log("fails to allocate memory\n");
+		free(ivisurf);
+		return NULL;
+	}
+
 	wl_signal_init(&ivisurf->property_changed);
 	ivisurf->id_surface = id_surface;
 	ivisurf->layout = layout;
@@ -1947,6 +2404,8 @@ ivi_layout_surface_create(struct weston_surface *wl_surface,
 	wl_list_init(&ivisurf->order.link);
 	wl_list_init(&ivisurf->order.layer_list);
 
+	wl_list_init(&ivisurf->dirty_link);
+
 	wl_list_insert(&layout->surface_list, &ivisurf->link);
 
 	wl_signal_emit(&layout->surface_notification.created, ivisurf);
@@ -1954,17 +2413,31 @@ ivi_layout_surface_create(struct weston_surface *wl_surface,
 	return ivisurf;
 }
 
-void
+int
 ivi_layout_init_with_compositor(struct weston_compositor *ec)
 {
 	struct ivi_layout *layout = get_instance();
 
+	layout->surface_ids = hash_table_create();
+	layout->layer_ids = hash_table_create();
+	if (!layout->surface_ids || !layout->layer_ids) {
+		weston_log("ivi-layout: failed to create the id tables\n");
+		hash_table_destroy(layout->surface_ids);
+		hash_table_destroy(layout->layer_ids);
+		layout->surface_ids = NULL;
+		layout->layer_ids = NULL;
+		return -1;
+	}
+
 	layout->compositor = ec;
 
 	wl_list_init(&layout->surface_list);
 	wl_list_init(&layout->layer_list);
 	wl_list_init(&layout->screen_list);
 
+	wl_list_init(&layout->dirty_surface_list);
+	wl_list_init(&layout->dirty_layer_list);
+
 	wl_signal_init(&layout->layer_notification.created);
 	wl_signal_init(&layout->layer_notification.removed);
 
@@ -1972,6 +2445,10 @@ ivi_layout_init_with_compositor(struct weston_compositor *ec)
 	wl_signal_init(&layout->surface_notification.removed);
 	wl_signal_init(&layout->surface_notification.configure_changed);
 
+	wl_signal_init(&layout->commit_notification);
+	wl_array_init(&layout->changed_surfaces);
+	wl_array_init(&layout->changed_layers);
+
 	/* Add layout_layer at the last of weston_compositor.layer_list */
 	weston_layer_init(&layout->layout_layer, ec->layer_list.prev);
 
@@ -1979,6 +2456,8 @@ ivi_layout_init_with_compositor(struct weston_compositor *ec)
 
 	layout->transitions = ivi_layout_transition_set_create(ec);
 	wl_list_init(&layout->pending_transition_list);
+
+	return 0;
 }
 
 static struct ivi_layout_interface ivi_layout_interface = {
@@ -2051,6 +2530,24 @@ static struct ivi_layout_interface ivi_layout_interface = {
 	 */
 	.surface_get_size		= ivi_layout_surface_get_size,
 	.surface_dump			= ivi_layout_surface_dump,
+
+	/**
+	 * non-allocating getters
+	 */
+	.get_surfaces_into		= ivi_layout_get_surfaces_into,
+	.get_surfaces_on_layer_into	= ivi_layout_get_surfaces_on_layer_into,
+	.get_layers_into		= ivi_layout_get_layers_into,
+	.get_layers_on_screen_into	= ivi_layout_get_layers_on_screen_into,
+
+	/**
+	 * batched surface property updates
+	 */
+	.surface_set_properties		= ivi_layout_surface_set_properties,
+
+	/**
+	 * coalesced property change notification
+	 */
+	.add_listener_commit		= ivi_layout_add_listener_commit,
 };
 
 int
@@ -134,6 +134,9 @@ ivi_shell_surface_configure(struct weston_surface *surface,
 	if (surface->width == 0 || surface->height == 0)
 		return;
 
+	if (!weston_surface_is_mapped(surface))
+		ivi_layout_surface_remap(ivisurf->layout_surface);
+
 	if (ivisurf->width != surface->width ||
 	    ivisurf->height != surface->height) {
 		ivisurf->width  = surface->width;
@@ -530,7 +533,9 @@ module_init(struct weston_compositor *compositor,
 			     shell, bind_ivi_application) == NULL)
 		goto out_settings;
 
-	ivi_layout_init_with_compositor(compositor);
+	if (ivi_layout_init_with_compositor(compositor) < 0)
+		goto out_settings;
+
 	shell_add_bindings(compositor, shell);
 
 	/* Call module_init of ivi-modules which are defined in weston.ini */
@@ -340,14 +340,20 @@ rounded_rect(cairo_t *cr, int x0, int y0, int x1, int y1, int radius)
 	cairo_close_path(cr);
 }
 
-cairo_surface_t *
-load_cairo_surface(const char *filename)
+static void
+unref_pixman_image(void *data)
+{
+	pixman_image_unref(data);
+}
+
+static cairo_surface_t *
+cairo_surface_from_pixman_image(pixman_image_t *image)
 {
-	pixman_image_t *image;
+	static cairo_user_data_key_t image_key;
+	cairo_surface_t *surface;
 	int width, height, stride;
 	void *data;
 
-	image = load_image(filename);
 	if (image == NULL) {
 		return NULL;
 	}
@@ -357,8 +363,30 @@ load_cairo_surface(const char *filename)
 	height = pixman_image_get_height(image);
 	stride = pixman_image_get_stride(image);
 
-	return cairo_image_surface_create_for_data(data, CAIRO_FORMAT_ARGB32,
-						   width, height, stride);
+	surface = cairo_image_surface_create_for_data(data,
+						      CAIRO_FORMAT_ARGB32,
+						      width, height, stride);
+
+	/* The pixels belong to the pixman image, keep it alive with the
+	 * surface. */
+	if (cairo_surface_set_user_data(surface, &image_key, image,
+					unref_pixman_image) !=
+	    CAIRO_STATUS_SUCCESS)
+		pixman_image_unref(image);
+
+	return surface;
+}
+
+cairo_surface_t *
+load_cairo_surface(const char *filename)
+{
+	return cairo_surface_from_pixman_image(load_image(filename));
+}
+
+cairo_surface_t *
+load_cairo_surface_finish(struct image_load *load)
+{
+	return cairo_surface_from_pixman_image(image_load_finish(load));
 }
 
 void
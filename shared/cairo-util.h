@@ -48,6 +48,12 @@ rounded_rect(cairo_t *cr, int x0, int y0, int x1, int y1, int radius);
 cairo_surface_t *
 load_cairo_surface(const char *filename);
 
+struct image_load;
+
+/* Finishes an image_load_start() and wraps the image in a surface. */
+cairo_surface_t *
+load_cairo_surface_finish(struct image_load *load);
+
 struct theme {
 	cairo_surface_t *active_frame;
 	cairo_surface_t *inactive_frame;
@@ -0,0 +1,279 @@
+/*
+ * Copyright © 2009 Intel Corporation
+ * Copyright © 1988-2004 Keith Packard and Bart Massey.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ *
+ * Except as contained in this notice, the names of the authors
+ * or their institutions shall not be used in advertising or
+ * otherwise to promote the sale, use or other dealings in this
+ * Software without prior written authorization from the
+ * authors.
+ *
+ * Authors:
+ *    Eric Anholt <eric@anholt.net>
+ *    Keith Packard <keithp@keithp.com>
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "hash.h"
+
+/*
+ * Open addressing with linear probing and Robin Hood insertion: an
+ * entry being inserted takes the slot of any entry that is closer to
+ * its home bucket, which keeps probe sequences short and lets a lookup
+ * stop as soon as it meets an entry closer to home than the key would
+ * be. Removal shifts the following entries of the probe sequence one
+ * slot back instead of leaving a tombstone, so the table never
+ * degrades with insert/remove churn.
+ */
+
+struct hash_entry {
+	uint32_t hash;
+	/* Distance from the home bucket plus one, 0 for a free slot */
+	uint32_t dist;
+	void *data;
+};
+
+struct hash_table {
+	struct hash_entry *table;
+	uint32_t size;
+	uint32_t shift;
+	uint32_t entries;
+};
+
+#define HASH_TABLE_MIN_SHIFT 3
+
+static uint32_t
+hash_table_bucket(struct hash_table *ht, uint32_t hash)
+{
+	/* Fibonacci hashing spreads the mostly sequential ids handed out
+	 * by X servers and ivi controllers over the whole table. */
+	return (hash * 2654435769u) >> (32 - ht->shift);
+}
+
+static void
+hash_table_place(struct hash_table *ht, uint32_t hash, void *data)
+{
+	struct hash_entry cur = { hash, 1, data }, tmp;
+	uint32_t mask = ht->size - 1;
+	uint32_t i = hash_table_bucket(ht, hash);
+
+	for (;;) {
+		struct hash_entry *entry = ht->table + i;
+
+		if (entry->dist == 0) {
+			*entry = cur;
+			ht->entries++;
+			return;
+		}
+
+		if (entry->dist < cur.dist) {
+			tmp = *entry;
+			*entry = cur;
+			cur = tmp;
+		}
+
+		i = (i + 1) & mask;
+		cur.dist++;
+	}
+}
+
+static int
+hash_table_resize(struct hash_table *ht, uint32_t shift)
+{
+	struct hash_table old_ht = *ht;
+	struct hash_entry *entry;
+
+	ht->table = calloc(1u << shift, sizeof(*ht->table));
+	if (ht->table == NULL) {
+		ht->table = old_ht.table;
+		return -1;
+	}
+
+	ht->shift = shift;
+	ht->size = 1u << shift;
+	ht->entries = 0;
+
+	for (entry = old_ht.table;
+	     entry != old_ht.table + old_ht.size;
+	     entry++) {
+		if (entry->dist != 0)
+			hash_table_place(ht, entry->hash, entry->data);
+	}
+
+	free(old_ht.table);
+
+	return 0;
+}
+
+struct hash_table *
+hash_table_create(void)
+{
+	struct hash_table *ht;
+
+	ht = malloc(sizeof(*ht));
+	if (ht == NULL)
+		return NULL;
+
+	ht->shift = HASH_TABLE_MIN_SHIFT;
+	ht->size = 1u << ht->shift;
+	ht->entries = 0;
+	ht->table = calloc(ht->size, sizeof(*ht->table));
+
+	if (ht->table == NULL) {
+		free(ht);
+		return NULL;
+	}
+
+	return ht;
+}
+
+/**
+ * Frees the given hash table.
+ */
+void
+hash_table_destroy(struct hash_table *ht)
+{
+	if (!ht)
+		return;
+
+	free(ht->table);
+	free(ht);
+}
+
+/**
+ * Finds the hash table entry with the given key.
+ *
+ * Returns NULL if no entry is found.
+ */
+static struct hash_entry *
+hash_table_search(struct hash_table *ht, uint32_t hash)
+{
+	uint32_t mask = ht->size - 1;
+	uint32_t i = hash_table_bucket(ht, hash);
+	uint32_t dist;
+
+	/* The table always has a free slot, which ends the loop. */
+	for (dist = 1; ; dist++) {
+		struct hash_entry *entry = ht->table + i;
+
+		if (entry->dist < dist)
+			return NULL;
+		if (entry->hash == hash)
+			return entry;
+
+		i = (i + 1) & mask;
+	}
+}
+
+void
+hash_table_for_each(struct hash_table *ht,
+		    hash_table_iterator_func_t func, void *data)
+{
+	struct hash_entry *entry;
+	uint32_t i;
+
+	for (i = 0; i < ht->size; i++) {
+		entry = ht->table + i;
+		if (entry->dist != 0)
+			func(entry->data, data);
+	}
+}
+
+void *
+hash_table_lookup(struct hash_table *ht, uint32_t hash)
+{
+	struct hash_entry *entry;
+
+	entry = hash_table_search(ht, hash);
+	if (entry != NULL)
+		return entry->data;
+
+	return NULL;
+}
+
+uint32_t
+hash_table_count(struct hash_table *ht)
+{
+	return ht->entries;
+}
+
+/**
+ * Inserts the data with the given key into the table, replacing the
+ * data of an existing entry with the same key.
+ *
+ * The table grows once it is 7/8 full. Returns -1 if it needs to and
+ * can't allocate the larger table.
+ */
+int
+hash_table_insert(struct hash_table *ht, uint32_t hash, void *data)
+{
+	struct hash_entry *entry;
+
+	entry = hash_table_search(ht, hash);
+	if (entry != NULL) {
+		entry->data = data;
+		return 0;
+	}
+
+	if ((ht->entries + 1) * 8 > ht->size * 7 &&
+	    (ht->shift == 31 || hash_table_resize(ht, ht->shift + 1) < 0) &&
+	    ht->entries + 1 >= ht->size)
+		return -1;
+
+	hash_table_place(ht, hash, data);
+
+	return 0;
+}
+
+/**
+ * Removes the entry with the given key, if any.
+ */
+void
+hash_table_remove(struct hash_table *ht, uint32_t hash)
+{
+	struct hash_entry *entry, *next;
+	uint32_t mask = ht->size - 1;
+	uint32_t i;
+
+	entry = hash_table_search(ht, hash);
+	if (entry == NULL)
+		return;
+
+	i = entry - ht->table;
+	for (;;) {
+		next = ht->table + ((i + 1) & mask);
+		if (next->dist <= 1)
+			break;
+
+		ht->table[i] = *next;
+		ht->table[i].dist--;
+		i = (i + 1) & mask;
+	}
+
+	ht->table[i].dist = 0;
+	ht->table[i].data = NULL;
+	ht->entries--;
+}
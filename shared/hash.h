@@ -32,18 +32,35 @@
  *    Keith Packard <keithp@keithp.com>
  */
 
-#ifndef HASH_H
-#define HASH_H
+#ifndef WESTON_HASH_H
+#define WESTON_HASH_H
 
+#include <stdint.h>
+
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+/* A table mapping 32-bit keys, e.g. X window or ivi ids, to pointers.
+ *
+ * Keys are unique: inserting a key that is already present replaces
+ * its data. The table must not be modified from a
+ * hash_table_for_each() callback.
+ */
 struct hash_table;
-struct hash_table *hash_table_create(void);
 typedef void (*hash_table_iterator_func_t)(void *element, void *data);
 
+struct hash_table *hash_table_create(void);
 void hash_table_destroy(struct hash_table *ht);
 void *hash_table_lookup(struct hash_table *ht, uint32_t hash);
 int hash_table_insert(struct hash_table *ht, uint32_t hash, void *data);
 void hash_table_remove(struct hash_table *ht, uint32_t hash);
+uint32_t hash_table_count(struct hash_table *ht);
 void hash_table_for_each(struct hash_table *ht,
 			 hash_table_iterator_func_t func, void *data);
 
+#ifdef  __cplusplus
+}
 #endif
+
+#endif /* WESTON_HASH_H */
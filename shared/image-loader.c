@@ -27,13 +27,19 @@
 #include "config.h"
 
 #include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
 #include <png.h>
 #include <pixman.h>
 
 #include "shared/helpers.h"
+#include "shared/zalloc.h"
 #include "image-loader.h"
 
 #ifdef HAVE_JPEG
@@ -56,6 +62,22 @@ pixman_image_destroy_func(pixman_image_t *image, void *data)
 	free(data);
 }
 
+/* The largest integer factor an image can be shrunk by while still
+ * covering min_width x min_height. A zero minimum leaves that
+ * dimension unconstrained. */
+static int
+reduction_factor(int width, int height, int min_width, int min_height)
+{
+	int fx = min_width > 0 ? width / min_width : INT_MAX;
+	int fy = min_height > 0 ? height / min_height : INT_MAX;
+	int f = MIN(fx, fy);
+
+	if (f == INT_MAX || f < 1)
+		return 1;
+
+	return f;
+}
+
 #ifdef HAVE_JPEG
 
 static void
@@ -80,13 +102,13 @@ error_exit(j_common_ptr cinfo)
 }
 
 static pixman_image_t *
-load_jpeg(FILE *fp)
+load_jpeg(FILE *fp, int min_width, int min_height)
 {
 	struct jpeg_decompress_struct cinfo;
 	struct jpeg_error_mgr jerr;
 	pixman_image_t *pixman_image = NULL;
 	unsigned int i;
-	int stride, first;
+	int stride, first, f;
 	JSAMPLE *data, *rows[4];
 	jmp_buf env;
 
@@ -102,7 +124,20 @@ load_jpeg(FILE *fp)
 
 	jpeg_read_header(&cinfo, TRUE);
 
+	/* The IDCT can produce 1/2, 1/4 or 1/8 of the image directly,
+	 * skipping most of the decoding work. */
+	f = reduction_factor(cinfo.image_width, cinfo.image_height,
+			     min_width, min_height);
+	cinfo.scale_num = 1;
+	cinfo.scale_denom = f >= 8 ? 8 : f >= 4 ? 4 : f >= 2 ? 2 : 1;
+
+#if defined(JCS_EXTENSIONS) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+	/* libjpeg-turbo writes our pixel format itself, with the padding
+	 * byte set to 0xff. */
+	cinfo.out_color_space = JCS_EXT_BGRX;
+#else
 	cinfo.out_color_space = JCS_RGB;
+#endif
 	jpeg_start_decompress(&cinfo);
 
 	stride = cinfo.output_width * 4;
@@ -118,6 +153,8 @@ load_jpeg(FILE *fp)
 			rows[i] = data + (first + i) * stride;
 
 		jpeg_read_scanlines(&cinfo, rows, ARRAY_LENGTH(rows));
+		if (cinfo.out_color_space != JCS_RGB)
+			continue;
 		for (i = 0; first + i < cinfo.output_scanline; i++)
 			swizzle_row(rows[i], cinfo.output_width);
 	}
@@ -140,7 +177,7 @@ load_jpeg(FILE *fp)
 #else
 
 static pixman_image_t *
-load_jpeg(FILE *fp)
+load_jpeg(FILE *fp, int min_width, int min_height)
 {
 	fprintf(stderr, "JPEG support disabled at compile-time\n");
 	return NULL;
@@ -148,43 +185,32 @@ load_jpeg(FILE *fp)
 
 #endif
 
-static inline int
-multiply_alpha(int alpha, int color)
-{
-    int temp = (alpha * color) + 0x80;
-
-    return ((temp + (temp >> 8)) >> 8);
-}
-
+/* Converts RGBA bytes, taking every step'th pixel, to premultiplied
+ * ARGB32. Red and blue are multiplied together in the two halves of one
+ * word, each rounded to the nearest of alpha * color / 255. */
 static void
-premultiply_data(png_structp   png,
-		 png_row_infop row_info,
-		 png_bytep     data)
+premultiply_row(uint32_t *dst, const png_byte *src, int width, int step)
 {
-    unsigned int i;
-    png_bytep p;
+	uint32_t alpha, rb, g;
+	int x;
 
-    for (i = 0, p = data; i < row_info->rowbytes; i += 4, p += 4) {
-	png_byte  alpha = p[3];
-	uint32_t w;
+	for (x = 0; x < width; x++, src += step * 4) {
+		alpha = src[3];
 
-	if (alpha == 0) {
-		w = 0;
-	} else {
-		png_byte red   = p[0];
-		png_byte green = p[1];
-		png_byte blue  = p[2];
-
-		if (alpha != 0xff) {
-			red   = multiply_alpha(alpha, red);
-			green = multiply_alpha(alpha, green);
-			blue  = multiply_alpha(alpha, blue);
+		if (alpha == 0xff) {
+			dst[x] = 0xff000000 | (src[0] << 16) | (src[1] << 8) |
+				 src[2];
+			continue;
 		}
-		w = (alpha << 24) | (red << 16) | (green << 8) | (blue << 0);
-	}
 
-	* (uint32_t *) p = w;
-    }
+		rb = (src[0] | (src[2] << 16)) * alpha + 0x00800080;
+		rb = ((rb + ((rb >> 8) & 0x00ff00ff)) >> 8) & 0x00ff00ff;
+		g = src[1] * alpha + 0x80;
+		g = ((g + (g >> 8)) >> 8) & 0xff;
+
+		dst[x] = (alpha << 24) | ((rb & 0xff) << 16) | (g << 8) |
+			 (rb >> 16);
+	}
 }
 
 static void
@@ -203,14 +229,15 @@ png_error_callback(png_structp png, png_const_charp error_msg)
 }
 
 static pixman_image_t *
-load_png(FILE *fp)
+load_png(FILE *fp, int min_width, int min_height)
 {
 	png_struct *png;
 	png_info *info;
 	png_byte *data = NULL;
+	png_byte *row = NULL;
 	png_byte **row_pointers = NULL;
-	png_uint_32 width, height;
-	int depth, color_type, interlace, stride;
+	png_uint_32 width, height, out_width, out_height;
+	int depth, color_type, interlace, stride, f;
 	unsigned int i;
 	pixman_image_t *pixman_image = NULL;
 
@@ -228,6 +255,8 @@ load_png(FILE *fp)
 	if (setjmp(png_jmpbuf(png))) {
 		if (data)
 			free(data);
+		if (row)
+			free(row);
 		if (row_pointers)
 			free(row_pointers);
 		png_destroy_read_struct(&png, &info, NULL);
@@ -263,38 +292,80 @@ load_png(FILE *fp)
 		png_set_interlace_handling(png);
 
 	png_set_filler(png, 0xff, PNG_FILLER_AFTER);
-	png_set_read_user_transform_fn(png, premultiply_data);
 	png_read_update_info(png, info);
 	png_get_IHDR(png, info,
 		     &width, &height, &depth,
 		     &color_type, &interlace, NULL, NULL);
 
-
-	stride = stride_for_width(width);
-	data = malloc(stride * height);
+	/* Every row has to be decompressed, but rows and columns we
+	 * drop are neither premultiplied nor stored. Interlaced images
+	 * need all passes in memory, so they are always read whole. */
+	if (interlace == PNG_INTERLACE_NONE)
+		f = reduction_factor(width, height, min_width, min_height);
+	else
+		f = 1;
+	out_width = (width + f - 1) / f;
+	out_height = (height + f - 1) / f;
+
+	stride = stride_for_width(out_width);
+	data = malloc(stride * out_height);
 	if (!data) {
 		png_destroy_read_struct(&png, &info, NULL);
 		return NULL;
 	}
 
-	row_pointers = malloc(height * sizeof row_pointers[0]);
-	if (row_pointers == NULL) {
-		free(data);
-		png_destroy_read_struct(&png, &info, NULL);
-		return NULL;
-	}
+	if (interlace != PNG_INTERLACE_NONE) {
+		row_pointers = malloc(height * sizeof row_pointers[0]);
+		if (row_pointers == NULL) {
+			free(data);
+			png_destroy_read_struct(&png, &info, NULL);
+			return NULL;
+		}
 
-	for (i = 0; i < height; i++)
-		row_pointers[i] = &data[i * stride];
+		for (i = 0; i < height; i++)
+			row_pointers[i] = &data[i * stride];
 
-	png_read_image(png, row_pointers);
-	png_read_end(png, info);
+		png_read_image(png, row_pointers);
 
-	free(row_pointers);
+		for (i = 0; i < height; i++)
+			premultiply_row((uint32_t *) row_pointers[i],
+					row_pointers[i], width, 1);
+
+		free(row_pointers);
+		row_pointers = NULL;
+	} else if (f == 1) {
+		/* Premultiply each row while it is still in cache. */
+		for (i = 0; i < height; i++) {
+			png_read_row(png, &data[i * stride], NULL);
+			premultiply_row((uint32_t *) &data[i * stride],
+					&data[i * stride], width, 1);
+		}
+	} else {
+		row = malloc(stride_for_width(width));
+		if (row == NULL) {
+			free(data);
+			png_destroy_read_struct(&png, &info, NULL);
+			return NULL;
+		}
+
+		for (i = 0; i < height; i++) {
+			png_read_row(png, row, NULL);
+			if (i % f == 0)
+				premultiply_row((uint32_t *)
+						&data[(i / f) * stride],
+						row, out_width, f);
+		}
+
+		free(row);
+		row = NULL;
+	}
+
+	png_read_end(png, info);
 	png_destroy_read_struct(&png, &info, NULL);
 
 	pixman_image = pixman_image_create_bits(PIXMAN_a8r8g8b8,
-				width, height, (uint32_t *) data, stride);
+				out_width, out_height, (uint32_t *) data,
+				stride);
 
 	pixman_image_set_destroy_function(pixman_image,
 				pixman_image_destroy_func, data);
@@ -305,13 +376,14 @@ load_png(FILE *fp)
 #ifdef HAVE_WEBP
 
 static pixman_image_t *
-load_webp(FILE *fp)
+load_webp(FILE *fp, int min_width, int min_height)
 {
 	WebPDecoderConfig config;
 	uint8_t buffer[16 * 1024];
-	int len;
+	int len, f, width, height;
 	VP8StatusCode status;
 	WebPIDecoder *idec;
+	pixman_image_t *pixman_image;
 
 	if (!WebPInitDecoderConfig(&config)) {
 		fprintf(stderr, "Library version mismatch!\n");
@@ -328,12 +400,22 @@ load_webp(FILE *fp)
 		return NULL;
 	}
 
-	config.output.colorspace = MODE_BGRA;
-	config.output.u.RGBA.stride = stride_for_width(config.input.width);
-	config.output.u.RGBA.size =
-		config.output.u.RGBA.stride * config.input.height;
-	config.output.u.RGBA.rgba =
-		malloc(config.output.u.RGBA.stride * config.input.height);
+	/* The decoder resamples while it decodes, to any size. */
+	width = config.input.width;
+	height = config.input.height;
+	f = reduction_factor(width, height, min_width, min_height);
+	if (f > 1) {
+		width = (width + f - 1) / f;
+		height = (height + f - 1) / f;
+		config.options.use_scaling = 1;
+		config.options.scaled_width = width;
+		config.options.scaled_height = height;
+	}
+
+	config.output.colorspace = MODE_bgrA;
+	config.output.u.RGBA.stride = stride_for_width(width);
+	config.output.u.RGBA.size = config.output.u.RGBA.stride * height;
+	config.output.u.RGBA.rgba = malloc(config.output.u.RGBA.size);
 	config.output.is_external_memory = 1;
 	if (!config.output.u.RGBA.rgba) {
 		WebPFreeDecBuffer(&config.output);
@@ -341,8 +423,9 @@ load_webp(FILE *fp)
 	}
 
 	rewind(fp);
-	idec = WebPINewDecoder(&config.output);
+	idec = WebPIDecode(NULL, 0, &config);
 	if (!idec) {
+		free(config.output.u.RGBA.rgba);
 		WebPFreeDecBuffer(&config.output);
 		return NULL;
 	}
@@ -350,9 +433,11 @@ load_webp(FILE *fp)
 	while (!feof(fp)) {
 		len = fread(buffer, 1, sizeof buffer, fp);
 		status = WebPIAppend(idec, buffer, len);
-		if (status != VP8_STATUS_OK) {
+		if (status != VP8_STATUS_OK &&
+		    status != VP8_STATUS_SUSPENDED) {
 			fprintf(stderr, "webp decode status %d\n", status);
 			WebPIDelete(idec);
+			free(config.output.u.RGBA.rgba);
 			WebPFreeDecBuffer(&config.output);
 			return NULL;
 		}
@@ -361,17 +446,22 @@ load_webp(FILE *fp)
 	WebPIDelete(idec);
 	WebPFreeDecBuffer(&config.output);
 
-	return pixman_image_create_bits(PIXMAN_a8r8g8b8,
-					config.input.width,
-					config.input.height,
+	pixman_image = pixman_image_create_bits(PIXMAN_a8r8g8b8,
+					width, height,
 					(uint32_t *) config.output.u.RGBA.rgba,
 					config.output.u.RGBA.stride);
+
+	pixman_image_set_destroy_function(pixman_image,
+				pixman_image_destroy_func,
+				config.output.u.RGBA.rgba);
+
+	return pixman_image;
 }
 
 #else
 
 static pixman_image_t *
-load_webp(FILE *fp)
+load_webp(FILE *fp, int min_width, int min_height)
 {
 	fprintf(stderr, "WebP support disabled at compile-time\n");
 	return NULL;
@@ -383,7 +473,7 @@ load_webp(FILE *fp)
 struct image_loader {
 	unsigned char header[4];
 	int header_size;
-	pixman_image_t *(*load)(FILE *fp);
+	pixman_image_t *(*load)(FILE *fp, int min_width, int min_height);
 };
 
 static const struct image_loader loaders[] = {
@@ -394,6 +484,12 @@ static const struct image_loader loaders[] = {
 
 pixman_image_t *
 load_image(const char *filename)
+{
+	return load_image_scaled(filename, 0, 0);
+}
+
+pixman_image_t *
+load_image_scaled(const char *filename, int min_width, int min_height)
 {
 	pixman_image_t *image;
 	unsigned char header[4];
@@ -419,7 +515,7 @@ load_image(const char *filename)
 	for (i = 0; i < ARRAY_LENGTH(loaders); i++) {
 		if (memcmp(header, loaders[i].header,
 			   loaders[i].header_size) == 0) {
-			image = loaders[i].load(fp);
+			image = loaders[i].load(fp, min_width, min_height);
 			break;
 		}
 	}
@@ -438,3 +534,82 @@ load_image(const char *filename)
 
 	return image;
 }
+
+struct image_load {
+	char *filename;
+	int min_width;
+	int min_height;
+	pixman_image_t *image;
+	pthread_t thread;
+	int fd;
+};
+
+static void *
+image_load_thread(void *data)
+{
+	struct image_load *load = data;
+	uint64_t one = 1;
+
+	load->image = load_image_scaled(load->filename,
+					load->min_width, load->min_height);
+
+	if (write(load->fd, &one, sizeof one) != sizeof one)
+		fprintf(stderr, "%s: failed to signal completion: %s\n",
+			load->filename, strerror(errno));
+
+	return NULL;
+}
+
+struct image_load *
+image_load_start(const char *filename, int min_width, int min_height)
+{
+	struct image_load *load;
+
+	if (!filename || !*filename)
+		return NULL;
+
+	load = zalloc(sizeof *load);
+	if (!load)
+		return NULL;
+
+	load->filename = strdup(filename);
+	load->min_width = min_width;
+	load->min_height = min_height;
+	load->fd = eventfd(0, EFD_CLOEXEC);
+	if (!load->filename || load->fd < 0)
+		goto err;
+
+	if (pthread_create(&load->thread, NULL, image_load_thread, load) != 0)
+		goto err;
+
+	return load;
+
+err:
+	if (load->fd >= 0)
+		close(load->fd);
+	free(load->filename);
+	free(load);
+
+	return NULL;
+}
+
+int
+image_load_get_fd(struct image_load *load)
+{
+	return load->fd;
+}
+
+pixman_image_t *
+image_load_finish(struct image_load *load)
+{
+	pixman_image_t *image;
+
+	pthread_join(load->thread, NULL);
+	image = load->image;
+
+	close(load->fd);
+	free(load->filename);
+	free(load);
+
+	return image;
+}
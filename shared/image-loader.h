@@ -31,4 +31,26 @@
 pixman_image_t *
 load_image(const char *filename);
 
+/* Like load_image(), but the decoder may drop detail the image does not
+ * need to cover min_width x min_height, keeping the aspect ratio. JPEG
+ * and WebP then decode at the smaller size directly. A zero minimum
+ * leaves that dimension unconstrained. */
+pixman_image_t *
+load_image_scaled(const char *filename, int min_width, int min_height);
+
+struct image_load;
+
+/* Decodes with load_image_scaled() on a worker thread. The fd becomes
+ * readable once the image is ready, image_load_finish() then returns it
+ * (or NULL on failure) and frees the load. Finishing early blocks until
+ * the decode is done. */
+struct image_load *
+image_load_start(const char *filename, int min_width, int min_height);
+
+int
+image_load_get_fd(struct image_load *load);
+
+pixman_image_t *
+image_load_finish(struct image_load *load);
+
 #endif
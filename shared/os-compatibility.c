@@ -31,9 +31,15 @@
 #include <fcntl.h>
 #include <errno.h>
 #include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/ioctl.h>
 #include <string.h>
 #include <stdlib.h>
 
+#ifdef HAVE_LINUX_UDMABUF_H
+#include <linux/udmabuf.h>
+#endif
+
 #include "os-compatibility.h"
 
 int
@@ -136,7 +142,9 @@ create_tmpfile_cloexec(char *tmpname)
  * The file should not have a permanent backing store like a disk,
  * but may have if XDG_RUNTIME_DIR is not properly implemented in OS.
  *
- * The file name is deleted from the file system.
+ * The file name is deleted from the file system. If the C library
+ * provides memfd_create(), a memfd allowing seals is used instead and
+ * there is no file name at all, see os_seal_anonymous_file().
  *
  * The file is suitable for buffer sharing between processes by
  * transmitting the file descriptor over Unix sockets using the
@@ -154,28 +162,34 @@ os_create_anonymous_file(off_t size)
 	static const char template[] = "/weston-shared-XXXXXX";
 	const char *path;
 	char *name;
-	int fd;
+	int fd = -1;
 	int ret;
 
-	path = getenv("XDG_RUNTIME_DIR");
-	if (!path) {
-		errno = ENOENT;
-		return -1;
-	}
+#ifdef HAVE_MEMFD_CREATE
+	fd = memfd_create("weston-shared", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+#endif
 
-	name = malloc(strlen(path) + sizeof(template));
-	if (!name)
-		return -1;
+	if (fd < 0) {
+		path = getenv("XDG_RUNTIME_DIR");
+		if (!path) {
+			errno = ENOENT;
+			return -1;
+		}
 
-	strcpy(name, path);
-	strcat(name, template);
+		name = malloc(strlen(path) + sizeof(template));
+		if (!name)
+			return -1;
 
-	fd = create_tmpfile_cloexec(name);
+		strcpy(name, path);
+		strcat(name, template);
 
-	free(name);
+		fd = create_tmpfile_cloexec(name);
 
-	if (fd < 0)
-		return -1;
+		free(name);
+
+		if (fd < 0)
+			return -1;
+	}
 
 #ifdef HAVE_POSIX_FALLOCATE
 	ret = posix_fallocate(fd, 0, size);
@@ -195,6 +209,69 @@ os_create_anonymous_file(off_t size)
 	return fd;
 }
 
+/*
+ * Make a file returned by os_create_anonymous_file() immutable: its
+ * size and contents can no longer change, so it can be handed out to
+ * any number of clients that map it read-only. There must be no
+ * writable shared mapping of the file left when this is called.
+ *
+ * Returns 0 on success, or -1 if the file could not be sealed, either
+ * because it is not a memfd or because the kernel lacks file sealing.
+ * The file stays usable in that case, it is just not protected
+ * against modification by the clients it is shared with.
+ */
+int
+os_seal_anonymous_file(int fd)
+{
+#ifdef F_ADD_SEALS
+	return fcntl(fd, F_ADD_SEALS,
+		     F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL);
+#else
+	errno = ENOSYS;
+	return -1;
+#endif
+}
+
+/*
+ * Wrap part of a file returned by os_create_anonymous_file() into a
+ * dma-buf through the kernel's udmabuf driver, so that the memory can be
+ * shared with a GPU driver instead of being copied. offset and size must
+ * be multiples of the page size. The file is sealed against shrinking,
+ * which udmabuf requires; it stays writable.
+ *
+ * Returns the dma-buf file descriptor, set CLOEXEC, or -1 with errno set
+ * if the file is not a memfd or udmabuf is not available.
+ */
+int
+os_create_udmabuf(int fd, off_t offset, off_t size)
+{
+#if defined(HAVE_LINUX_UDMABUF_H) && defined(F_ADD_SEALS)
+	struct udmabuf_create create;
+	int dev, dmabuf;
+
+	if (fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK) < 0)
+		return -1;
+
+	dev = open("/dev/udmabuf", O_RDWR | O_CLOEXEC);
+	if (dev < 0)
+		return -1;
+
+	memset(&create, 0, sizeof create);
+	create.memfd = fd;
+	create.flags = UDMABUF_FLAGS_CLOEXEC;
+	create.offset = offset;
+	create.size = size;
+
+	dmabuf = ioctl(dev, UDMABUF_CREATE, &create);
+	close(dev);
+
+	return dmabuf;
+#else
+	errno = ENOSYS;
+	return -1;
+#endif
+}
+
 #ifndef HAVE_STRCHRNUL
 char *
 strchrnul(const char *s, int c)
@@ -52,6 +52,12 @@ os_epoll_create_cloexec(void);
 int
 os_create_anonymous_file(off_t size);
 
+int
+os_seal_anonymous_file(int fd);
+
+int
+os_create_udmabuf(int fd, off_t offset, off_t size);
+
 #ifndef HAVE_STRCHRNUL
 char *
 strchrnul(const char *s, int c);
@@ -35,14 +35,28 @@
 #include "compositor.h"
 #include "shared/helpers.h"
 
+/* Upper bound on the size of the clipboard contents kept around after
+ * the client owning the selection goes away. */
+#define CLIPBOARD_MAX_CONTENTS (64 * 1024 * 1024)
+#define CLIPBOARD_READ_SIZE (64 * 1024)
+
 struct clipboard_source {
 	struct weston_data_source base;
 	struct wl_array contents;
 	struct clipboard *clipboard;
 	struct wl_event_source *event_source;
+	struct wl_list client_list; /* clipboard_client::link */
 	uint32_t serial;
 	int refcount;
 	int fd;
+	bool failed;
+};
+
+struct clipboard_client {
+	struct wl_event_source *event_source;
+	struct wl_list link; /* clipboard_source::client_list */
+	size_t offset;
+	struct clipboard_source *source;
 };
 
 struct clipboard {
@@ -76,33 +90,75 @@ clipboard_source_unref(struct clipboard_source *source)
 	free(source);
 }
 
+/* Let the clients waiting for the source to be read completely know
+ * that the contents can be sent, or that there won't be any. */
+static void
+clipboard_source_wake_clients(struct clipboard_source *source)
+{
+	struct clipboard_client *client;
+
+	wl_list_for_each(client, &source->client_list, link)
+		wl_event_source_fd_update(client->event_source,
+					  WL_EVENT_WRITABLE);
+}
+
+static void
+clipboard_source_finish(struct clipboard_source *source)
+{
+	wl_event_source_remove(source->event_source);
+	close(source->fd);
+	source->event_source = NULL;
+	clipboard_source_wake_clients(source);
+}
+
 static int
 clipboard_source_data(int fd, uint32_t mask, void *data)
 {
 	struct clipboard_source *source = data;
 	struct clipboard *clipboard = source->clipboard;
 	char *p;
-	int len, size;
+	ssize_t len;
+	size_t size;
 
-	if (source->contents.alloc - source->contents.size < 1024) {
-		wl_array_add(&source->contents, 1024);
-		source->contents.size -= 1024;
+	/* wl_array grows geometrically, so this only reallocates
+	 * O(log n) times for n bytes of contents. */
+	if (source->contents.alloc - source->contents.size <
+	    CLIPBOARD_READ_SIZE) {
+		if (!wl_array_add(&source->contents, CLIPBOARD_READ_SIZE))
+			goto fail;
+		source->contents.size -= CLIPBOARD_READ_SIZE;
 	}
 
-	p = source->contents.data + source->contents.size;
+	p = (char *) source->contents.data + source->contents.size;
 	size = source->contents.alloc - source->contents.size;
 	len = read(fd, p, size);
 	if (len == 0) {
-		wl_event_source_remove(source->event_source);
-		close(fd);
-		source->event_source = NULL;
+		clipboard_source_finish(source);
 	} else if (len < 0) {
-		clipboard_source_unref(source);
-		clipboard->source = NULL;
+		goto fail;
+	} else if (source->contents.size + len > CLIPBOARD_MAX_CONTENTS) {
+		weston_log("clipboard contents exceed %d bytes, "
+			   "not keeping them\n", CLIPBOARD_MAX_CONTENTS);
+		goto fail;
 	} else {
 		source->contents.size += len;
 	}
 
+	return 1;
+
+fail:
+	source->failed = true;
+	wl_array_release(&source->contents);
+	wl_array_init(&source->contents);
+	clipboard_source_finish(source);
+
+	/* The clipboard may have dropped this source for a newer one
+	 * already, with clients still holding on to it. */
+	if (clipboard->source == source) {
+		clipboard->source = NULL;
+		clipboard_source_unref(source);
+	}
+
 	return 1;
 }
 
@@ -152,6 +208,7 @@ clipboard_source_create(struct clipboard *clipboard,
 	source->base.send = clipboard_source_send;
 	source->base.cancel = clipboard_source_cancel;
 	wl_signal_init(&source->base.destroy_signal);
+	wl_list_init(&source->client_list);
 	source->refcount = 1;
 	source->clipboard = clipboard;
 	source->serial = serial;
@@ -181,33 +238,57 @@ clipboard_source_create(struct clipboard *clipboard,
 	return NULL;
 }
 
-struct clipboard_client {
-	struct wl_event_source *event_source;
-	size_t offset;
-	struct clipboard_source *source;
-};
+static void
+clipboard_client_destroy(struct clipboard_client *client, int fd)
+{
+	close(fd);
+	wl_event_source_remove(client->event_source);
+	wl_list_remove(&client->link);
+	clipboard_source_unref(client->source);
+	free(client);
+}
 
 static int
 clipboard_client_data(int fd, uint32_t mask, void *data)
 {
 	struct clipboard_client *client = data;
+	struct clipboard_source *source = client->source;
 	char *p;
 	size_t size;
-	int len;
+	ssize_t len = 0;
 
-	size = client->source->contents.size;
-	p = client->source->contents.data;
-	len = write(fd, p + client->offset, size - client->offset);
-	if (len > 0)
-		client->offset += len;
+	/* Nothing has been written to the client yet, so closing its fd
+	 * refuses the paste rather than truncating it. */
+	if (source->failed) {
+		clipboard_client_destroy(client, fd);
+		return 1;
+	}
 
-	if (client->offset == size || len <= 0) {
-		close(fd);
-		wl_event_source_remove(client->event_source);
-		clipboard_source_unref(client->source);
-		free(client);
+	/* Only send the contents once they are known to fit under
+	 * CLIPBOARD_MAX_CONTENTS, a client must never take a cut off
+	 * copy for the whole selection. Wait for
+	 * clipboard_source_wake_clients(). */
+	if (source->event_source) {
+		wl_event_source_fd_update(client->event_source, 0);
+		return 1;
 	}
 
+	size = source->contents.size;
+	p = source->contents.data;
+	if (client->offset < size) {
+		len = write(fd, p + client->offset, size - client->offset);
+		if (len < 0) {
+			clipboard_client_destroy(client, fd);
+			return 1;
+		}
+		client->offset += len;
+	}
+
+	if (client->offset < size)
+		return 1;
+
+	clipboard_client_destroy(client, fd);
+
 	return 1;
 }
 
@@ -223,11 +304,18 @@ clipboard_client_create(struct clipboard_source *source, int fd)
 	if (client == NULL)
 		return;
 
-	client->source = source;
-	source->refcount++;
 	client->event_source =
 		wl_event_loop_add_fd(loop, fd, WL_EVENT_WRITABLE,
 				     clipboard_client_data, client);
+	if (client->event_source == NULL) {
+		close(fd);
+		free(client);
+		return;
+	}
+
+	client->source = source;
+	source->refcount++;
+	wl_list_insert(&source->client_list, &client->link);
 }
 
 static void
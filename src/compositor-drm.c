@@ -187,8 +187,8 @@ struct drm_output {
 
 	struct drm_fb *dumb[2];
 	pixman_image_t *image[2];
+	bool image_painted[2];
 	int current_image;
-	pixman_region32_t previous_damage;
 
 	struct vaapi_recorder *recorder;
 	struct wl_listener recorder_frame_listener;
@@ -540,26 +540,21 @@ static void
 drm_output_render_pixman(struct drm_output *output, pixman_region32_t *damage)
 {
 	struct weston_compositor *ec = output->base.compositor;
-	pixman_region32_t total_damage, previous_damage;
-
-	pixman_region32_init(&total_damage);
-	pixman_region32_init(&previous_damage);
-
-	pixman_region32_copy(&previous_damage, damage);
-
-	pixman_region32_union(&total_damage, damage, &output->previous_damage);
-	pixman_region32_copy(&output->previous_damage, &previous_damage);
+	int i;
 
 	output->current_image ^= 1;
+	i = output->current_image;
 
-	output->next = output->dumb[output->current_image];
-	pixman_renderer_output_set_buffer(&output->base,
-					  output->image[output->current_image]);
+	output->next = output->dumb[i];
+	pixman_renderer_output_set_buffer(&output->base, output->image[i]);
 
-	ec->renderer->repaint_output(&output->base, &total_damage);
+	/* The two dumb buffers are flipped in turn, so a buffer we painted
+	 * before holds the frame before last. */
+	pixman_renderer_output_set_buffer_age(&output->base,
+					      output->image_painted[i] ? 2 : 0);
+	output->image_painted[i] = true;
 
-	pixman_region32_fini(&total_damage);
-	pixman_region32_fini(&previous_damage);
+	ec->renderer->repaint_output(&output->base, damage);
 }
 
 static void
@@ -1896,11 +1891,13 @@ drm_output_init_pixman(struct drm_output *output, struct drm_backend *b)
 			goto err;
 	}
 
-	if (pixman_renderer_output_create(&output->base) < 0)
+	/* Dumb buffers are write-combined, too slow to blend in. */
+	if (pixman_renderer_output_create(&output->base,
+					  PIXMAN_RENDERER_OUTPUT_USE_SHADOW) < 0)
 		goto err;
 
-	pixman_region32_init_rect(&output->previous_damage,
-				  output->base.x, output->base.y, output->base.width, output->base.height);
+	output->image_painted[0] = false;
+	output->image_painted[1] = false;
 
 	return 0;
 
@@ -1924,7 +1921,6 @@ drm_output_fini_pixman(struct drm_output *output)
 	unsigned int i;
 
 	pixman_renderer_output_destroy(&output->base);
-	pixman_region32_fini(&output->previous_damage);
 
 	for (i = 0; i < ARRAY_LENGTH(output->dumb); i++) {
 		drm_fb_destroy_dumb(output->dumb[i]);
@@ -50,8 +50,10 @@ struct headless_output {
 
 	struct weston_mode mode;
 	struct wl_event_source *finish_frame_timer;
-	uint32_t *image_buf;
-	pixman_image_t *image;
+	uint32_t *image_buf[2];
+	pixman_image_t *image[2];
+	bool image_painted[2];
+	int current_image;
 };
 
 static void
@@ -81,6 +83,21 @@ headless_output_repaint(struct weston_output *output_base,
 {
 	struct headless_output *output = (struct headless_output *) output_base;
 	struct weston_compositor *ec = output->base.compositor;
+	struct headless_backend *b = (struct headless_backend *) ec->backend;
+	int i;
+
+	if (b->use_pixman) {
+		/* Flip between two images like a double-buffered display
+		 * would, so repaints go through the buffer age path. */
+		output->current_image ^= 1;
+		i = output->current_image;
+
+		pixman_renderer_output_set_buffer(&output->base,
+						  output->image[i]);
+		pixman_renderer_output_set_buffer_age(&output->base,
+					output->image_painted[i] ? 2 : 0);
+		output->image_painted[i] = true;
+	}
 
 	ec->renderer->repaint_output(&output->base, damage);
 
@@ -98,13 +115,16 @@ headless_output_destroy(struct weston_output *output_base)
 	struct headless_output *output = (struct headless_output *) output_base;
 	struct headless_backend *b =
 			(struct headless_backend *) output->base.compositor->backend;
+	unsigned int i;
 
 	wl_event_source_remove(output->finish_frame_timer);
 
 	if (b->use_pixman) {
 		pixman_renderer_output_destroy(&output->base);
-		pixman_image_unref(output->image);
-		free(output->image_buf);
+		for (i = 0; i < ARRAY_LENGTH(output->image); i++) {
+			pixman_image_unref(output->image[i]);
+			free(output->image_buf[i]);
+		}
 	}
 
 	weston_output_destroy(&output->base);
@@ -121,6 +141,7 @@ headless_backend_create_output(struct headless_backend *b,
 	struct weston_compositor *c = b->compositor;
 	struct headless_output *output;
 	struct wl_event_loop *loop;
+	unsigned int i;
 
 	output = zalloc(sizeof *output);
 	if (output == NULL)
@@ -154,21 +175,25 @@ headless_backend_create_output(struct headless_backend *b,
 	output->base.switch_mode = NULL;
 
 	if (b->use_pixman) {
-		output->image_buf = malloc(config->width * config->height * 4);
-		if (!output->image_buf)
-			return -1;
-
-		output->image = pixman_image_create_bits(PIXMAN_x8r8g8b8,
+		for (i = 0; i < ARRAY_LENGTH(output->image); i++) {
+			output->image_buf[i] =
+				malloc(config->width * config->height * 4);
+			if (!output->image_buf[i])
+				return -1;
+
+			output->image[i] =
+				pixman_image_create_bits(PIXMAN_x8r8g8b8,
 							 config->width,
 							 config->height,
-							 output->image_buf,
+							 output->image_buf[i],
 							 config->width * 4);
+		}
 
-		if (pixman_renderer_output_create(&output->base) < 0)
+		if (pixman_renderer_output_create(&output->base, 0) < 0)
 			return -1;
 
 		pixman_renderer_output_set_buffer(&output->base,
-						  output->image);
+						  output->image[0]);
 	}
 
 	weston_compositor_add_output(c, &output->base);
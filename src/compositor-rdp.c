@@ -430,7 +430,7 @@ rdp_switch_mode(struct weston_output *output, struct weston_mode *target_mode)
 	output->current_mode->flags |= WL_OUTPUT_MODE_CURRENT;
 
 	pixman_renderer_output_destroy(output);
-	pixman_renderer_output_create(output);
+	pixman_renderer_output_create(output, 0);
 
 	new_shadow_buffer = pixman_image_create_bits(PIXMAN_x8r8g8b8, target_mode->width,
 			target_mode->height, 0, target_mode->width * 4);
@@ -496,7 +496,7 @@ rdp_backend_create_output(struct rdp_backend *b, int width, int height)
 		goto out_output;
 	}
 
-	if (pixman_renderer_output_create(&output->base) < 0)
+	if (pixman_renderer_output_create(&output->base, 0) < 0)
 		goto out_shadow_surface;
 
 	loop = wl_display_get_event_loop(b->compositor->wl_display);
@@ -282,7 +282,7 @@ wayland_output_get_shm_buffer(struct wayland_output *output)
 	wl_list_init(&sb->free_link);
 	wl_list_insert(&output->shm.buffers, &sb->link);
 
-	pixman_region32_init_rect(&sb->damage, 0, 0,
+	pixman_region32_init_rect(&sb->damage, output->base.x, output->base.y,
 				  output->base.width, output->base.height);
 	sb->frame_damaged = 1;
 
@@ -676,7 +676,7 @@ cleanup_window:
 static int
 wayland_output_init_pixman_renderer(struct wayland_output *output)
 {
-	return pixman_renderer_output_create(&output->base);
+	return pixman_renderer_output_create(&output->base, 0);
 }
 
 static void
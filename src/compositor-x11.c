@@ -918,7 +918,7 @@ x11_backend_create_output(struct x11_backend *b, int x, int y,
 			weston_log("Failed to initialize SHM for the X11 output\n");
 			return NULL;
 		}
-		if (pixman_renderer_output_create(&output->base) < 0) {
+		if (pixman_renderer_output_create(&output->base, 0) < 0) {
 			weston_log("Failed to create pixman renderer for output\n");
 			x11_output_deinit_shm(b, output);
 			return NULL;
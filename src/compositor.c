@@ -1147,6 +1147,75 @@ weston_view_update_transform_disable(struct weston_view *view)
 	}
 }
 
+/*
+ * Sums up the transformation list if it only translates, as the shells'
+ * slide animations do. Fractional offsets need the full path, to get the
+ * bounding box rounded outwards.
+ */
+static bool
+weston_view_transform_is_translation(struct weston_view *view,
+				     float *tx, float *ty)
+{
+	struct weston_transform *tform;
+	float x = view->geometry.x;
+	float y = view->geometry.y;
+
+	wl_list_for_each(tform, &view->geometry.transformation_list, link) {
+		if (tform == &view->transform.position)
+			continue;
+		if (tform->matrix.type & ~WESTON_MATRIX_TRANSFORM_TRANSLATE)
+			return false;
+
+		x += tform->matrix.d[12];
+		y += tform->matrix.d[13];
+	}
+
+	if (x != floorf(x) || y != floorf(y))
+		return false;
+
+	*tx = x;
+	*ty = y;
+
+	return true;
+}
+
+/* Like weston_view_update_transform_disable(), but keeps geometry.x/y as
+ * they are and the view marked as transformed. */
+static void
+weston_view_update_transform_translate(struct weston_view *view,
+				       float tx, float ty)
+{
+	view->transform.enabled = 1;
+
+	view->transform.position.matrix.type = WESTON_MATRIX_TRANSFORM_TRANSLATE;
+	view->transform.position.matrix.d[12] = view->geometry.x;
+	view->transform.position.matrix.d[13] = view->geometry.y;
+
+	weston_matrix_init(&view->transform.matrix);
+	weston_matrix_translate(&view->transform.matrix, tx, ty, 0);
+
+	weston_matrix_init(&view->transform.inverse);
+	weston_matrix_translate(&view->transform.inverse, -tx, -ty, 0);
+
+	pixman_region32_init_rect(&view->transform.boundingbox,
+				  0, 0,
+				  view->surface->width,
+				  view->surface->height);
+	if (view->geometry.scissor_enabled)
+		pixman_region32_intersect(&view->transform.boundingbox,
+					  &view->transform.boundingbox,
+					  &view->geometry.scissor);
+
+	pixman_region32_translate(&view->transform.boundingbox, tx, ty);
+
+	/* whole pixel offsets keep the opaque region exact */
+	if (view->alpha == 1.0) {
+		pixman_region32_copy(&view->transform.opaque,
+				     &view->surface->opaque);
+		pixman_region32_translate(&view->transform.opaque, tx, ty);
+	}
+}
+
 static int
 weston_view_update_transform_enable(struct weston_view *view)
 {
@@ -1205,6 +1274,7 @@ weston_view_update_transform(struct weston_view *view)
 	struct weston_view *parent = view->geometry.parent;
 	struct weston_layer *layer;
 	pixman_region32_t mask;
+	float tx, ty;
 
 	if (!view->transform.dirty)
 		return;
@@ -1227,6 +1297,9 @@ weston_view_update_transform(struct weston_view *view)
 	    &view->transform.position.link &&
 	    !parent) {
 		weston_view_update_transform_disable(view);
+	} else if (!parent &&
+		   weston_view_transform_is_translation(view, &tx, &ty)) {
+		weston_view_update_transform_translate(view, tx, ty);
 	} else {
 		if (weston_view_update_transform_enable(view) < 0)
 			weston_view_update_transform_disable(view);
@@ -1930,6 +2003,7 @@ weston_surface_attach(struct weston_surface *surface,
 	}
 
 	surface->compositor->renderer->attach(surface, buffer);
+	surface->content_serial++;
 
 	weston_surface_calculate_size_from_buffer(surface);
 	weston_presentation_feedback_discard_list(&surface->feedback_list);
@@ -1955,6 +2029,106 @@ weston_output_damage(struct weston_output *output)
 	weston_output_schedule_repaint(output);
 }
 
+static int
+output_read_pixels_timer_handler(void *data)
+{
+	struct weston_output *output = data;
+
+	weston_output_flush_read_pixels(output);
+
+	return 0;
+}
+
+/** Read back output contents without waiting for the renderer
+ *
+ * \param output The output to read from.
+ * \param format The pixel format, see weston_compositor::read_format.
+ * \param x The x coordinate of the rectangle to read.
+ * \param y The y coordinate of the rectangle to read.
+ * \param width The width of the rectangle to read.
+ * \param height The height of the rectangle to read.
+ * \param done Called with the pixels once they are available.
+ * \param data User data passed to \c done.
+ * \return 0 on success, -1 if the read could not be started.
+ *
+ * This reads the same pixels as weston_renderer::read_pixels() would if
+ * called at this point, typically from a frame_signal handler, but the
+ * renderer can complete the copy in the background. The rectangle and
+ * the layout of the pixels passed to \c done follow read_pixels(); the
+ * rows are \c stride bytes apart. The pixels are only valid during the
+ * call to \c done, and are NULL if the read failed.
+ *
+ * \c done is called in request order, at the latest after about one
+ * refresh period, or when weston_output_flush_read_pixels() is called.
+ * Renderers without asynchronous read-back call it before this function
+ * returns. \c done must not start new reads on the same output.
+ */
+WL_EXPORT int
+weston_output_read_pixels_async(struct weston_output *output,
+				pixman_format_code_t format,
+				uint32_t x, uint32_t y,
+				uint32_t width, uint32_t height,
+				weston_read_pixels_func_t done, void *data)
+{
+	struct weston_renderer *renderer = output->compositor->renderer;
+	int32_t stride = width * (PIXMAN_FORMAT_BPP(format) / 8);
+	uint32_t refresh_msec;
+	void *pixels;
+	int ret;
+
+	if (renderer->read_pixels_async) {
+		ret = renderer->read_pixels_async(output, format,
+						  x, y, width, height,
+						  done, data);
+		if (ret < 0)
+			return -1;
+
+		/* Give up waiting for a repaint after one refresh period;
+		 * the delay is rounded up so it never disarms the timer. */
+		refresh_msec = 17;
+		if (output->current_mode->refresh > 0)
+			refresh_msec = millihz_to_nsec(
+				output->current_mode->refresh) / 1000000 + 1;
+		wl_event_source_timer_update(output->read_pixels_timer,
+					     refresh_msec);
+
+		return 0;
+	}
+
+	pixels = malloc(stride * height);
+	if (!pixels)
+		return -1;
+
+	if (renderer->read_pixels(output, format, pixels,
+				  x, y, width, height) < 0) {
+		free(pixels);
+		return -1;
+	}
+
+	done(output, pixels, stride, data);
+	free(pixels);
+
+	return 0;
+}
+
+/** Complete all pending reads of an output
+ *
+ * \param output The output.
+ *
+ * Calls the \c done callback of every read started with
+ * weston_output_read_pixels_async() on \p output that has not completed
+ * yet, waiting for the renderer if needed. Users must call this before
+ * freeing the data they passed to a pending read.
+ */
+WL_EXPORT void
+weston_output_flush_read_pixels(struct weston_output *output)
+{
+	struct weston_renderer *renderer = output->compositor->renderer;
+
+	if (renderer->flush_read_pixels)
+		renderer->flush_read_pixels(output);
+}
+
 static void
 surface_flush_damage(struct weston_surface *surface)
 {
@@ -1962,6 +2136,9 @@ surface_flush_damage(struct weston_surface *surface)
 	    wl_shm_buffer_get(surface->buffer_ref.buffer->resource))
 		surface->compositor->renderer->flush_damage(surface);
 
+	if (pixman_region32_not_empty(&surface->damage))
+		surface->content_serial++;
+
 	if (weston_timeline_enabled_ &&
 	    pixman_region32_not_empty(&surface->damage))
 		TL_POINT("core_flush_damage", TLP_SURFACE(surface),
@@ -2002,7 +2179,7 @@ static void
 compositor_accumulate_damage(struct weston_compositor *ec)
 {
 	struct weston_plane *plane;
-	struct weston_view *ev;
+	struct weston_view_render *r;
 	pixman_region32_t opaque, clip;
 
 	pixman_region32_init(&clip);
@@ -2012,11 +2189,11 @@ compositor_accumulate_damage(struct weston_compositor *ec)
 
 		pixman_region32_init(&opaque);
 
-		wl_list_for_each(ev, &ec->view_list, link) {
-			if (ev->plane != plane)
+		wl_array_for_each(r, &ec->render_array) {
+			if (r->plane != plane)
 				continue;
 
-			view_accumulate_damage(ev, &opaque);
+			view_accumulate_damage(r->view, &opaque);
 		}
 
 		pixman_region32_union(&clip, &clip, &opaque);
@@ -2025,10 +2202,12 @@ compositor_accumulate_damage(struct weston_compositor *ec)
 
 	pixman_region32_fini(&clip);
 
-	wl_list_for_each(ev, &ec->view_list, link)
-		ev->surface->touched = false;
+	wl_array_for_each(r, &ec->render_array)
+		r->view->surface->touched = false;
+
+	wl_array_for_each(r, &ec->render_array) {
+		struct weston_view *ev = r->view;
 
-	wl_list_for_each(ev, &ec->view_list, link) {
 		if (ev->surface->touched)
 			continue;
 		ev->surface->touched = true;
@@ -2172,6 +2351,26 @@ weston_compositor_build_view_list(struct weston_compositor *compositor)
 			surface_free_unused_subsurface_views(view->surface);
 }
 
+static void
+weston_compositor_build_render_array(struct weston_compositor *compositor)
+{
+	struct weston_view_render *r;
+	struct weston_view *view;
+
+	compositor->render_array.size = 0;
+	wl_list_for_each(view, &compositor->view_list, link) {
+		r = wl_array_add(&compositor->render_array, sizeof *r);
+		if (!r) {
+			weston_log("out of memory building the render array\n");
+			break;
+		}
+
+		r->view = view;
+		r->plane = view->plane;
+		r->bbox = *pixman_region32_extents(&view->transform.boundingbox);
+	}
+}
+
 static void
 weston_output_take_feedback_list(struct weston_output *output,
 				 struct weston_surface *surface)
@@ -2197,11 +2396,83 @@ weston_output_take_feedback_list(struct weston_output *output,
 	wl_list_init(&surface->feedback_list);
 }
 
+static int
+occluded_frame_handler(void *data)
+{
+	struct weston_compositor *compositor = data;
+
+	/* Deferred frame callbacks are only sent from a repaint. */
+	weston_compositor_schedule_repaint(compositor);
+
+	return 1;
+}
+
+/* Takes the frame callbacks and presentation feedback of the surfaces
+ * shown on this output. Needs view->clip from the damage pass: a
+ * surface all of whose views are covered by opaque views above them
+ * gets its frame callbacks at most every occluded_frame_msec, so
+ * clients nobody can see do not keep drawing at the output rate.
+ */
+static void
+weston_output_collect_frame_callbacks(struct weston_output *output,
+				      struct wl_list *frame_callback_list)
+{
+	struct weston_compositor *ec = output->compositor;
+	struct weston_view_render *vr;
+	struct weston_surface *surface;
+	uint32_t elapsed, next = UINT32_MAX;
+
+	if (ec->occluded_frame_msec > 0) {
+		wl_array_for_each(vr, &ec->render_array)
+			vr->view->surface->frame_occluded = true;
+		wl_array_for_each(vr, &ec->render_array)
+			if (pixman_region32_contains_rectangle(&vr->view->clip,
+							       &vr->bbox) !=
+			    PIXMAN_REGION_IN)
+				vr->view->surface->frame_occluded = false;
+	}
+
+	wl_array_for_each(vr, &ec->render_array) {
+		surface = vr->view->surface;
+
+		/* Note: This operation is safe to do multiple times on the
+		 * same surface.
+		 */
+		if (surface->output != output)
+			continue;
+
+		weston_output_take_feedback_list(output, surface);
+
+		if (wl_list_empty(&surface->frame_callback_list))
+			continue;
+
+		if (ec->occluded_frame_msec > 0 && surface->frame_occluded) {
+			elapsed = output->frame_time -
+				  surface->frame_callback_time;
+			if (elapsed < (uint32_t) ec->occluded_frame_msec) {
+				next = MIN(next,
+					   ec->occluded_frame_msec - elapsed);
+				continue;
+			}
+		}
+
+		wl_list_insert_list(frame_callback_list,
+				    &surface->frame_callback_list);
+		wl_list_init(&surface->frame_callback_list);
+		surface->frame_callback_time = output->frame_time;
+	}
+
+	if (next != UINT32_MAX)
+		wl_event_source_timer_update(ec->occluded_frame_timer, next);
+}
+
 static int
 weston_output_repaint(struct weston_output *output)
 {
 	struct weston_compositor *ec = output->compositor;
 	struct weston_view *ev;
+	struct weston_seat *seat;
+	struct weston_pointer *pointer;
 	struct weston_animation *animation, *next;
 	struct weston_frame_callback *cb, *cnext;
 	struct wl_list frame_callback_list;
@@ -2213,6 +2484,17 @@ weston_output_repaint(struct weston_output *output)
 
 	TL_POINT("core_repaint_begin", TLP_OUTPUT(output), TLP_END);
 
+	/* Deliver the pointer motion held back until this frame, so that
+	 * the cursor and any grab it drives are up to date. */
+	if (ec->pointer_motion_coalescing ==
+	    WESTON_POINTER_MOTION_COALESCING_REPAINT) {
+		wl_list_for_each(seat, &ec->seat_list, link) {
+			pointer = weston_seat_get_pointer(seat);
+			if (pointer)
+				weston_pointer_flush_motion(pointer);
+		}
+	}
+
 	/* Rebuild the surface list and update surface transforms up front. */
 	weston_compositor_build_view_list(ec);
 
@@ -2225,22 +2507,13 @@ weston_output_repaint(struct weston_output *output)
 		}
 	}
 
-	wl_list_init(&frame_callback_list);
-	wl_list_for_each(ev, &ec->view_list, link) {
-		/* Note: This operation is safe to do multiple times on the
-		 * same surface.
-		 */
-		if (ev->surface->output == output) {
-			wl_list_insert_list(&frame_callback_list,
-					    &ev->surface->frame_callback_list);
-			wl_list_init(&ev->surface->frame_callback_list);
-
-			weston_output_take_feedback_list(output, ev->surface);
-		}
-	}
+	weston_compositor_build_render_array(ec);
 
 	compositor_accumulate_damage(ec);
 
+	wl_list_init(&frame_callback_list);
+	weston_output_collect_frame_callbacks(output, &frame_callback_list);
+
 	pixman_region32_init(&output_damage);
 	pixman_region32_intersect(&output_damage,
 				  &ec->primary_plane.damage, &output->region);
@@ -2254,6 +2527,10 @@ weston_output_repaint(struct weston_output *output)
 
 	pixman_region32_fini(&output_damage);
 
+	/* Views may be destroyed before the next repaint rebuilds the
+	 * array, starting with the animations below. */
+	ec->render_array.size = 0;
+
 	output->repaint_needed = 0;
 
 	weston_compositor_repick(ec);
@@ -2708,10 +2985,18 @@ weston_surface_commit_state(struct weston_surface *surface,
 		weston_surface_attach(surface, state->buffer);
 	weston_surface_state_set_buffer(state, NULL);
 
-	weston_surface_build_buffer_matrix(surface,
-					   &surface->surface_to_buffer_matrix);
-	weston_matrix_invert(&surface->buffer_to_surface_matrix,
-			     &surface->surface_to_buffer_matrix);
+	/* Most commits only bring new content, keep the matrices then. */
+	if (state->buffer_viewport.changed ||
+	    surface->buffer_matrix_width != surface->width_from_buffer ||
+	    surface->buffer_matrix_height != surface->height_from_buffer) {
+		weston_surface_build_buffer_matrix(surface,
+					&surface->surface_to_buffer_matrix);
+		weston_matrix_invert(&surface->buffer_to_surface_matrix,
+				     &surface->surface_to_buffer_matrix);
+		surface->buffer_matrix_width = surface->width_from_buffer;
+		surface->buffer_matrix_height = surface->height_from_buffer;
+		surface->buffer_matrix_serial++;
+	}
 
 	if (state->newly_attached || state->buffer_viewport.changed) {
 		weston_surface_update_size(surface);
@@ -3966,6 +4251,8 @@ weston_output_destroy(struct weston_output *output)
 	wl_signal_emit(&output->compositor->output_destroyed_signal, output);
 	wl_signal_emit(&output->destroy_signal, output);
 
+	wl_event_source_remove(output->read_pixels_timer);
+
 	free(output->name);
 	pixman_region32_fini(&output->region);
 	pixman_region32_fini(&output->previous_damage);
@@ -4157,6 +4444,8 @@ weston_output_init(struct weston_output *output, struct weston_compositor *c,
 	loop = wl_display_get_event_loop(c->wl_display);
 	output->repaint_timer = wl_event_loop_add_timer(loop,
 					output_repaint_timer_handler, output);
+	output->read_pixels_timer = wl_event_loop_add_timer(loop,
+					output_read_pixels_timer_handler, output);
 
 	/* Invert the output id pool and look for the lowest numbered
 	 * switch (the least significant bit).  Take that bit's position
@@ -4602,6 +4891,7 @@ weston_compositor_create(struct wl_display *display, void *user_data)
 		goto fail;
 
 	wl_list_init(&ec->view_list);
+	wl_array_init(&ec->render_array);
 	wl_list_init(&ec->plane_list);
 	wl_list_init(&ec->layer_list);
 	wl_list_init(&ec->seat_list);
@@ -4614,6 +4904,7 @@ weston_compositor_create(struct wl_display *display, void *user_data)
 	wl_list_init(&ec->debug_binding_list);
 
 	wl_list_init(&ec->plugin_api_list);
+	wl_list_init(&ec->xkb_info_cache);
 
 	weston_plane_init(&ec->primary_plane, ec, 0, 0);
 	weston_compositor_stack_plane(ec, &ec->primary_plane, NULL);
@@ -4624,6 +4915,8 @@ weston_compositor_create(struct wl_display *display, void *user_data)
 
 	loop = wl_display_get_event_loop(ec->wl_display);
 	ec->idle_source = wl_event_loop_add_timer(loop, idle_handler, ec);
+	ec->occluded_frame_timer =
+		wl_event_loop_add_timer(loop, occluded_frame_handler, ec);
 
 	weston_layer_init(&ec->fade_layer, &ec->layer_list);
 	weston_layer_init(&ec->cursor_layer, &ec->fade_layer.link);
@@ -4644,6 +4937,7 @@ weston_compositor_shutdown(struct weston_compositor *ec)
 	struct weston_output *output, *next;
 
 	wl_event_source_remove(ec->idle_source);
+	wl_event_source_remove(ec->occluded_frame_timer);
 
 	/* Destroy all outputs associated with this compositor */
 	wl_list_for_each_safe(output, next, &ec->output_list, link)
@@ -4660,6 +4954,8 @@ weston_compositor_shutdown(struct weston_compositor *ec)
 	weston_binding_list_destroy_all(&ec->debug_binding_list);
 
 	weston_plane_release(&ec->primary_plane);
+
+	wl_array_release(&ec->render_array);
 }
 
 WL_EXPORT void
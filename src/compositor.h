@@ -194,6 +194,7 @@ struct weston_output {
 	int repaint_needed;
 	int repaint_scheduled;
 	struct wl_event_source *repaint_timer;
+	struct wl_event_source *read_pixels_timer;
 	struct weston_output_zoom zoom;
 	int dirty;
 	struct wl_signal frame_signal;
@@ -245,6 +246,15 @@ enum weston_pointer_motion_mask {
 	WESTON_POINTER_MOTION_REL = 1 << 1,
 };
 
+enum weston_pointer_motion_coalescing {
+	/* Every motion event is delivered as it arrives */
+	WESTON_POINTER_MOTION_COALESCING_OFF = 0,
+	/* Motion is merged until the input backend has been drained */
+	WESTON_POINTER_MOTION_COALESCING_BATCH,
+	/* Motion is merged until the next output repaint */
+	WESTON_POINTER_MOTION_COALESCING_REPAINT,
+};
+
 struct weston_pointer_motion_event {
 	uint32_t mask;
 	double x;
@@ -382,6 +392,17 @@ struct weston_pointer {
 	uint32_t button_count;
 
 	struct wl_listener output_destroy_listener;
+
+	/* Motion held back by pointer motion coalescing */
+	struct {
+		bool motion_pending;
+		bool frame_pending;
+		uint32_t time;
+		struct weston_pointer_motion_event motion;
+		struct wl_event_source *flush_source;
+		uint64_t events_in;
+		uint64_t events_out;
+	} coalesce;
 };
 
 
@@ -445,6 +466,8 @@ weston_pointer_move(struct weston_pointer *pointer,
 void
 weston_pointer_set_default_grab(struct weston_pointer *pointer,
 		const struct weston_pointer_grab_interface *interface);
+void
+weston_pointer_flush_motion(struct weston_pointer *pointer);
 
 struct weston_keyboard *
 weston_keyboard_create(void);
@@ -508,7 +531,9 @@ struct weston_xkb_info {
 	int keymap_fd;
 	size_t keymap_size;
 	char *keymap_area;
+	uint32_t keymap_hash;
 	int32_t ref_count;
+	struct wl_list link; /* weston_compositor::xkb_info_cache */
 	xkb_mod_index_t shift_mod;
 	xkb_mod_index_t caps_mod;
 	xkb_mod_index_t ctrl_mod;
@@ -619,11 +644,25 @@ struct weston_plane {
 	struct wl_list link;
 };
 
+typedef void (*weston_read_pixels_func_t)(struct weston_output *output,
+					  const void *pixels, int32_t stride,
+					  void *data);
+
 struct weston_renderer {
 	int (*read_pixels)(struct weston_output *output,
 			       pixman_format_code_t format, void *pixels,
 			       uint32_t x, uint32_t y,
 			       uint32_t width, uint32_t height);
+
+	/** See weston_output_read_pixels_async() */
+	int (*read_pixels_async)(struct weston_output *output,
+				 pixman_format_code_t format,
+				 uint32_t x, uint32_t y,
+				 uint32_t width, uint32_t height,
+				 weston_read_pixels_func_t done, void *data);
+
+	/** See weston_output_flush_read_pixels() */
+	void (*flush_read_pixels)(struct weston_output *output);
 	void (*repaint_output)(struct weston_output *output,
 			       pixman_region32_t *output_damage);
 	void (*flush_damage)(struct weston_surface *surface);
@@ -721,6 +760,18 @@ struct weston_backend {
 	void (*restore)(struct weston_compositor *compositor);
 };
 
+/* Per-frame copy of the view state the repaint loops look at for every
+ * view. Damage accumulation and the renderers walk these in a packed
+ * array and only follow the view pointer for views that actually take
+ * part in the frame, instead of chasing weston_view::link through the
+ * heap. Valid during weston_output::repaint only.
+ */
+struct weston_view_render {
+	struct weston_view *view;
+	struct weston_plane *plane;
+	pixman_box32_t bbox;	/* extents of view->transform.boundingbox */
+};
+
 struct weston_compositor {
 	struct wl_signal destroy_signal;
 
@@ -755,6 +806,7 @@ struct weston_compositor {
 	struct wl_list seat_list;
 	struct wl_list layer_list;
 	struct wl_list view_list;	/* struct weston_view::link */
+	struct wl_array render_array;	/* struct weston_view_render */
 	struct wl_list plane_list;
 	struct wl_list key_binding_list;
 	struct wl_list modifier_binding_list;
@@ -789,6 +841,7 @@ struct weston_compositor {
 	struct xkb_rule_names xkb_names;
 	struct xkb_context *xkb_context;
 	struct weston_xkb_info *xkb_info;
+	struct wl_list xkb_info_cache; /* weston_xkb_info::link */
 
 	/* Raw keyboard processing (no libxkbcommon initialization or handling) */
 	int use_xkbcommon;
@@ -801,6 +854,13 @@ struct weston_compositor {
 	clockid_t presentation_clock;
 	int32_t repaint_msec;
 
+	/* Minimum interval between frame callbacks of a surface whose
+	 * views are all occluded, 0 to not throttle them. */
+	int32_t occluded_frame_msec;
+	struct wl_event_source *occluded_frame_timer;
+
+	enum weston_pointer_motion_coalescing pointer_motion_coalescing;
+
 	int exit_code;
 
 	void *user_data;
@@ -1016,8 +1076,16 @@ struct weston_surface {
 	 */
 	bool touched;
 
+	/* Frame callback throttling, see occluded_frame_msec */
+	bool frame_occluded;
+	uint32_t frame_callback_time;
+
 	void *renderer_state;
 
+	/* Bumped whenever the renderer takes in new contents, for caches
+	 * of weston_surface_copy_content() results. */
+	uint32_t content_serial;
+
 	struct wl_list views;
 
 	/*
@@ -1051,9 +1119,13 @@ struct weston_surface {
 
 	/* Matrices representating of the full transformation between
 	 * buffer and surface coordinates.  These matrices are updated
-	 * using the weston_surface_build_buffer_matrix function. */
+	 * using the weston_surface_build_buffer_matrix function, when
+	 * the buffer viewport or the buffer size below change, which
+	 * also bumps buffer_matrix_serial. */
 	struct weston_matrix buffer_to_surface_matrix;
 	struct weston_matrix surface_to_buffer_matrix;
+	int32_t buffer_matrix_width, buffer_matrix_height;
+	uint32_t buffer_matrix_serial;
 
 	/*
 	 * If non-NULL, this function will be called on
@@ -1250,6 +1322,14 @@ void
 weston_output_schedule_repaint(struct weston_output *output);
 void
 weston_output_damage(struct weston_output *output);
+int
+weston_output_read_pixels_async(struct weston_output *output,
+				pixman_format_code_t format,
+				uint32_t x, uint32_t y,
+				uint32_t width, uint32_t height,
+				weston_read_pixels_func_t done, void *data);
+void
+weston_output_flush_read_pixels(struct weston_output *output);
 void
 weston_compositor_schedule_repaint(struct weston_compositor *compositor);
 void
@@ -1493,6 +1573,20 @@ weston_surface_copy_content(struct weston_surface *surface,
 			    int src_x, int src_y,
 			    int width, int height);
 
+struct weston_thumbnail_cache;
+
+struct weston_thumbnail_cache *
+weston_thumbnail_cache_create(struct weston_compositor *compositor,
+			      size_t budget);
+
+void
+weston_thumbnail_cache_destroy(struct weston_thumbnail_cache *cache);
+
+pixman_image_t *
+weston_thumbnail_cache_get(struct weston_thumbnail_cache *cache,
+			   struct weston_surface *surface,
+			   int max_width, int max_height);
+
 struct weston_buffer *
 weston_buffer_from_resource(struct wl_resource *resource);
 
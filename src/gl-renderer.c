@@ -31,6 +31,7 @@
 
 #include <stdbool.h>
 #include <stdlib.h>
+#include <stdio.h>
 #include <string.h>
 #include <ctype.h>
 #include <float.h>
@@ -75,6 +76,20 @@ struct gl_border_image {
 	void *data;
 };
 
+/* Number of read-backs an output can have in flight before a new one
+ * waits for the oldest to complete. */
+#define READBACK_RING_SIZE 3
+
+struct gl_readback {
+	GLuint pbo;
+	void *pixels;		/* used instead of pbo without PBO support */
+	size_t size;		/* allocated size of pbo or pixels */
+	EGLSyncKHR sync;
+	uint32_t width, height;
+	weston_read_pixels_func_t done;
+	void *data;
+};
+
 struct gl_output_state {
 	EGLSurface egl_surface;
 	pixman_region32_t buffer_damage[BUFFER_DAMAGE_COUNT];
@@ -84,6 +99,11 @@ struct gl_output_state {
 	enum gl_border_status border_status;
 
 	struct weston_matrix output_matrix;
+
+	/* Ring of pending asynchronous read-backs */
+	struct gl_readback readbacks[READBACK_RING_SIZE];
+	int readback_first;
+	int readback_count;
 };
 
 enum buffer_type {
@@ -204,6 +224,13 @@ struct gl_renderer {
 	int has_dmabuf_import;
 	struct wl_list dmabuf_images;
 
+	int has_pack_pbo;
+	PFNGLMAPBUFFERRANGEEXTPROC map_buffer_range;
+	PFNGLUNMAPBUFFEROESPROC unmap_buffer;
+	PFNEGLCREATESYNCKHRPROC create_sync;
+	PFNEGLDESTROYSYNCKHRPROC destroy_sync;
+	PFNEGLCLIENTWAITSYNCKHRPROC client_wait_sync;
+
 	struct gl_shader texture_shader_rgba;
 	struct gl_shader texture_shader_rgbx;
 	struct gl_shader texture_shader_egl_external;
@@ -827,11 +854,20 @@ static void
 repaint_views(struct weston_output *output, pixman_region32_t *damage)
 {
 	struct weston_compositor *compositor = output->compositor;
-	struct weston_view *view;
+	struct weston_view_render *r = compositor->render_array.data;
+	int i;
 
-	wl_list_for_each_reverse(view, &compositor->view_list, link)
-		if (view->plane == &compositor->primary_plane)
-			draw_view(view, output, damage);
+	for (i = compositor->render_array.size / sizeof *r - 1; i >= 0; i--) {
+		if (r[i].plane != &compositor->primary_plane)
+			continue;
+
+		/* Skip views outside the damage without touching them. */
+		if (pixman_region32_contains_rectangle(damage, &r[i].bbox) ==
+		    PIXMAN_REGION_OUT)
+			continue;
+
+		draw_view(r[i].view, output, damage);
+	}
 }
 
 static void
@@ -1064,6 +1100,9 @@ output_rotate_damage(struct weston_output *output,
 	go->border_damage[go->buffer_damage_index] = border_status;
 }
 
+static void
+output_poll_readbacks(struct weston_output *output);
+
 /* NOTE: We now allow falling back to ARGB gl visuals when XRGB is
  * unavailable, so we're assuming the background has no transparency
  * and that everything with a blend, like drop shadows, will have something
@@ -1092,6 +1131,10 @@ gl_renderer_repaint_output(struct weston_output *output,
 	if (use_output(output) < 0)
 		return;
 
+	/* Read-backs requested during the previous frames are usually
+	 * done by now; hand them out without waiting for the rest. */
+	output_poll_readbacks(output);
+
 	/* Calculate the viewport */
 	glViewport(go->borders[GL_RENDERER_BORDER_LEFT].width,
 		   go->borders[GL_RENDERER_BORDER_BOTTOM].height,
@@ -1191,6 +1234,21 @@ gl_renderer_repaint_output(struct weston_output *output,
 	go->border_status = BORDER_STATUS_CLEAN;
 }
 
+static int
+read_format_to_gl(pixman_format_code_t format, GLenum *gl_format)
+{
+	switch (format) {
+	case PIXMAN_a8r8g8b8:
+		*gl_format = GL_BGRA_EXT;
+		return 0;
+	case PIXMAN_a8b8g8r8:
+		*gl_format = GL_RGBA;
+		return 0;
+	default:
+		return -1;
+	}
+}
+
 static int
 gl_renderer_read_pixels(struct weston_output *output,
 			       pixman_format_code_t format, void *pixels,
@@ -1203,16 +1261,8 @@ gl_renderer_read_pixels(struct weston_output *output,
 	x += go->borders[GL_RENDERER_BORDER_LEFT].width;
 	y += go->borders[GL_RENDERER_BORDER_BOTTOM].height;
 
-	switch (format) {
-	case PIXMAN_a8r8g8b8:
-		gl_format = GL_BGRA_EXT;
-		break;
-	case PIXMAN_a8b8g8r8:
-		gl_format = GL_RGBA;
-		break;
-	default:
+	if (read_format_to_gl(format, &gl_format) < 0)
 		return -1;
-	}
 
 	if (use_output(output) < 0)
 		return -1;
@@ -1224,6 +1274,148 @@ gl_renderer_read_pixels(struct weston_output *output,
 	return 0;
 }
 
+/* Hands the oldest pending read-back of the output to its user, waiting
+ * for the GPU to finish writing it if needed. */
+static void
+output_complete_readback(struct weston_output *output)
+{
+	struct gl_output_state *go = get_output_state(output);
+	struct gl_renderer *gr = get_renderer(output->compositor);
+	struct gl_readback *rb = &go->readbacks[go->readback_first];
+	void *pixels = NULL;
+
+	go->readback_first = (go->readback_first + 1) % READBACK_RING_SIZE;
+	go->readback_count--;
+
+	if (rb->sync != EGL_NO_SYNC_KHR) {
+		gr->client_wait_sync(gr->egl_display, rb->sync,
+				     EGL_SYNC_FLUSH_COMMANDS_BIT_KHR,
+				     EGL_FOREVER_KHR);
+		gr->destroy_sync(gr->egl_display, rb->sync);
+		rb->sync = EGL_NO_SYNC_KHR;
+	}
+
+	if (!gr->has_pack_pbo) {
+		pixels = rb->pixels;
+	} else if (use_output(output) == 0) {
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, rb->pbo);
+		pixels = gr->map_buffer_range(GL_PIXEL_PACK_BUFFER, 0,
+					      rb->width * rb->height * 4,
+					      GL_MAP_READ_BIT);
+	}
+
+	rb->done(output, pixels, rb->width * 4, rb->data);
+
+	if (gr->has_pack_pbo && pixels) {
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, rb->pbo);
+		gr->unmap_buffer(GL_PIXEL_PACK_BUFFER);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	}
+}
+
+/* Completes the read-backs whose copy has finished, in order. */
+static void
+output_poll_readbacks(struct weston_output *output)
+{
+	struct gl_output_state *go = get_output_state(output);
+	struct gl_renderer *gr = get_renderer(output->compositor);
+	struct gl_readback *rb;
+	EGLint ret;
+
+	while (go->readback_count > 0) {
+		rb = &go->readbacks[go->readback_first];
+		if (rb->sync != EGL_NO_SYNC_KHR) {
+			ret = gr->client_wait_sync(gr->egl_display, rb->sync,
+						   0, 0);
+			if (ret == EGL_TIMEOUT_EXPIRED_KHR)
+				break;
+		}
+
+		output_complete_readback(output);
+	}
+}
+
+static int
+gl_renderer_read_pixels_async(struct weston_output *output,
+			      pixman_format_code_t format,
+			      uint32_t x, uint32_t y,
+			      uint32_t width, uint32_t height,
+			      weston_read_pixels_func_t done, void *data)
+{
+	struct gl_output_state *go = get_output_state(output);
+	struct gl_renderer *gr = get_renderer(output->compositor);
+	struct gl_readback *rb;
+	size_t size = width * height * 4;
+	GLenum gl_format;
+	void *pixels;
+
+	if (read_format_to_gl(format, &gl_format) < 0)
+		return -1;
+
+	if (go->readback_count == READBACK_RING_SIZE)
+		output_complete_readback(output);
+
+	if (use_output(output) < 0)
+		return -1;
+
+	rb = &go->readbacks[(go->readback_first + go->readback_count) %
+			    READBACK_RING_SIZE];
+
+	x += go->borders[GL_RENDERER_BORDER_LEFT].width;
+	y += go->borders[GL_RENDERER_BORDER_BOTTOM].height;
+
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+
+	if (gr->has_pack_pbo) {
+		/* The copy lands in the buffer object and only gets waited
+		 * for when the pixels are mapped, a frame later. */
+		if (!rb->pbo)
+			glGenBuffers(1, &rb->pbo);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, rb->pbo);
+		if (rb->size < size) {
+			glBufferData(GL_PIXEL_PACK_BUFFER, size, NULL,
+				     GL_STREAM_READ);
+			rb->size = size;
+		}
+		glReadPixels(x, y, width, height, gl_format,
+			     GL_UNSIGNED_BYTE, NULL);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+		rb->sync = gr->create_sync(gr->egl_display,
+					   EGL_SYNC_FENCE_KHR, NULL);
+	} else {
+		if (rb->size < size) {
+			pixels = realloc(rb->pixels, size);
+			if (!pixels)
+				return -1;
+			rb->pixels = pixels;
+			rb->size = size;
+		}
+		glReadPixels(x, y, width, height, gl_format,
+			     GL_UNSIGNED_BYTE, rb->pixels);
+	}
+
+	rb->width = width;
+	rb->height = height;
+	rb->done = done;
+	rb->data = data;
+	go->readback_count++;
+
+	return 0;
+}
+
+static void
+gl_renderer_flush_read_pixels(struct weston_output *output)
+{
+	struct gl_output_state *go = get_output_state(output);
+
+	if (!go)
+		return;
+
+	while (go->readback_count > 0)
+		output_complete_readback(output);
+}
+
 static void
 gl_renderer_flush_damage(struct weston_surface *surface)
 {
@@ -2618,14 +2810,25 @@ gl_renderer_output_destroy(struct weston_output *output)
 {
 	struct gl_renderer *gr = get_renderer(output->compositor);
 	struct gl_output_state *go = get_output_state(output);
+	struct gl_readback *rb;
 	int i;
 
+	gl_renderer_flush_read_pixels(output);
+
+	for (i = 0; i < READBACK_RING_SIZE; i++) {
+		rb = &go->readbacks[i];
+		if (rb->pbo && use_output(output) == 0)
+			glDeleteBuffers(1, &rb->pbo);
+		free(rb->pixels);
+	}
+
 	for (i = 0; i < 2; i++)
 		pixman_region32_fini(&go->buffer_damage[i]);
 
 	eglDestroySurface(gr->egl_display, go->egl_surface);
 
 	free(go);
+	output->renderer_state = NULL;
 }
 
 static EGLSurface
@@ -2770,6 +2973,15 @@ gl_renderer_setup_egl_extensions(struct weston_compositor *ec)
 		gr->has_dmabuf_import = 1;
 #endif
 
+	if (check_extension(extensions, "EGL_KHR_fence_sync")) {
+		gr->create_sync =
+			(void *) eglGetProcAddress("eglCreateSyncKHR");
+		gr->destroy_sync =
+			(void *) eglGetProcAddress("eglDestroySyncKHR");
+		gr->client_wait_sync =
+			(void *) eglGetProcAddress("eglClientWaitSyncKHR");
+	}
+
 	renderer_setup_egl_client_extensions(gr);
 
 	return 0;
@@ -2893,6 +3105,8 @@ gl_renderer_create(struct weston_compositor *ec, EGLenum platform,
 		return -1;
 
 	gr->base.read_pixels = gl_renderer_read_pixels;
+	gr->base.read_pixels_async = gl_renderer_read_pixels_async;
+	gr->base.flush_read_pixels = gl_renderer_flush_read_pixels;
 	gr->base.repaint_output = gl_renderer_repaint_output;
 	gr->base.flush_damage = gl_renderer_flush_damage;
 	gr->base.attach = gl_renderer_attach;
@@ -3046,6 +3260,37 @@ fan_debug_repaint_binding(struct weston_keyboard *keyboard, uint32_t time,
 	weston_compositor_damage_all(compositor);
 }
 
+/* Read-back into pixel buffer objects needs PBOs, a way to map them
+ * for reading and fences to poll for the end of the copy. PBOs and
+ * mapping are core in GLES 3.0, which drivers usually provide even
+ * when asked for a GLES 2.0 context. */
+static void
+setup_pack_pbo(struct gl_renderer *gr, const char *extensions)
+{
+	const char *version = (const char *) glGetString(GL_VERSION);
+	int major = 0, minor = 0;
+
+	if (version)
+		sscanf(version, "OpenGL ES %d.%d", &major, &minor);
+
+	if (major >= 3) {
+		gr->map_buffer_range =
+			(void *) eglGetProcAddress("glMapBufferRange");
+		gr->unmap_buffer = (void *) eglGetProcAddress("glUnmapBuffer");
+	} else if (check_extension(extensions, "GL_NV_pixel_buffer_object") &&
+		   check_extension(extensions, "GL_EXT_map_buffer_range") &&
+		   check_extension(extensions, "GL_OES_mapbuffer")) {
+		gr->map_buffer_range =
+			(void *) eglGetProcAddress("glMapBufferRangeEXT");
+		gr->unmap_buffer =
+			(void *) eglGetProcAddress("glUnmapBufferOES");
+	}
+
+	gr->has_pack_pbo = gr->map_buffer_range && gr->unmap_buffer &&
+			   gr->create_sync && gr->destroy_sync &&
+			   gr->client_wait_sync;
+}
+
 static int
 gl_renderer_setup(struct weston_compositor *ec, EGLSurface egl_surface)
 {
@@ -3117,6 +3362,8 @@ gl_renderer_setup(struct weston_compositor *ec, EGLSurface egl_surface)
 	if (check_extension(extensions, "GL_OES_EGL_image_external"))
 		gr->has_egl_image_external = 1;
 
+	setup_pack_pbo(gr, extensions);
+
 	glActiveTexture(GL_TEXTURE0);
 
 	if (compile_shaders(ec))
@@ -3138,6 +3385,8 @@ gl_renderer_setup(struct weston_compositor *ec, EGLSurface egl_surface)
 			    gr->has_unpack_subimage ? "yes" : "no");
 	weston_log_continue(STAMP_SPACE "EGL Wayland extension: %s\n",
 			    gr->has_bind_display ? "yes" : "no");
+	weston_log_continue(STAMP_SPACE "asynchronous read-back: %s\n",
+			    gr->has_pack_pbo ? "yes" : "no");
 
 
 	return 0;
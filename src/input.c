@@ -681,10 +681,23 @@ pointer_handle_sprite_destroy(struct wl_listener *listener, void *data)
 	pointer->sprite = NULL;
 }
 
+static void
+weston_pointer_drop_coalesced(struct weston_pointer *pointer)
+{
+	if (pointer->coalesce.flush_source) {
+		wl_event_source_remove(pointer->coalesce.flush_source);
+		pointer->coalesce.flush_source = NULL;
+	}
+
+	pointer->coalesce.motion_pending = false;
+	pointer->coalesce.frame_pending = false;
+}
+
 static void
 weston_pointer_reset_state(struct weston_pointer *pointer)
 {
 	pointer->button_count = 0;
+	weston_pointer_drop_coalesced(pointer);
 }
 
 static void
@@ -735,6 +748,16 @@ weston_pointer_destroy(struct weston_pointer *pointer)
 
 	/* XXX: What about pointer->resource_list? */
 
+	weston_pointer_drop_coalesced(pointer);
+	if (pointer->seat &&
+	    pointer->seat->compositor->pointer_motion_coalescing !=
+	    WESTON_POINTER_MOTION_COALESCING_OFF)
+		weston_log("pointer motion coalescing on seat %s: "
+			   "%llu motion events in, %llu out\n",
+			   pointer->seat->seat_name,
+			   (unsigned long long) pointer->coalesce.events_in,
+			   (unsigned long long) pointer->coalesce.events_out);
+
 	wl_list_remove(&pointer->focus_resource_listener.link);
 	wl_list_remove(&pointer->focus_view_listener.link);
 	wl_list_remove(&pointer->output_destroy_listener.link);
@@ -1229,6 +1252,119 @@ weston_pointer_handle_output_destroy(struct wl_listener *listener, void *data)
 	weston_pointer_move_to(pointer, fx, fy);
 }
 
+/** Deliver the motion and frame held back by motion coalescing
+ *
+ * \param pointer The pointer to flush
+ *
+ * Sends the accumulated motion, if any, followed by the pointer frame
+ * that was deferred with it to the current pointer grab. This is a
+ * no-op when nothing is pending, e.g. when coalescing is disabled.
+ */
+WL_EXPORT void
+weston_pointer_flush_motion(struct weston_pointer *pointer)
+{
+	if (pointer->coalesce.flush_source) {
+		wl_event_source_remove(pointer->coalesce.flush_source);
+		pointer->coalesce.flush_source = NULL;
+	}
+
+	if (pointer->coalesce.motion_pending) {
+		pointer->coalesce.motion_pending = false;
+		pointer->coalesce.events_out++;
+		pointer->grab->interface->motion(pointer->grab,
+						 pointer->coalesce.time,
+						 &pointer->coalesce.motion);
+	}
+
+	if (pointer->coalesce.frame_pending) {
+		pointer->coalesce.frame_pending = false;
+		pointer->grab->interface->frame(pointer->grab);
+	}
+}
+
+static void
+pointer_flush_idle(void *data)
+{
+	struct weston_pointer *pointer = data;
+
+	/* Idle sources are destroyed by the event loop once dispatched. */
+	pointer->coalesce.flush_source = NULL;
+	weston_pointer_flush_motion(pointer);
+}
+
+static void
+pointer_schedule_flush(struct weston_pointer *pointer)
+{
+	struct weston_compositor *ec = pointer->seat->compositor;
+	struct weston_output *output;
+	struct wl_event_loop *loop;
+	int32_t x = wl_fixed_to_int(pointer->x);
+	int32_t y = wl_fixed_to_int(pointer->y);
+
+	/* Outputs that can't repaint would never flush the motion. */
+	if (ec->pointer_motion_coalescing ==
+	    WESTON_POINTER_MOTION_COALESCING_REPAINT &&
+	    ec->state != WESTON_COMPOSITOR_SLEEPING &&
+	    ec->state != WESTON_COMPOSITOR_OFFSCREEN) {
+		wl_list_for_each(output, &ec->output_list, link) {
+			if (pixman_region32_contains_point(&output->region,
+							   x, y, NULL)) {
+				weston_output_schedule_repaint(output);
+				return;
+			}
+		}
+
+		if (!wl_list_empty(&ec->output_list)) {
+			weston_compositor_schedule_repaint(ec);
+			return;
+		}
+	}
+
+	loop = wl_display_get_event_loop(ec->wl_display);
+	pointer->coalesce.flush_source =
+		wl_event_loop_add_idle(loop, pointer_flush_idle, pointer);
+}
+
+/* Returns true if the motion event was merged into the pending one
+ * instead of being delivered. Relative deltas are accumulated, absolute
+ * positions replace each other; mixing both flushes the pending event
+ * first. */
+static bool
+pointer_coalesce_motion(struct weston_pointer *pointer, uint32_t time,
+			struct weston_pointer_motion_event *event)
+{
+	struct weston_compositor *ec = pointer->seat->compositor;
+	struct weston_pointer_motion_event *pending = &pointer->coalesce.motion;
+
+	pointer->coalesce.events_in++;
+
+	if (ec->pointer_motion_coalescing ==
+	    WESTON_POINTER_MOTION_COALESCING_OFF) {
+		pointer->coalesce.events_out++;
+		return false;
+	}
+
+	if (pointer->coalesce.motion_pending && pending->mask != event->mask)
+		weston_pointer_flush_motion(pointer);
+
+	if (!pointer->coalesce.motion_pending) {
+		*pending = *event;
+		pointer->coalesce.motion_pending = true;
+		if (!pointer->coalesce.flush_source)
+			pointer_schedule_flush(pointer);
+	} else if (event->mask & WESTON_POINTER_MOTION_ABS) {
+		pending->x = event->x;
+		pending->y = event->y;
+	} else {
+		pending->dx += event->dx;
+		pending->dy += event->dy;
+	}
+
+	pointer->coalesce.time = time;
+
+	return true;
+}
+
 WL_EXPORT void
 notify_motion(struct weston_seat *seat,
 	      uint32_t time,
@@ -1238,6 +1374,10 @@ notify_motion(struct weston_seat *seat,
 	struct weston_pointer *pointer = weston_seat_get_pointer(seat);
 
 	weston_compositor_wake(ec);
+
+	if (pointer_coalesce_motion(pointer, time, event))
+		return;
+
 	pointer->grab->interface->motion(pointer->grab, time, event);
 }
 
@@ -1293,6 +1433,9 @@ notify_motion_absolute(struct weston_seat *seat,
 		.y = y,
 	};
 
+	if (pointer_coalesce_motion(pointer, time, &event))
+		return;
+
 	pointer->grab->interface->motion(pointer->grab, time, &event);
 }
 
@@ -1318,6 +1461,9 @@ notify_button(struct weston_seat *seat, uint32_t time, int32_t button,
 	struct weston_compositor *compositor = seat->compositor;
 	struct weston_pointer *pointer = weston_seat_get_pointer(seat);
 
+	/* Buttons must be delivered at the position they happened at. */
+	weston_pointer_flush_motion(pointer);
+
 	if (state == WL_POINTER_BUTTON_STATE_PRESSED) {
 		weston_compositor_idle_inhibit(compositor);
 		if (pointer->button_count == 0) {
@@ -1350,6 +1496,7 @@ notify_axis(struct weston_seat *seat, uint32_t time,
 	struct weston_pointer *pointer = weston_seat_get_pointer(seat);
 
 	weston_compositor_wake(compositor);
+	weston_pointer_flush_motion(pointer);
 
 	if (weston_compositor_run_axis_binding(compositor, pointer,
 					       time, event))
@@ -1365,6 +1512,7 @@ notify_axis_source(struct weston_seat *seat, uint32_t source)
 	struct weston_pointer *pointer = weston_seat_get_pointer(seat);
 
 	weston_compositor_wake(compositor);
+	weston_pointer_flush_motion(pointer);
 
 	pointer->grab->interface->axis_source(pointer->grab, source);
 }
@@ -1377,6 +1525,13 @@ notify_pointer_frame(struct weston_seat *seat)
 
 	weston_compositor_wake(compositor);
 
+	/* Defer the frame together with the motion it terminates, so
+	 * that frames separating merged motion events are dropped. */
+	if (pointer->coalesce.motion_pending) {
+		pointer->coalesce.frame_pending = true;
+		return;
+	}
+
 	pointer->grab->interface->frame(pointer->grab);
 }
 
@@ -1547,7 +1702,7 @@ send_modifiers(struct wl_resource *resource, uint32_t serial, struct weston_keyb
 }
 
 static struct weston_xkb_info *
-weston_xkb_info_create(struct xkb_keymap *keymap);
+weston_xkb_info_create(struct weston_compositor *ec, struct xkb_keymap *keymap);
 
 static void
 update_keymap(struct weston_seat *seat)
@@ -1559,7 +1714,8 @@ update_keymap(struct weston_seat *seat)
 	xkb_mod_mask_t latched_mods;
 	xkb_mod_mask_t locked_mods;
 
-	xkb_info = weston_xkb_info_create(keyboard->pending_keymap);
+	xkb_info = weston_xkb_info_create(seat->compositor,
+					  keyboard->pending_keymap);
 
 	xkb_keymap_unref(keyboard->pending_keymap);
 	keyboard->pending_keymap = NULL;
@@ -1569,6 +1725,13 @@ update_keymap(struct weston_seat *seat)
 		return;
 	}
 
+	/* Switching to a keymap identical to the current one: clients
+	 * already have it, there is nothing to send. */
+	if (xkb_info == keyboard->xkb_info) {
+		weston_xkb_info_destroy(xkb_info);
+		return;
+	}
+
 	state = xkb_state_new(xkb_info->keymap);
 	if (!state) {
 		weston_log("failed to initialise XKB state\n");
@@ -2309,6 +2472,7 @@ weston_xkb_info_destroy(struct weston_xkb_info *xkb_info)
 	if (--xkb_info->ref_count > 0)
 		return;
 
+	wl_list_remove(&xkb_info->link);
 	xkb_keymap_unref(xkb_info->keymap);
 
 	if (xkb_info->keymap_area)
@@ -2339,17 +2503,125 @@ weston_compositor_xkb_destroy(struct weston_compositor *ec)
 	xkb_context_unref(ec->xkb_context);
 }
 
+static uint32_t
+hash_keymap_string(const char *str, size_t size)
+{
+	uint32_t hash = 2166136261u;
+	size_t i;
+
+	/* FNV-1a */
+	for (i = 0; i < size; i++) {
+		hash ^= (unsigned char) str[i];
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
 static struct weston_xkb_info *
-weston_xkb_info_create(struct xkb_keymap *keymap)
+weston_xkb_info_lookup(struct weston_compositor *ec,
+		       const char *keymap_str, size_t size, uint32_t hash)
 {
-	struct weston_xkb_info *xkb_info = zalloc(sizeof *xkb_info);
-	if (xkb_info == NULL)
+	struct weston_xkb_info *xkb_info;
+
+	wl_list_for_each(xkb_info, &ec->xkb_info_cache, link) {
+		if (xkb_info->keymap_hash != hash ||
+		    xkb_info->keymap_size != size)
+			continue;
+		if (memcmp(xkb_info->keymap_area, keymap_str, size) == 0)
+			return xkb_info;
+	}
+
+	return NULL;
+}
+
+static int
+weston_xkb_info_write_keymap(struct weston_xkb_info *xkb_info,
+			     const char *keymap_str)
+{
+	char *area;
+
+	xkb_info->keymap_fd = os_create_anonymous_file(xkb_info->keymap_size);
+	if (xkb_info->keymap_fd < 0) {
+		weston_log("creating a keymap file for %lu bytes failed: %m\n",
+			(unsigned long) xkb_info->keymap_size);
+		return -1;
+	}
+
+	area = mmap(NULL, xkb_info->keymap_size, PROT_READ | PROT_WRITE,
+		    MAP_SHARED, xkb_info->keymap_fd, 0);
+	if (area == MAP_FAILED) {
+		weston_log("failed to mmap() %lu bytes\n",
+			(unsigned long) xkb_info->keymap_size);
+		goto err_fd;
+	}
+	memcpy(area, keymap_str, xkb_info->keymap_size);
+	munmap(area, xkb_info->keymap_size);
+
+	/* The same file is sent to every client of every seat using
+	 * this keymap, so make sure none of them can modify it. */
+	os_seal_anonymous_file(xkb_info->keymap_fd);
+
+	xkb_info->keymap_area = mmap(NULL, xkb_info->keymap_size, PROT_READ,
+				     MAP_SHARED, xkb_info->keymap_fd, 0);
+	if (xkb_info->keymap_area == MAP_FAILED) {
+		weston_log("failed to mmap() %lu bytes\n",
+			(unsigned long) xkb_info->keymap_size);
+		xkb_info->keymap_area = NULL;
+		goto err_fd;
+	}
+
+	return 0;
+
+err_fd:
+	close(xkb_info->keymap_fd);
+	xkb_info->keymap_fd = -1;
+	return -1;
+}
+
+/* Keymaps are shared between all seats and layout switches: the
+ * compositor keeps every live weston_xkb_info in a cache, and a keymap
+ * that serializes to the same string as a cached one reuses its info,
+ * including the sealed keymap file sent to the clients. */
+static struct weston_xkb_info *
+weston_xkb_info_create(struct weston_compositor *ec, struct xkb_keymap *keymap)
+{
+	struct weston_xkb_info *xkb_info;
+	char *keymap_str;
+	size_t size;
+	uint32_t hash;
+
+	wl_list_for_each(xkb_info, &ec->xkb_info_cache, link) {
+		if (xkb_info->keymap == keymap) {
+			xkb_info->ref_count++;
+			return xkb_info;
+		}
+	}
+
+	keymap_str = xkb_keymap_get_as_string(keymap,
+					      XKB_KEYMAP_FORMAT_TEXT_V1);
+	if (keymap_str == NULL) {
+		weston_log("failed to get string version of keymap\n");
 		return NULL;
+	}
+	size = strlen(keymap_str) + 1;
+	hash = hash_keymap_string(keymap_str, size);
+
+	xkb_info = weston_xkb_info_lookup(ec, keymap_str, size, hash);
+	if (xkb_info) {
+		free(keymap_str);
+		xkb_info->ref_count++;
+		return xkb_info;
+	}
+
+	xkb_info = zalloc(sizeof *xkb_info);
+	if (xkb_info == NULL)
+		goto err_keymap_str;
 
 	xkb_info->keymap = xkb_keymap_ref(keymap);
 	xkb_info->ref_count = 1;
-
-	char *keymap_str;
+	xkb_info->keymap_size = size;
+	xkb_info->keymap_hash = hash;
 
 	xkb_info->shift_mod = xkb_keymap_mod_get_index(xkb_info->keymap,
 						       XKB_MOD_NAME_SHIFT);
@@ -2375,41 +2647,19 @@ weston_xkb_info_create(struct xkb_keymap *keymap)
 	xkb_info->scroll_led = xkb_keymap_led_get_index(xkb_info->keymap,
 							XKB_LED_NAME_SCROLL);
 
-	keymap_str = xkb_keymap_get_as_string(xkb_info->keymap,
-					      XKB_KEYMAP_FORMAT_TEXT_V1);
-	if (keymap_str == NULL) {
-		weston_log("failed to get string version of keymap\n");
+	if (weston_xkb_info_write_keymap(xkb_info, keymap_str) < 0)
 		goto err_keymap;
-	}
-	xkb_info->keymap_size = strlen(keymap_str) + 1;
-
-	xkb_info->keymap_fd = os_create_anonymous_file(xkb_info->keymap_size);
-	if (xkb_info->keymap_fd < 0) {
-		weston_log("creating a keymap file for %lu bytes failed: %m\n",
-			(unsigned long) xkb_info->keymap_size);
-		goto err_keymap_str;
-	}
-
-	xkb_info->keymap_area = mmap(NULL, xkb_info->keymap_size,
-				     PROT_READ | PROT_WRITE,
-				     MAP_SHARED, xkb_info->keymap_fd, 0);
-	if (xkb_info->keymap_area == MAP_FAILED) {
-		weston_log("failed to mmap() %lu bytes\n",
-			(unsigned long) xkb_info->keymap_size);
-		goto err_dev_zero;
-	}
-	strcpy(xkb_info->keymap_area, keymap_str);
 	free(keymap_str);
 
+	wl_list_insert(&ec->xkb_info_cache, &xkb_info->link);
+
 	return xkb_info;
 
-err_dev_zero:
-	close(xkb_info->keymap_fd);
-err_keymap_str:
-	free(keymap_str);
 err_keymap:
 	xkb_keymap_unref(xkb_info->keymap);
 	free(xkb_info);
+err_keymap_str:
+	free(keymap_str);
 	return NULL;
 }
 
@@ -2434,7 +2684,7 @@ weston_compositor_build_global_keymap(struct weston_compositor *ec)
 		return -1;
 	}
 
-	ec->xkb_info = weston_xkb_info_create(keymap);
+	ec->xkb_info = weston_xkb_info_create(ec, keymap);
 	xkb_keymap_unref(keymap);
 	if (ec->xkb_info == NULL)
 		return -1;
@@ -2496,7 +2746,8 @@ weston_seat_init_keyboard(struct weston_seat *seat, struct xkb_keymap *keymap)
 #ifdef ENABLE_XKBCOMMON
 	if (seat->compositor->use_xkbcommon) {
 		if (keymap != NULL) {
-			keyboard->xkb_info = weston_xkb_info_create(keymap);
+			keyboard->xkb_info =
+				weston_xkb_info_create(seat->compositor, keymap);
 			if (keyboard->xkb_info == NULL)
 				goto err;
 		} else {
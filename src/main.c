@@ -779,7 +779,9 @@ weston_compositor_init_config(struct weston_compositor *ec,
 	struct xkb_rule_names xkb_names;
 	struct weston_config_section *s;
 	int repaint_msec;
+	int occluded_frame_rate;
 	int vt_switching;
+	char *coalescing;
 
 	s = weston_config_get_section(config, "keyboard", NULL, NULL);
 	weston_config_section_get_string(s, "keymap_rules",
@@ -817,6 +819,34 @@ weston_compositor_init_config(struct weston_compositor *ec,
 	weston_log("Output repaint window is %d ms maximum.\n",
 		   ec->repaint_msec);
 
+	weston_config_section_get_int(s, "occluded-frame-rate",
+				      &occluded_frame_rate, 0);
+	if (occluded_frame_rate < 0 || occluded_frame_rate > 1000) {
+		weston_log("Invalid occluded-frame-rate value in config: %d\n",
+			   occluded_frame_rate);
+	} else if (occluded_frame_rate > 0) {
+		ec->occluded_frame_msec = 1000 / occluded_frame_rate;
+		weston_log("Frame callbacks of occluded surfaces are limited "
+			   "to %d per second.\n", occluded_frame_rate);
+	}
+
+	weston_config_section_get_string(s, "pointer-motion-coalescing",
+					 &coalescing, "off");
+	if (strcmp(coalescing, "off") == 0) {
+		ec->pointer_motion_coalescing =
+			WESTON_POINTER_MOTION_COALESCING_OFF;
+	} else if (strcmp(coalescing, "batch") == 0) {
+		ec->pointer_motion_coalescing =
+			WESTON_POINTER_MOTION_COALESCING_BATCH;
+	} else if (strcmp(coalescing, "repaint") == 0) {
+		ec->pointer_motion_coalescing =
+			WESTON_POINTER_MOTION_COALESCING_REPAINT;
+	} else {
+		weston_log("Invalid pointer-motion-coalescing value in "
+			   "config: %s\n", coalescing);
+	}
+	free(coalescing);
+
 	return 0;
 }
 
@@ -1070,6 +1100,7 @@ load_headless_backend(struct weston_compositor *c, char const * backend,
 		      int *argc, char **argv, struct weston_config *wc)
 {
 	struct weston_headless_backend_config config = {{ 0, }};
+	struct weston_config_section *section;
 	int ret = 0;
 	char *transform = NULL;
 
@@ -1083,6 +1114,10 @@ load_headless_backend(struct weston_compositor *c, char const * backend,
 		{ WESTON_OPTION_STRING, "transform", 0, &transform },
 	};
 
+	section = weston_config_get_section(wc, "core", NULL, NULL);
+	weston_config_section_get_bool(section, "use-pixman",
+				       &config.use_pixman, 0);
+
 	parse_options(options, ARRAY_LENGTH(options), argc, argv);
 
 	config.transform = WL_OUTPUT_TRANSFORM_NORMAL;
@@ -42,6 +42,7 @@ static void
 noop_renderer_repaint_output(struct weston_output *output,
 			     pixman_region32_t *output_damage)
 {
+	wl_signal_emit(&output->frame_signal, output);
 }
 
 static void
@@ -105,7 +106,7 @@ noop_renderer_init(struct weston_compositor *ec)
 {
 	struct weston_renderer *renderer;
 
-	renderer = malloc(sizeof *renderer);
+	renderer = zalloc(sizeof *renderer);
 	if (renderer == NULL)
 		return -1;
 
@@ -36,10 +36,47 @@
 
 #include <linux/input.h>
 
+struct pixman_readback {
+	struct wl_list link;
+	pixman_image_t *image;
+	pixman_format_code_t format;
+	uint32_t x, y, width, height;
+	weston_read_pixels_func_t done;
+	void *data;
+};
+
+#define BUFFER_DAMAGE_COUNT 2
+
 struct pixman_output_state {
 	void *shadow_buffer;
 	pixman_image_t *shadow_image;
 	pixman_image_t *hw_buffer;
+
+	/* Damage of the last frames, newest at buffer_damage_index, used
+	 * to bring an older hw_buffer up to date. */
+	pixman_region32_t buffer_damage[BUFFER_DAMAGE_COUNT];
+	int buffer_damage_index;
+	int buffer_age;
+
+	struct wl_list readback_list;
+	void *readback_pixels;
+	size_t readback_size;
+};
+
+/* Number of client buffers per surface whose pixman image is kept, enough
+ * for a triple-buffered client. */
+#define PIXMAN_IMAGE_CACHE_SIZE 3
+
+struct pixman_surface_state;
+
+struct pixman_cached_image {
+	struct pixman_surface_state *ps;
+	struct weston_buffer *buffer;	/* NULL if the slot is free */
+	pixman_image_t *image;
+	void *data;			/* shm pool memory the image wraps */
+	uint32_t last_used;
+
+	struct wl_listener buffer_destroy_listener;
 };
 
 struct pixman_surface_state {
@@ -48,7 +85,9 @@ struct pixman_surface_state {
 	pixman_image_t *image;
 	struct weston_buffer_reference buffer_ref;
 
-	struct wl_listener buffer_destroy_listener;
+	struct pixman_cached_image image_cache[PIXMAN_IMAGE_CACHE_SIZE];
+	uint32_t image_cache_clock;
+
 	struct wl_listener surface_destroy_listener;
 	struct wl_listener renderer_destroy_listener;
 };
@@ -60,6 +99,9 @@ struct pixman_renderer {
 	pixman_image_t *debug_color;
 	struct weston_binding *debug_binding;
 
+	uint32_t image_cache_hits;
+	uint32_t image_cache_misses;
+
 	struct wl_signal destroy_signal;
 };
 
@@ -69,6 +111,14 @@ get_output_state(struct weston_output *output)
 	return (struct pixman_output_state *)output->renderer_state;
 }
 
+/* The image views are composited into: the shadow image if the output
+ * has one, otherwise the buffer the backend will show. */
+static inline pixman_image_t *
+output_render_target(struct pixman_output_state *po)
+{
+	return po->shadow_image ? po->shadow_image : po->hw_buffer;
+}
+
 static int
 pixman_renderer_create_surface(struct weston_surface *surface);
 
@@ -87,21 +137,15 @@ get_renderer(struct weston_compositor *ec)
 	return (struct pixman_renderer *)ec->renderer;
 }
 
-static int
-pixman_renderer_read_pixels(struct weston_output *output,
-			       pixman_format_code_t format, void *pixels,
-			       uint32_t x, uint32_t y,
-			       uint32_t width, uint32_t height)
+static void
+read_image_pixels(pixman_image_t *image,
+		  pixman_format_code_t format, void *pixels,
+		  uint32_t x, uint32_t y,
+		  uint32_t width, uint32_t height)
 {
-	struct pixman_output_state *po = get_output_state(output);
 	pixman_transform_t transform;
 	pixman_image_t *out_buf;
 
-	if (!po->hw_buffer) {
-		errno = ENODEV;
-		return -1;
-	}
-
 	out_buf = pixman_image_create_bits(format,
 		width,
 		height,
@@ -111,28 +155,123 @@ pixman_renderer_read_pixels(struct weston_output *output,
 	/* Caller expects vflipped source image */
 	pixman_transform_init_translate(&transform,
 					pixman_int_to_fixed (x),
-					pixman_int_to_fixed (y - pixman_image_get_height (po->hw_buffer)));
+					pixman_int_to_fixed (y - pixman_image_get_height (image)));
 	pixman_transform_scale(&transform, NULL,
 			       pixman_fixed_1,
 			       pixman_fixed_minus_1);
-	pixman_image_set_transform(po->hw_buffer, &transform);
+	pixman_image_set_transform(image, &transform);
 
 	pixman_image_composite32(PIXMAN_OP_SRC,
-				 po->hw_buffer, /* src */
+				 image, /* src */
 				 NULL /* mask */,
 				 out_buf, /* dest */
 				 0, 0, /* src_x, src_y */
 				 0, 0, /* mask_x, mask_y */
 				 0, 0, /* dest_x, dest_y */
-				 pixman_image_get_width (po->hw_buffer), /* width */
-				 pixman_image_get_height (po->hw_buffer) /* height */);
-	pixman_image_set_transform(po->hw_buffer, NULL);
+				 pixman_image_get_width (image), /* width */
+				 pixman_image_get_height (image) /* height */);
+	pixman_image_set_transform(image, NULL);
 
 	pixman_image_unref(out_buf);
+}
+
+static int
+pixman_renderer_read_pixels(struct weston_output *output,
+			       pixman_format_code_t format, void *pixels,
+			       uint32_t x, uint32_t y,
+			       uint32_t width, uint32_t height)
+{
+	struct pixman_output_state *po = get_output_state(output);
+
+	if (!po->hw_buffer) {
+		errno = ENODEV;
+		return -1;
+	}
+
+	read_image_pixels(po->hw_buffer, format, pixels, x, y, width, height);
+
+	return 0;
+}
+
+static void
+output_complete_readback(struct weston_output *output,
+			 struct pixman_readback *rb)
+{
+	struct pixman_output_state *po = get_output_state(output);
+	int32_t stride = rb->width * (PIXMAN_FORMAT_BPP(rb->format) / 8);
+	size_t size = stride * rb->height;
+	void *pixels = po->readback_pixels;
+
+	wl_list_remove(&rb->link);
+
+	if (po->readback_size < size) {
+		pixels = realloc(po->readback_pixels, size);
+		if (pixels) {
+			po->readback_pixels = pixels;
+			po->readback_size = size;
+		}
+	}
+
+	if (pixels)
+		read_image_pixels(rb->image, rb->format, pixels,
+				  rb->x, rb->y, rb->width, rb->height);
+
+	rb->done(output, pixels, stride, rb->data);
+
+	pixman_image_unref(rb->image);
+	free(rb);
+}
+
+static int
+pixman_renderer_read_pixels_async(struct weston_output *output,
+				  pixman_format_code_t format,
+				  uint32_t x, uint32_t y,
+				  uint32_t width, uint32_t height,
+				  weston_read_pixels_func_t done, void *data)
+{
+	struct pixman_output_state *po = get_output_state(output);
+	struct pixman_readback *rb;
+
+	if (!po->hw_buffer) {
+		errno = ENODEV;
+		return -1;
+	}
+
+	rb = zalloc(sizeof *rb);
+	if (!rb)
+		return -1;
+
+	/* The frame stays in the hardware buffer until the next repaint
+	 * of the output, so the copy can wait until then. */
+	rb->image = pixman_image_ref(po->hw_buffer);
+	rb->format = format;
+	rb->x = x;
+	rb->y = y;
+	rb->width = width;
+	rb->height = height;
+	rb->done = done;
+	rb->data = data;
+	wl_list_insert(po->readback_list.prev, &rb->link);
 
 	return 0;
 }
 
+static void
+pixman_renderer_flush_read_pixels(struct weston_output *output)
+{
+	struct pixman_output_state *po = get_output_state(output);
+	struct pixman_readback *rb;
+
+	if (!po)
+		return;
+
+	while (!wl_list_empty(&po->readback_list)) {
+		rb = container_of(po->readback_list.next,
+				  struct pixman_readback, link);
+		output_complete_readback(output, rb);
+	}
+}
+
 static void
 region_global_to_output(struct weston_output *output, pixman_region32_t *region)
 {
@@ -339,9 +478,10 @@ repaint_region(struct weston_view *ev, struct weston_output *output,
 	pixman_filter_t filter;
 	pixman_image_t *mask_image;
 	pixman_color_t mask = { 0, };
+	pixman_image_t *target = output_render_target(po);
 
 	/* Clip rendering to the damaged output region */
-	pixman_image_set_clip_region32(po->shadow_image, repaint_output);
+	pixman_image_set_clip_region32(target, repaint_output);
 
 	pixman_renderer_compute_transform(&transform, ev, output);
 
@@ -361,11 +501,11 @@ repaint_region(struct weston_view *ev, struct weston_output *output,
 	}
 
 	if (source_clip)
-		composite_clipped(ps->image, mask_image, po->shadow_image,
+		composite_clipped(ps->image, mask_image, target,
 				  &transform, filter, source_clip);
 	else
 		composite_whole(pixman_op, ps->image, mask_image,
-				po->shadow_image, &transform, filter);
+				target, &transform, filter);
 
 	if (mask_image)
 		pixman_image_unref(mask_image);
@@ -377,14 +517,14 @@ repaint_region(struct weston_view *ev, struct weston_output *output,
 		pixman_image_composite32(PIXMAN_OP_OVER,
 					 pr->debug_color, /* src */
 					 NULL /* mask */,
-					 po->shadow_image, /* dest */
+					 target, /* dest */
 					 0, 0, /* src_x, src_y */
 					 0, 0, /* mask_x, mask_y */
 					 0, 0, /* dest_x, dest_y */
-					 pixman_image_get_width (po->shadow_image), /* width */
-					 pixman_image_get_height (po->shadow_image) /* height */);
+					 pixman_image_get_width (target), /* width */
+					 pixman_image_get_height (target) /* height */);
 
-	pixman_image_set_clip_region32 (po->shadow_image, NULL);
+	pixman_image_set_clip_region32 (target, NULL);
 }
 
 static void
@@ -518,11 +658,20 @@ static void
 repaint_surfaces(struct weston_output *output, pixman_region32_t *damage)
 {
 	struct weston_compositor *compositor = output->compositor;
-	struct weston_view *view;
+	struct weston_view_render *r = compositor->render_array.data;
+	int i;
 
-	wl_list_for_each_reverse(view, &compositor->view_list, link)
-		if (view->plane == &compositor->primary_plane)
-			draw_view(view, output, damage);
+	for (i = compositor->render_array.size / sizeof *r - 1; i >= 0; i--) {
+		if (r[i].plane != &compositor->primary_plane)
+			continue;
+
+		/* Skip views outside the damage without touching them. */
+		if (pixman_region32_contains_rectangle(damage, &r[i].bbox) ==
+		    PIXMAN_REGION_OUT)
+			continue;
+
+		draw_view(r[i].view, output, damage);
+	}
 }
 
 static void
@@ -552,17 +701,66 @@ copy_to_hw_buffer(struct weston_output *output, pixman_region32_t *region)
 	pixman_image_set_clip_region32 (po->hw_buffer, NULL);
 }
 
+static void
+output_get_damage(struct weston_output *output,
+		  pixman_region32_t *buffer_damage)
+{
+	struct pixman_output_state *po = get_output_state(output);
+	int i;
+
+	if (po->buffer_age == 0 || po->buffer_age - 1 > BUFFER_DAMAGE_COUNT) {
+		pixman_region32_copy(buffer_damage, &output->region);
+		return;
+	}
+
+	for (i = 0; i < po->buffer_age - 1; i++)
+		pixman_region32_union(buffer_damage, buffer_damage,
+				      &po->buffer_damage[(po->buffer_damage_index + i) % BUFFER_DAMAGE_COUNT]);
+}
+
+static void
+output_rotate_damage(struct weston_output *output,
+		     pixman_region32_t *output_damage)
+{
+	struct pixman_output_state *po = get_output_state(output);
+
+	po->buffer_damage_index += BUFFER_DAMAGE_COUNT - 1;
+	po->buffer_damage_index %= BUFFER_DAMAGE_COUNT;
+
+	pixman_region32_copy(&po->buffer_damage[po->buffer_damage_index],
+			     output_damage);
+}
+
 static void
 pixman_renderer_repaint_output(struct weston_output *output,
 			     pixman_region32_t *output_damage)
 {
 	struct pixman_output_state *po = get_output_state(output);
+	pixman_region32_t buffer_damage;
 
 	if (!po->hw_buffer)
 		return;
 
-	repaint_surfaces(output, output_damage);
-	copy_to_hw_buffer(output, output_damage);
+	pixman_renderer_flush_read_pixels(output);
+
+	/* What hw_buffer misses: this frame's damage plus whatever was
+	 * drawn since the frame it holds. */
+	pixman_region32_init(&buffer_damage);
+	pixman_region32_copy(&buffer_damage, output_damage);
+	output_get_damage(output, &buffer_damage);
+
+	if (po->shadow_image) {
+		/* The shadow always holds the previous frame. */
+		repaint_surfaces(output, output_damage);
+		copy_to_hw_buffer(output, &buffer_damage);
+	} else {
+		repaint_surfaces(output, &buffer_damage);
+	}
+
+	pixman_region32_fini(&buffer_damage);
+
+	output_rotate_damage(output, output_damage);
+	po->buffer_age = 1;
 
 	pixman_region32_copy(&output->previous_damage, output_damage);
 	wl_signal_emit(&output->frame_signal, output);
@@ -577,35 +775,70 @@ pixman_renderer_flush_damage(struct weston_surface *surface)
 }
 
 static void
-buffer_state_handle_buffer_destroy(struct wl_listener *listener, void *data)
+cached_image_release(struct pixman_cached_image *ci)
+{
+	if (!ci->buffer)
+		return;
+
+	wl_list_remove(&ci->buffer_destroy_listener.link);
+	pixman_image_unref(ci->image);
+	ci->buffer = NULL;
+	ci->image = NULL;
+	ci->data = NULL;
+}
+
+static void
+cached_image_handle_buffer_destroy(struct wl_listener *listener, void *data)
 {
+	struct pixman_cached_image *ci;
 	struct pixman_surface_state *ps;
 
-	ps = container_of(listener, struct pixman_surface_state,
+	ci = container_of(listener, struct pixman_cached_image,
 			  buffer_destroy_listener);
+	ps = ci->ps;
 
-	if (ps->image) {
+	if (ps->image == ci->image) {
 		pixman_image_unref(ps->image);
 		ps->image = NULL;
 	}
 
-	ps->buffer_destroy_listener.notify = NULL;
+	cached_image_release(ci);
+}
+
+/* Returns the cache slot of buffer if it has one, otherwise the slot to
+ * evict for it: a free one or the least recently attached. */
+static struct pixman_cached_image *
+pixman_surface_state_image_slot(struct pixman_surface_state *ps,
+				struct weston_buffer *buffer)
+{
+	struct pixman_cached_image *ci, *victim = NULL;
+	int i;
+
+	for (i = 0; i < PIXMAN_IMAGE_CACHE_SIZE; i++) {
+		ci = &ps->image_cache[i];
+		if (ci->buffer == buffer)
+			return ci;
+
+		if (!victim || (victim->buffer && (!ci->buffer ||
+		    ci->last_used < victim->last_used)))
+			victim = ci;
+	}
+
+	return victim;
 }
 
 static void
 pixman_renderer_attach(struct weston_surface *es, struct weston_buffer *buffer)
 {
 	struct pixman_surface_state *ps = get_surface_state(es);
+	struct pixman_renderer *pr = get_renderer(es->compositor);
+	struct pixman_cached_image *ci;
 	struct wl_shm_buffer *shm_buffer;
 	pixman_format_code_t pixman_format;
+	void *data;
 
 	weston_buffer_reference(&ps->buffer_ref, buffer);
 
-	if (ps->buffer_destroy_listener.notify) {
-		wl_list_remove(&ps->buffer_destroy_listener.link);
-		ps->buffer_destroy_listener.notify = NULL;
-	}
-
 	if (ps->image) {
 		pixman_image_unref(ps->image);
 		ps->image = NULL;
@@ -643,26 +876,43 @@ pixman_renderer_attach(struct weston_surface *es, struct weston_buffer *buffer)
 	buffer->width = wl_shm_buffer_get_width(shm_buffer);
 	buffer->height = wl_shm_buffer_get_height(shm_buffer);
 
-	ps->image = pixman_image_create_bits(pixman_format,
-		buffer->width, buffer->height,
-		wl_shm_buffer_get_data(shm_buffer),
-		wl_shm_buffer_get_stride(shm_buffer));
+	/* Clients cycle through a few buffers, keep their images around.
+	 * Size, stride and format of a wl_buffer never change, but the
+	 * pool memory moves when the client resizes the pool. */
+	data = wl_shm_buffer_get_data(shm_buffer);
+	ci = pixman_surface_state_image_slot(ps, buffer);
+	if (ci->buffer == buffer && ci->data == data) {
+		pr->image_cache_hits++;
+	} else {
+		cached_image_release(ci);
+
+		ci->image = pixman_image_create_bits(pixman_format,
+			buffer->width, buffer->height, data,
+			wl_shm_buffer_get_stride(shm_buffer));
+		if (!ci->image)
+			return;
+
+		ci->ps = ps;
+		ci->buffer = buffer;
+		ci->data = data;
+		ci->buffer_destroy_listener.notify =
+			cached_image_handle_buffer_destroy;
+		wl_signal_add(&buffer->destroy_signal,
+			      &ci->buffer_destroy_listener);
+		pr->image_cache_misses++;
+	}
 
-	ps->buffer_destroy_listener.notify =
-		buffer_state_handle_buffer_destroy;
-	wl_signal_add(&buffer->destroy_signal,
-		      &ps->buffer_destroy_listener);
+	ci->last_used = ++ps->image_cache_clock;
+	ps->image = pixman_image_ref(ci->image);
 }
 
 static void
 pixman_renderer_surface_state_destroy(struct pixman_surface_state *ps)
 {
+	int i;
+
 	wl_list_remove(&ps->surface_destroy_listener.link);
 	wl_list_remove(&ps->renderer_destroy_listener.link);
-	if (ps->buffer_destroy_listener.notify) {
-		wl_list_remove(&ps->buffer_destroy_listener.link);
-		ps->buffer_destroy_listener.notify = NULL;
-	}
 
 	ps->surface->renderer_state = NULL;
 
@@ -670,6 +920,8 @@ pixman_renderer_surface_state_destroy(struct pixman_surface_state *ps)
 		pixman_image_unref(ps->image);
 		ps->image = NULL;
 	}
+	for (i = 0; i < PIXMAN_IMAGE_CACHE_SIZE; i++)
+		cached_image_release(&ps->image_cache[i]);
 	weston_buffer_reference(&ps->buffer_ref, NULL);
 	free(ps);
 }
@@ -748,6 +1000,9 @@ pixman_renderer_destroy(struct weston_compositor *ec)
 {
 	struct pixman_renderer *pr = get_renderer(ec);
 
+	weston_log("pixman renderer: %u buffer image cache hits, %u misses\n",
+		   pr->image_cache_hits, pr->image_cache_misses);
+
 	wl_signal_emit(&pr->destroy_signal, pr);
 	weston_binding_destroy(pr->debug_binding);
 	free(pr);
@@ -835,6 +1090,8 @@ pixman_renderer_init(struct weston_compositor *ec)
 	renderer->repaint_debug = 0;
 	renderer->debug_color = NULL;
 	renderer->base.read_pixels = pixman_renderer_read_pixels;
+	renderer->base.read_pixels_async = pixman_renderer_read_pixels_async;
+	renderer->base.flush_read_pixels = pixman_renderer_flush_read_pixels;
 	renderer->base.repaint_output = pixman_renderer_repaint_output;
 	renderer->base.flush_damage = pixman_renderer_flush_damage;
 	renderer->base.attach = pixman_renderer_attach;
@@ -868,6 +1125,7 @@ pixman_renderer_output_set_buffer(struct weston_output *output, pixman_image_t *
 	if (po->hw_buffer)
 		pixman_image_unref(po->hw_buffer);
 	po->hw_buffer = buffer;
+	po->buffer_age = 1;
 
 	if (po->hw_buffer) {
 		output->compositor->read_format = pixman_image_get_format(po->hw_buffer);
@@ -875,37 +1133,53 @@ pixman_renderer_output_set_buffer(struct weston_output *output, pixman_image_t *
 	}
 }
 
+WL_EXPORT void
+pixman_renderer_output_set_buffer_age(struct weston_output *output, int age)
+{
+	struct pixman_output_state *po = get_output_state(output);
+
+	po->buffer_age = age;
+}
+
 WL_EXPORT int
-pixman_renderer_output_create(struct weston_output *output)
+pixman_renderer_output_create(struct weston_output *output, uint32_t flags)
 {
 	struct pixman_output_state *po;
-	int w, h;
+	int w, h, i;
 
 	po = zalloc(sizeof *po);
 	if (po == NULL)
 		return -1;
 
-	/* set shadow image transformation */
-	w = output->current_mode->width;
-	h = output->current_mode->height;
+	if (flags & PIXMAN_RENDERER_OUTPUT_USE_SHADOW) {
+		/* set shadow image transformation */
+		w = output->current_mode->width;
+		h = output->current_mode->height;
 
-	po->shadow_buffer = malloc(w * h * 4);
+		po->shadow_buffer = malloc(w * h * 4);
 
-	if (!po->shadow_buffer) {
-		free(po);
-		return -1;
-	}
+		if (!po->shadow_buffer) {
+			free(po);
+			return -1;
+		}
 
-	po->shadow_image =
-		pixman_image_create_bits(PIXMAN_x8r8g8b8, w, h,
-					 po->shadow_buffer, w * 4);
+		po->shadow_image =
+			pixman_image_create_bits(PIXMAN_x8r8g8b8, w, h,
+						 po->shadow_buffer, w * 4);
 
-	if (!po->shadow_image) {
-		free(po->shadow_buffer);
-		free(po);
-		return -1;
+		if (!po->shadow_image) {
+			free(po->shadow_buffer);
+			free(po);
+			return -1;
+		}
 	}
 
+	for (i = 0; i < BUFFER_DAMAGE_COUNT; i++)
+		pixman_region32_init(&po->buffer_damage[i]);
+	po->buffer_age = 1;
+
+	wl_list_init(&po->readback_list);
+
 	output->renderer_state = po;
 
 	return 0;
@@ -915,8 +1189,16 @@ WL_EXPORT void
 pixman_renderer_output_destroy(struct weston_output *output)
 {
 	struct pixman_output_state *po = get_output_state(output);
+	int i;
+
+	pixman_renderer_flush_read_pixels(output);
+	free(po->readback_pixels);
+
+	for (i = 0; i < BUFFER_DAMAGE_COUNT; i++)
+		pixman_region32_fini(&po->buffer_damage[i]);
 
-	pixman_image_unref(po->shadow_image);
+	if (po->shadow_image)
+		pixman_image_unref(po->shadow_image);
 
 	if (po->hw_buffer)
 		pixman_image_unref(po->hw_buffer);
@@ -928,4 +1210,5 @@ pixman_renderer_output_destroy(struct weston_output *output)
 	po->hw_buffer = NULL;
 
 	free(po);
+	output->renderer_state = NULL;
 }
@@ -30,11 +30,25 @@
 int
 pixman_renderer_init(struct weston_compositor *ec);
 
+enum pixman_renderer_output_flags {
+	/* Composite into a shadow image and copy the damage from there to
+	 * the output buffer. Needed when reading back from the output
+	 * buffer is slow, as with uncached framebuffer memory. Without it
+	 * views are composited straight into the output buffer, which must
+	 * then hold the previous frame whenever it is repainted. */
+	PIXMAN_RENDERER_OUTPUT_USE_SHADOW = (1 << 0),
+};
+
 int
-pixman_renderer_output_create(struct weston_output *output);
+pixman_renderer_output_create(struct weston_output *output, uint32_t flags);
 
 void
 pixman_renderer_output_set_buffer(struct weston_output *output, pixman_image_t *buffer);
 
+/* Tells how many frames ago the output buffer was last repainted, 0 if
+ * its content is undefined. Defaults to 1 after set_buffer. */
+void
+pixman_renderer_output_set_buffer_age(struct weston_output *output, int age);
+
 void
 pixman_renderer_output_destroy(struct weston_output *output);
@@ -74,8 +74,18 @@ struct shared_output {
 
 	int cache_dirty;
 	pixman_image_t *cache_image;
-	uint32_t *tmp_data;
-	size_t tmp_data_size;
+	struct wl_list readback_list;
+};
+
+/* Damage of a repaint, waiting for its pixels to be read back */
+struct ss_readback {
+	struct shared_output *so;	/* NULL once the output is gone */
+	struct wl_list link;
+
+	pixman_region32_t damage;	/* output coordinates */
+	pixman_region32_t buffer_damage;
+	pixman_box32_t extents;		/* of buffer_damage */
+	int32_t cache_width, cache_height;
 };
 
 struct ss_seat {
@@ -552,42 +562,6 @@ output_compute_transform(struct weston_output *output,
 static void
 shared_output_destroy(struct shared_output *so);
 
-static int
-shared_output_ensure_tmp_data(struct shared_output *so,
-			      pixman_region32_t *region)
-{
-	pixman_box32_t *ext;
-	size_t size;
-
-	if (!pixman_region32_not_empty(region))
-		return 0;
-
-	ext = pixman_region32_extents(region);
-
-	/* Damage is in output coordinates.
-	 *
-	 * We are multiplying by 4 because the temporary data needs to be able
-	 * to store an 32 bit-per-pixel buffer.
-	 */
-	size = 4 * (ext->x2 - ext->x1) * (ext->y2 - ext->y1)
-		 * so->output->current_scale * so->output->current_scale;
-
-	if (so->tmp_data != NULL && size <= so->tmp_data_size)
-		return 0;
-
-	free(so->tmp_data);
-	so->tmp_data = malloc(size);
-	if (so->tmp_data == NULL) {
-		so->tmp_data_size = 0;
-		errno = ENOMEM;
-		return -1;
-	}
-
-	so->tmp_data_size = size;
-
-	return 0;
-}
-
 static void
 shared_output_update(struct shared_output *so);
 
@@ -786,36 +760,105 @@ struct zwp_fullscreen_shell_mode_feedback_v1_listener mode_feedback_listener = {
 };
 
 static void
-shared_output_repainted(struct wl_listener *listener, void *data)
+ss_readback_destroy(struct ss_readback *rb)
 {
-	struct shared_output *so =
-		container_of(listener, struct shared_output, frame_listener);
-	pixman_region32_t damage;
+	wl_list_remove(&rb->link);
+	pixman_region32_fini(&rb->damage);
+	pixman_region32_fini(&rb->buffer_damage);
+	free(rb);
+}
+
+static void
+shared_output_read_pixels_done(struct weston_output *output,
+			       const void *pixels, int32_t src_stride,
+			       void *data)
+{
+	struct ss_readback *rb = data;
+	struct shared_output *so = rb->so;
+	pixman_box32_t *r, *e = &rb->extents;
 	struct ss_shm_buffer *sb;
+	uint32_t *src = (uint32_t *) pixels;
+	uint32_t *cache_data;
 	int32_t x, y, width, height, stride;
 	int i, nrects, do_yflip;
-	pixman_box32_t *r;
-	uint32_t *cache_data;
 
-	/* Damage in output coordinates */
-	pixman_region32_init(&damage);
-	pixman_region32_intersect(&damage, &so->output->region,
-				  &so->output->previous_damage);
-	pixman_region32_translate(&damage, -so->output->x, -so->output->y);
+	if (!so || !pixels ||
+	    pixman_image_get_width(so->cache_image) != rb->cache_width ||
+	    pixman_image_get_height(so->cache_image) != rb->cache_height) {
+		/* Nothing to copy. If the cache got resized, a later
+		 * read-back covers the whole output. */
+		ss_readback_destroy(rb);
+		return;
+	}
 
 	/* Apply damage to all buffers */
 	wl_list_for_each(sb, &so->shm.buffers, link)
-		pixman_region32_union(&sb->damage, &sb->damage, &damage);
+		pixman_region32_union(&sb->damage, &sb->damage, &rb->damage);
+
+	do_yflip = !!(output->compositor->capabilities & WESTON_CAP_CAPTURE_YFLIP);
+
+	stride = rb->cache_width;
+	src_stride /= 4;
+	cache_data = pixman_image_get_data(so->cache_image);
+	r = pixman_region32_rectangles(&rb->buffer_damage, &nrects);
+	for (i = 0; i < nrects; ++i) {
+		x = r[i].x1;
+		y = r[i].y1;
+		width = r[i].x2 - r[i].x1;
+		height = r[i].y2 - r[i].y1;
+
+		/* The pixels cover the damage extents, laid out as
+		 * read_pixels() returns them. */
+		if (do_yflip)
+			pixman_blt(src, cache_data, -src_stride, stride,
+				   32, 32, x - e->x1, y + 1 - e->y2,
+				   x, y, width, height);
+		else
+			pixman_blt(src, cache_data, src_stride, stride,
+				   32, 32, x - e->x1, y - e->y1,
+				   x, y, width, height);
+	}
+
+	ss_readback_destroy(rb);
+
+	so->cache_dirty = 1;
+
+	shared_output_update(so);
+}
+
+static void
+shared_output_repainted(struct wl_listener *listener, void *data)
+{
+	struct shared_output *so =
+		container_of(listener, struct shared_output, frame_listener);
+	struct ss_readback *rb;
+	int32_t y, width, height;
+	pixman_box32_t *e;
+
+	rb = zalloc(sizeof *rb);
+	if (!rb) {
+		shared_output_destroy(so);
+		return;
+	}
+
+	rb->so = so;
+	wl_list_insert(so->readback_list.prev, &rb->link);
+
+	/* Damage in output coordinates */
+	pixman_region32_init(&rb->damage);
+	pixman_region32_intersect(&rb->damage, &so->output->region,
+				  &so->output->previous_damage);
+	pixman_region32_translate(&rb->damage, -so->output->x, -so->output->y);
 
 	/* Transform to buffer coordinates */
+	pixman_region32_init(&rb->buffer_damage);
 	weston_transformed_region(so->output->width, so->output->height,
 				  so->output->transform,
 				  so->output->current_scale,
-				  &damage, &damage);
+				  &rb->damage, &rb->buffer_damage);
 
 	width = so->output->current_mode->width;
 	height = so->output->current_mode->height;
-	stride = width;
 
 	if (!so->cache_image ||
 	    pixman_image_get_width(so->cache_image) != width ||
@@ -826,54 +869,44 @@ shared_output_repainted(struct wl_listener *listener, void *data)
 		so->cache_image =
 			pixman_image_create_bits(PIXMAN_a8r8g8b8,
 						 width, height, NULL,
-						 stride);
+						 width);
 		if (!so->cache_image) {
+			ss_readback_destroy(rb);
 			shared_output_destroy(so);
 			return;
 		}
 
-		pixman_region32_fini(&damage);
-		pixman_region32_init_rect(&damage, 0, 0, width, height);
+		pixman_region32_fini(&rb->buffer_damage);
+		pixman_region32_init_rect(&rb->buffer_damage,
+					  0, 0, width, height);
 	}
 
-	if (shared_output_ensure_tmp_data(so, &damage) < 0) {
-		shared_output_destroy(so);
+	rb->cache_width = width;
+	rb->cache_height = height;
+
+	if (!pixman_region32_not_empty(&rb->buffer_damage)) {
+		ss_readback_destroy(rb);
 		return;
 	}
 
-	do_yflip = !!(so->output->compositor->capabilities & WESTON_CAP_CAPTURE_YFLIP);
-
-	cache_data = pixman_image_get_data(so->cache_image);
-	r = pixman_region32_rectangles(&damage, &nrects);
-	for (i = 0; i < nrects; ++i) {
-		x = r[i].x1;
-		y = r[i].y1;
-		width = r[i].x2 - r[i].x1;
-		height = r[i].y2 - r[i].y1;
+	/* Read the whole damaged area at once; it is copied into the
+	 * cache when the pixels arrive, a frame later. */
+	e = pixman_region32_extents(&rb->buffer_damage);
+	rb->extents = *e;
 
-		if (do_yflip) {
-			so->output->compositor->renderer->read_pixels(
-				so->output, PIXMAN_a8r8g8b8, so->tmp_data,
-				x, so->output->current_mode->height - r[i].y2,
-				width, height);
-
-			pixman_blt(so->tmp_data, cache_data, -width, stride,
-				   32, 32, 0, 1 - height, x, y, width, height);
-		} else {
-			so->output->compositor->renderer->read_pixels(
-				so->output, PIXMAN_a8r8g8b8, so->tmp_data,
-				x, y, width, height);
-
-			pixman_blt(so->tmp_data, cache_data, width, stride,
-				   32, 32, 0, 0, x, y, width, height);
-		}
+	if (so->output->compositor->capabilities & WESTON_CAP_CAPTURE_YFLIP)
+		y = height - e->y2;
+	else
+		y = e->y1;
+
+	if (weston_output_read_pixels_async(so->output, PIXMAN_a8r8g8b8,
+					    e->x1, y,
+					    e->x2 - e->x1, e->y2 - e->y1,
+					    shared_output_read_pixels_done,
+					    rb) < 0) {
+		ss_readback_destroy(rb);
+		shared_output_destroy(so);
 	}
-
-	pixman_region32_fini(&damage);
-
-	so->cache_dirty = 1;
-
-	shared_output_update(so);
 }
 
 static struct shared_output *
@@ -956,6 +989,7 @@ shared_output_create(struct weston_output *output, int parent_fd)
 	/* Ok, everything's created.  We should be good to go */
 	wl_list_init(&so->shm.buffers);
 	wl_list_init(&so->shm.free_buffers);
+	wl_list_init(&so->readback_list);
 
 	so->output = output;
 	so->output_destroyed.notify = output_destroyed;
@@ -983,6 +1017,7 @@ static void
 shared_output_destroy(struct shared_output *so)
 {
 	struct ss_shm_buffer *buffer, *bnext;
+	struct ss_readback *rb, *rbnext;
 
 	so->output->disable_planes--;
 
@@ -997,8 +1032,15 @@ shared_output_destroy(struct shared_output *so)
 	wl_list_remove(&so->output_destroyed.link);
 	wl_list_remove(&so->frame_listener.link);
 
-	pixman_image_unref(so->cache_image);
-	free(so->tmp_data);
+	/* Reads still in flight complete without us. */
+	wl_list_for_each_safe(rb, rbnext, &so->readback_list, link) {
+		rb->so = NULL;
+		wl_list_remove(&rb->link);
+		wl_list_init(&rb->link);
+	}
+
+	if (so->cache_image)
+		pixman_image_unref(so->cache_image);
 
 	free(so);
 }
@@ -41,35 +41,49 @@
 struct screenshooter_frame_listener {
 	struct wl_listener listener;
 	struct weston_buffer *buffer;
+	struct wl_listener buffer_destroy_listener;
 	weston_screenshooter_done_func_t done;
 	void *data;
 };
 
 static void
-copy_bgra_yflip(uint8_t *dst, uint8_t *src, int height, int stride)
+copy_bgra_yflip(uint8_t *dst, int dst_stride,
+		const uint8_t *src, int src_stride, int height)
 {
 	uint8_t *end;
 
-	end = dst + height * stride;
+	end = dst + height * dst_stride;
 	while (dst < end) {
-		memcpy(dst, src, stride);
-		dst += stride;
-		src -= stride;
+		memcpy(dst, src, src_stride);
+		dst += dst_stride;
+		src -= src_stride;
 	}
 }
 
 static void
-copy_bgra(uint8_t *dst, uint8_t *src, int height, int stride)
+copy_bgra(uint8_t *dst, int dst_stride,
+	  const uint8_t *src, int src_stride, int height)
 {
-	/* TODO: optimize this out */
-	memcpy(dst, src, height * stride);
+	uint8_t *end;
+
+	if (dst_stride == src_stride) {
+		memcpy(dst, src, height * src_stride);
+		return;
+	}
+
+	end = dst + height * dst_stride;
+	while (dst < end) {
+		memcpy(dst, src, src_stride);
+		dst += dst_stride;
+		src += src_stride;
+	}
 }
 
 static void
-copy_row_swap_RB(void *vdst, void *vsrc, int bytes)
+copy_row_swap_RB(void *vdst, const void *vsrc, int bytes)
 {
 	uint32_t *dst = vdst;
-	uint32_t *src = vsrc;
+	const uint32_t *src = vsrc;
 	uint32_t *end = dst + bytes / 4;
 
 	while (dst < end) {
@@ -83,62 +97,80 @@ copy_row_swap_RB(void *vdst, void *vsrc, int bytes)
 }
 
 static void
-copy_rgba_yflip(uint8_t *dst, uint8_t *src, int height, int stride)
+copy_rgba_yflip(uint8_t *dst, int dst_stride,
+		const uint8_t *src, int src_stride, int height)
 {
 	uint8_t *end;
 
-	end = dst + height * stride;
+	end = dst + height * dst_stride;
 	while (dst < end) {
-		copy_row_swap_RB(dst, src, stride);
-		dst += stride;
-		src -= stride;
+		copy_row_swap_RB(dst, src, src_stride);
+		dst += dst_stride;
+		src -= src_stride;
 	}
 }
 
 static void
-copy_rgba(uint8_t *dst, uint8_t *src, int height, int stride)
+copy_rgba(uint8_t *dst, int dst_stride,
+	  const uint8_t *src, int src_stride, int height)
 {
 	uint8_t *end;
 
-	end = dst + height * stride;
+	end = dst + height * dst_stride;
 	while (dst < end) {
-		copy_row_swap_RB(dst, src, stride);
-		dst += stride;
-		src += stride;
+		copy_row_swap_RB(dst, src, src_stride);
+		dst += dst_stride;
+		src += src_stride;
 	}
 }
 
 static void
-screenshooter_frame_notify(struct wl_listener *listener, void *data)
+screenshooter_frame_listener_destroy(struct screenshooter_frame_listener *l)
+{
+	if (l->buffer)
+		wl_list_remove(&l->buffer_destroy_listener.link);
+	free(l);
+}
+
+static void
+screenshooter_buffer_destroyed(struct wl_listener *listener, void *data)
 {
 	struct screenshooter_frame_listener *l =
-		container_of(listener,
-			     struct screenshooter_frame_listener, listener);
-	struct weston_output *output = data;
+		container_of(listener, struct screenshooter_frame_listener,
+			     buffer_destroy_listener);
+
+	wl_list_remove(&l->buffer_destroy_listener.link);
+	l->buffer = NULL;
+}
+
+static void
+screenshooter_read_pixels_done(struct weston_output *output,
+			       const void *pixels, int32_t src_stride,
+			       void *data)
+{
+	struct screenshooter_frame_listener *l = data;
 	struct weston_compositor *compositor = output->compositor;
+	int32_t height = output->current_mode->height;
 	int32_t stride;
-	uint8_t *pixels, *d, *s;
+	const uint8_t *s;
+	uint8_t *d;
 
-	output->disable_planes--;
-	wl_list_remove(&listener->link);
-	stride = l->buffer->width * (PIXMAN_FORMAT_BPP(compositor->read_format) / 8);
-	pixels = malloc(stride * l->buffer->height);
+	if (l->buffer == NULL) {
+		l->done(l->data, WESTON_SCREENSHOOTER_BAD_BUFFER);
+		free(l);
+		return;
+	}
 
 	if (pixels == NULL) {
 		l->done(l->data, WESTON_SCREENSHOOTER_NO_MEMORY);
-		free(l);
+		screenshooter_frame_listener_destroy(l);
 		return;
 	}
 
-	compositor->renderer->read_pixels(output,
-			     compositor->read_format, pixels,
-			     0, 0, output->current_mode->width,
-			     output->current_mode->height);
-
 	stride = wl_shm_buffer_get_stride(l->buffer->shm_buffer);
 
 	d = wl_shm_buffer_get_data(l->buffer->shm_buffer);
-	s = pixels + stride * (l->buffer->height - 1);
+	s = (const uint8_t *) pixels + src_stride * (height - 1);
 
 	wl_shm_buffer_begin_access(l->buffer->shm_buffer);
 
@@ -146,16 +178,16 @@ screenshooter_frame_notify(struct wl_listener *listener, void *data)
 	case PIXMAN_a8r8g8b8:
 	case PIXMAN_x8r8g8b8:
 		if (compositor->capabilities & WESTON_CAP_CAPTURE_YFLIP)
-			copy_bgra_yflip(d, s, output->current_mode->height, stride);
+			copy_bgra_yflip(d, stride, s, src_stride, height);
 		else
-			copy_bgra(d, pixels, output->current_mode->height, stride);
+			copy_bgra(d, stride, pixels, src_stride, height);
 		break;
 	case PIXMAN_x8b8g8r8:
 	case PIXMAN_a8b8g8r8:
 		if (compositor->capabilities & WESTON_CAP_CAPTURE_YFLIP)
-			copy_rgba_yflip(d, s, output->current_mode->height, stride);
+			copy_rgba_yflip(d, stride, s, src_stride, height);
 		else
-			copy_rgba(d, pixels, output->current_mode->height, stride);
+			copy_rgba(d, stride, pixels, src_stride, height);
 		break;
 	default:
 		break;
@@ -164,8 +196,32 @@ screenshooter_frame_notify(struct wl_listener *listener, void *data)
 	wl_shm_buffer_end_access(l->buffer->shm_buffer);
 
 	l->done(l->data, WESTON_SCREENSHOOTER_SUCCESS);
-	free(pixels);
-	free(l);
+	screenshooter_frame_listener_destroy(l);
+}
+
+static void
+screenshooter_frame_notify(struct wl_listener *listener, void *data)
+{
+	struct screenshooter_frame_listener *l =
+		container_of(listener,
+			     struct screenshooter_frame_listener, listener);
+	struct weston_output *output = data;
+	struct weston_compositor *compositor = output->compositor;
+	int ret;
+
+	output->disable_planes--;
+	wl_list_remove(&listener->link);
+
+	ret = weston_output_read_pixels_async(output, compositor->read_format,
+					      0, 0,
+					      output->current_mode->width,
+					      output->current_mode->height,
+					      screenshooter_read_pixels_done,
+					      l);
+	if (ret < 0) {
+		l->done(l->data, WESTON_SCREENSHOOTER_NO_MEMORY);
+		screenshooter_frame_listener_destroy(l);
+	}
 }
 
 WL_EXPORT int
@@ -197,6 +253,8 @@ weston_screenshooter_shoot(struct weston_output *output,
 	}
 
 	l->buffer = buffer;
+	l->buffer_destroy_listener.notify = screenshooter_buffer_destroyed;
+	wl_signal_add(&buffer->destroy_signal, &l->buffer_destroy_listener);
 	l->done = done;
 	l->data = data;
 	l->listener.notify = screenshooter_frame_notify;
@@ -210,7 +268,6 @@ weston_screenshooter_shoot(struct weston_output *output,
 struct weston_recorder {
 	struct weston_output *output;
 	uint32_t *frame, *rect;
-	uint32_t *tmpbuf;
 	uint32_t total;
 	int fd;
 	struct wl_listener frame_listener;
@@ -251,18 +308,33 @@ component_delta(uint32_t next, uint32_t prev)
 static void
 weston_recorder_destroy(struct weston_recorder *recorder);
 
+/* Damage of one recorded frame, waiting for its pixels */
+struct weston_recorder_frame {
+	struct weston_recorder *recorder;
+	uint32_t msecs;
+	pixman_region32_t damage;
+	pixman_box32_t extents;
+};
+
 static void
-weston_recorder_frame_notify(struct wl_listener *listener, void *data)
+weston_recorder_frame_destroy(struct weston_recorder_frame *frame)
 {
-	struct weston_recorder *recorder =
-		container_of(listener, struct weston_recorder, frame_listener);
-	struct weston_output *output = data;
+	pixman_region32_fini(&frame->damage);
+	free(frame);
+}
+
+static void
+weston_recorder_read_pixels_done(struct weston_output *output,
+				 const void *pixels, int32_t src_stride,
+				 void *data)
+{
+	struct weston_recorder_frame *frame = data;
+	struct weston_recorder *recorder = frame->recorder;
 	struct weston_compositor *compositor = output->compositor;
-	uint32_t msecs = output->frame_time;
-	pixman_box32_t *r;
-	pixman_region32_t damage, transformed_damage;
-	int i, j, k, n, width, height, run, stride;
-	uint32_t delta, prev, *d, *s, *p, next;
+	pixman_box32_t *r, *e = &frame->extents;
+	int i, j, k, n, width, height, run, stride, row;
+	uint32_t delta, prev, *d, *p, next;
+	const uint32_t *s;
 	struct {
 		uint32_t msecs;
 		uint32_t nrects;
@@ -270,31 +342,20 @@ weston_recorder_frame_notify(struct wl_listener *listener, void *data)
 	struct iovec v[2];
 	int do_yflip;
 	int y_orig;
-	uint32_t *outbuf;
+	uint32_t *outbuf = recorder->rect;
 
-	do_yflip = !!(compositor->capabilities & WESTON_CAP_CAPTURE_YFLIP);
-	if (do_yflip)
-		outbuf = recorder->rect;
-	else
-		outbuf = recorder->tmpbuf;
-
-	pixman_region32_init(&damage);
-	pixman_region32_init(&transformed_damage);
-	pixman_region32_intersect(&damage, &output->region,
-				  &output->previous_damage);
-	pixman_region32_translate(&damage, -output->x, -output->y);
-	weston_transformed_region(output->width, output->height,
-				 output->transform, output->current_scale,
-				 &damage, &transformed_damage);
-	pixman_region32_fini(&damage);
-
-	r = pixman_region32_rectangles(&transformed_damage, &n);
-	if (n == 0) {
-		pixman_region32_fini(&transformed_damage);
+	if (pixels == NULL) {
+		weston_log("recorder: failed to read back output %s\n",
+			   output->name);
+		weston_recorder_frame_destroy(frame);
 		return;
 	}
 
-	header.msecs = msecs;
+	do_yflip = !!(compositor->capabilities & WESTON_CAP_CAPTURE_YFLIP);
+
+	r = pixman_region32_rectangles(&frame->damage, &n);
+
+	header.msecs = frame->msecs;
 	header.nrects = n;
 	v[0].iov_base = &header;
 	v[0].iov_len = sizeof header;
@@ -303,27 +364,23 @@ weston_recorder_frame_notify(struct wl_listener *listener, void *data)
 	recorder->total += writev(recorder->fd, v, 2);
 	stride = output->current_mode->width;
 
+	/* The pixels cover the extents of the damage, laid out as
+	 * read_pixels() would return them for that box. */
 	for (i = 0; i < n; i++) {
 		width = r[i].x2 - r[i].x1;
 		height = r[i].y2 - r[i].y1;
 
-		if (do_yflip)
-			y_orig = output->current_mode->height - r[i].y2;
-		else
-			y_orig = r[i].y1;
-
-		compositor->renderer->read_pixels(output,
-				compositor->read_format, recorder->rect,
-				r[i].x1, y_orig, width, height);
-
 		p = outbuf;
 		run = prev = 0; /* quiet gcc */
 		for (j = 0; j < height; j++) {
+			y_orig = r[i].y2 - j - 1;
 			if (do_yflip)
-				s = recorder->rect + width * j;
+				row = e->y2 - 1 - y_orig;
 			else
-				s = recorder->rect + width * (height - j - 1);
-			y_orig = r[i].y2 - j - 1;
+				row = y_orig - e->y1;
+			s = (const uint32_t *) ((const uint8_t *) pixels +
+						row * src_stride) +
+			    (r[i].x1 - e->x1);
 			d = recorder->frame + stride * y_orig + r[i].x1;
 
 			for (k = 0; k < width; k++) {
@@ -355,9 +412,67 @@ weston_recorder_frame_notify(struct wl_listener *listener, void *data)
 #endif
 	}
 
-	pixman_region32_fini(&transformed_damage);
 	recorder->count++;
+	weston_recorder_frame_destroy(frame);
+}
+
+static void
+weston_recorder_frame_notify(struct wl_listener *listener, void *data)
+{
+	struct weston_recorder *recorder =
+		container_of(listener, struct weston_recorder, frame_listener);
+	struct weston_output *output = data;
+	struct weston_compositor *compositor = output->compositor;
+	struct weston_recorder_frame *frame;
+	pixman_region32_t damage;
+	pixman_box32_t *e;
+	int y_orig;
+
+	frame = zalloc(sizeof *frame);
+	if (frame == NULL) {
+		weston_log("%s: out of memory\n", __func__);
+		goto out;
+	}
+
+	frame->recorder = recorder;
+	frame->msecs = output->frame_time;
+	pixman_region32_init(&frame->damage);
+
+	pixman_region32_init(&damage);
+	pixman_region32_intersect(&damage, &output->region,
+				  &output->previous_damage);
+	pixman_region32_translate(&damage, -output->x, -output->y);
+	weston_transformed_region(output->width, output->height,
+				 output->transform, output->current_scale,
+				 &damage, &frame->damage);
+	pixman_region32_fini(&damage);
 
+	if (!pixman_region32_not_empty(&frame->damage)) {
+		weston_recorder_frame_destroy(frame);
+		goto out;
+	}
+
+	/* Read the whole damaged area at once, so that a frame costs a
+	 * single read-back however fragmented its damage is. */
+	e = pixman_region32_extents(&frame->damage);
+	frame->extents = *e;
+
+	if (compositor->capabilities & WESTON_CAP_CAPTURE_YFLIP)
+		y_orig = output->current_mode->height - e->y2;
+	else
+		y_orig = e->y1;
+
+	if (weston_output_read_pixels_async(output, compositor->read_format,
+					    e->x1, y_orig,
+					    e->x2 - e->x1, e->y2 - e->y1,
+					    weston_recorder_read_pixels_done,
+					    frame) < 0) {
+		weston_log("recorder: failed to read back output %s\n",
+			   output->name);
+		weston_recorder_frame_destroy(frame);
+	}
+
+out:
 	if (recorder->destroying)
 		weston_recorder_destroy(recorder);
 }
@@ -368,7 +483,6 @@ weston_recorder_free(struct weston_recorder *recorder)
 	if (recorder == NULL)
 		return;
 
-	free(recorder->tmpbuf);
 	free(recorder->rect);
 	free(recorder->frame);
 	free(recorder);
@@ -381,9 +495,6 @@ weston_recorder_create(struct weston_output *output, const char *filename)
 	struct weston_recorder *recorder;
 	int stride, size;
 	struct { uint32_t magic, format, width, height; } header;
-	int do_yflip;
-
-	do_yflip = !!(compositor->capabilities & WESTON_CAP_CAPTURE_YFLIP);
 
 	recorder = zalloc(sizeof *recorder);
 	if (recorder == NULL) {
@@ -402,14 +513,6 @@ weston_recorder_create(struct weston_output *output, const char *filename)
 		goto err_recorder;
 	}
 
-	if (!do_yflip) {
-		recorder->tmpbuf = malloc(size);
-		if (recorder->tmpbuf == NULL) {
-			weston_log("%s: out of memory\n", __func__);
-			goto err_recorder;
-		}
-	}
-
 	header.magic = WCAP_HEADER_MAGIC;
 
 	switch (compositor->read_format) {
@@ -452,6 +555,9 @@ err_recorder:
 static void
 weston_recorder_destroy(struct weston_recorder *recorder)
 {
+	/* Write out the frames still being read back. */
+	weston_output_flush_read_pixels(recorder->output);
+
 	wl_list_remove(&recorder->frame_listener.link);
 	close(recorder->fd);
 	recorder->output->disable_planes--;
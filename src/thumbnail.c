@@ -0,0 +1,308 @@
+/*
+ * Copyright © 2026 The Weston Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "config.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "compositor.h"
+#include "shared/helpers.h"
+
+/* Downscaled snapshots of surface contents, for task switchers, HMI
+ * overviews and tools that want to show many surfaces at once without
+ * reading back every one of them on every frame.
+ *
+ * An entry is only regenerated when the renderer has taken in new
+ * contents for its surface (weston_surface::content_serial) or when it
+ * is asked for with different bounds. Entries are kept on a most
+ * recently used list and the least recently used ones are dropped once
+ * the cache holds more than its budget of pixel bytes.
+ */
+struct weston_thumbnail_cache {
+	struct weston_compositor *compositor;
+	size_t budget;
+	size_t bytes;
+	struct wl_list lru; /* weston_thumbnail::link, most recent first */
+};
+
+struct weston_thumbnail {
+	struct weston_thumbnail_cache *cache;
+	struct weston_surface *surface;
+	struct wl_listener surface_destroy_listener;
+	struct wl_list link;
+
+	pixman_image_t *image;
+	int max_width;
+	int max_height;
+	uint32_t content_serial;
+	size_t bytes;
+};
+
+static void
+thumbnail_destroy(struct weston_thumbnail *thumb)
+{
+	thumb->cache->bytes -= thumb->bytes;
+	if (thumb->image)
+		pixman_image_unref(thumb->image);
+	wl_list_remove(&thumb->surface_destroy_listener.link);
+	wl_list_remove(&thumb->link);
+	free(thumb);
+}
+
+static void
+thumbnail_handle_surface_destroy(struct wl_listener *listener, void *data)
+{
+	struct weston_thumbnail *thumb =
+		container_of(listener, struct weston_thumbnail,
+			     surface_destroy_listener);
+
+	thumbnail_destroy(thumb);
+}
+
+static struct weston_thumbnail *
+thumbnail_find(struct weston_thumbnail_cache *cache,
+	       struct weston_surface *surface)
+{
+	struct weston_thumbnail *thumb;
+
+	wl_list_for_each(thumb, &cache->lru, link)
+		if (thumb->surface == surface)
+			return thumb;
+
+	return NULL;
+}
+
+static pixman_image_t *
+thumbnail_render(struct weston_surface *surface,
+		 int max_width, int max_height)
+{
+	pixman_image_t *content, *image;
+	pixman_transform_t transform;
+	pixman_fixed_t *params = NULL;
+	pixman_fixed_t sx, sy;
+	const int bytespp = 4; /* PIXMAN_a8b8g8r8 */
+	double scale;
+	size_t size;
+	void *pixels;
+	int cw, ch, tw, th, n_params;
+	bool scaled;
+
+	weston_surface_get_content_size(surface, &cw, &ch);
+	if (cw <= 0 || ch <= 0)
+		return NULL;
+
+	scale = MIN((double) max_width / cw, (double) max_height / ch);
+	if (scale > 1.0)
+		scale = 1.0;
+	tw = cw * scale;
+	th = ch * scale;
+	if (tw < 1)
+		tw = 1;
+	if (th < 1)
+		th = 1;
+
+	size = (size_t) cw * ch * bytespp;
+	pixels = malloc(size);
+	if (!pixels)
+		return NULL;
+
+	if (weston_surface_copy_content(surface, pixels, size,
+					0, 0, cw, ch) < 0) {
+		free(pixels);
+		return NULL;
+	}
+
+	/* Every thumbnail pixel averages all of the contents it covers.
+	 * Bilinear filtering only looks at the nearest four pixels, which
+	 * aliases badly at the 5 to 20 times reductions thumbnails use. */
+	scaled = tw != cw || th != ch;
+	sx = pixman_double_to_fixed((double) cw / tw);
+	sy = pixman_double_to_fixed((double) ch / th);
+	if (scaled)
+		params = pixman_filter_create_separable_convolution(
+				&n_params, sx, sy,
+				PIXMAN_KERNEL_BOX, PIXMAN_KERNEL_BOX,
+				PIXMAN_KERNEL_BOX, PIXMAN_KERNEL_BOX, 4, 4);
+
+	content = pixman_image_create_bits(PIXMAN_a8b8g8r8, cw, ch,
+					   pixels, cw * bytespp);
+	image = pixman_image_create_bits(PIXMAN_a8b8g8r8, tw, th, NULL, 0);
+	if (!content || !image || (scaled && !params)) {
+		if (content)
+			pixman_image_unref(content);
+		if (image)
+			pixman_image_unref(image);
+		free(params);
+		free(pixels);
+		return NULL;
+	}
+
+	if (scaled) {
+		pixman_transform_init_scale(&transform, sx, sy);
+		pixman_image_set_transform(content, &transform);
+		pixman_image_set_filter(content,
+					PIXMAN_FILTER_SEPARABLE_CONVOLUTION,
+					params, n_params);
+		pixman_image_set_repeat(content, PIXMAN_REPEAT_PAD);
+		free(params);
+	}
+
+	pixman_image_composite32(PIXMAN_OP_SRC, content, NULL, image,
+				 0, 0, 0, 0, 0, 0, tw, th);
+
+	pixman_image_unref(content);
+	free(pixels);
+
+	return image;
+}
+
+static void
+thumbnail_cache_evict(struct weston_thumbnail_cache *cache,
+		      struct weston_thumbnail *keep)
+{
+	struct weston_thumbnail *thumb, *prev;
+
+	wl_list_for_each_reverse_safe(thumb, prev, &cache->lru, link) {
+		if (cache->bytes <= cache->budget)
+			break;
+		if (thumb != keep)
+			thumbnail_destroy(thumb);
+	}
+}
+
+/** Create a thumbnail cache
+ *
+ * \param compositor The compositor whose surfaces will be snapshotted.
+ * \param budget Maximum number of pixel bytes to keep around.
+ * \return A new cache, or NULL on allocation failure.
+ *
+ * The most recently requested thumbnail is always kept, even when it
+ * alone is larger than the budget.
+ */
+WL_EXPORT struct weston_thumbnail_cache *
+weston_thumbnail_cache_create(struct weston_compositor *compositor,
+			      size_t budget)
+{
+	struct weston_thumbnail_cache *cache;
+
+	cache = zalloc(sizeof *cache);
+	if (!cache)
+		return NULL;
+
+	cache->compositor = compositor;
+	cache->budget = budget;
+	wl_list_init(&cache->lru);
+
+	return cache;
+}
+
+WL_EXPORT void
+weston_thumbnail_cache_destroy(struct weston_thumbnail_cache *cache)
+{
+	struct weston_thumbnail *thumb, *next;
+
+	wl_list_for_each_safe(thumb, next, &cache->lru, link)
+		thumbnail_destroy(thumb);
+
+	free(cache);
+}
+
+/** Get a downscaled snapshot of a surface
+ *
+ * \param cache The thumbnail cache.
+ * \param surface The surface to snapshot.
+ * \param max_width Maximum width of the thumbnail.
+ * \param max_height Maximum height of the thumbnail.
+ * \return A PIXMAN_a8b8g8r8 image the caller must pixman_image_unref(),
+ * or NULL if the surface has no contents or the renderer cannot copy
+ * them.
+ *
+ * The thumbnail keeps the aspect ratio of the surface contents and is
+ * never scaled up. It is read back from the renderer only if the surface
+ * got new contents since the last call for the same bounds; otherwise
+ * the cached image is returned.
+ */
+WL_EXPORT pixman_image_t *
+weston_thumbnail_cache_get(struct weston_thumbnail_cache *cache,
+			   struct weston_surface *surface,
+			   int max_width, int max_height)
+{
+	struct weston_thumbnail *thumb;
+	pixman_image_t *image;
+
+	if (max_width <= 0 || max_height <= 0)
+		return NULL;
+
+	thumb = thumbnail_find(cache, surface);
+	if (thumb && thumb->image &&
+	    thumb->content_serial == surface->content_serial &&
+	    thumb->max_width == max_width &&
+	    thumb->max_height == max_height)
+		goto out;
+
+	image = thumbnail_render(surface, max_width, max_height);
+	if (!image) {
+		if (thumb)
+			thumbnail_destroy(thumb);
+		return NULL;
+	}
+
+	if (!thumb) {
+		thumb = zalloc(sizeof *thumb);
+		if (!thumb) {
+			pixman_image_unref(image);
+			return NULL;
+		}
+
+		thumb->cache = cache;
+		thumb->surface = surface;
+		thumb->surface_destroy_listener.notify =
+			thumbnail_handle_surface_destroy;
+		wl_signal_add(&surface->destroy_signal,
+			      &thumb->surface_destroy_listener);
+		wl_list_insert(&cache->lru, &thumb->link);
+	}
+
+	cache->bytes -= thumb->bytes;
+	if (thumb->image)
+		pixman_image_unref(thumb->image);
+
+	thumb->image = image;
+	thumb->max_width = max_width;
+	thumb->max_height = max_height;
+	thumb->content_serial = surface->content_serial;
+	thumb->bytes = (size_t) pixman_image_get_stride(image) *
+		       pixman_image_get_height(image);
+	cache->bytes += thumb->bytes;
+
+out:
+	wl_list_remove(&thumb->link);
+	wl_list_insert(&cache->lru, &thumb->link);
+	thumbnail_cache_evict(cache, thumb);
+
+	return pixman_image_ref(thumb->image);
+}
@@ -116,5 +116,16 @@ typedef struct wl_buffer * (EGLAPIENTRYP PFNEGLCREATEWAYLANDBUFFERFROMIMAGEWL) (
 #define EGL_DMA_BUF_PLANE2_PITCH_EXT				0x327A
 #endif
 
+/* Tokens from GL_NV_pixel_buffer_object and GL_EXT_map_buffer_range,
+ * which are core in GLES 3.0, used for asynchronous read-back. */
+#ifndef GL_PIXEL_PACK_BUFFER
+#define GL_PIXEL_PACK_BUFFER					0x88EB
+#endif
+#ifndef GL_STREAM_READ
+#define GL_STREAM_READ						0x88E1
+#endif
+#ifndef GL_MAP_READ_BIT
+#define GL_MAP_READ_BIT						0x0001
+#endif
 
 #endif
@@ -0,0 +1,46 @@
+/*
+ * Copyright © 2026 The Weston Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef WESTON_TEST_BENCHMARK_H
+#define WESTON_TEST_BENCHMARK_H
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Some tests also time what they exercise. Timings are not pass/fail
+ * and only add run time and noise to "make check", so they are only
+ * taken and reported with WESTON_TEST_BENCHMARK=1 in the environment,
+ * as "make check-bench" does.
+ */
+static inline bool
+benchmark_enabled(void)
+{
+	const char *env = getenv("WESTON_TEST_BENCHMARK");
+
+	return env && strcmp(env, "0") != 0;
+}
+
+#endif /* WESTON_TEST_BENCHMARK_H */
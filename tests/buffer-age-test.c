@@ -0,0 +1,151 @@
+/*
+ * Copyright © 2026 The Weston Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "config.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "weston-test-client-helper.h"
+
+char *server_parameters="--use-pixman --width=320 --height=240";
+
+#define SURFACE_X 60
+#define SURFACE_Y 60
+#define SURFACE_WIDTH 160
+#define SURFACE_HEIGHT 120
+#define NUM_FRAMES 120
+
+static void
+fill_rect(uint32_t *pixels, const struct rectangle *rect, uint32_t color)
+{
+	int x, y;
+
+	for (y = rect->y; y < rect->y + rect->height; y++)
+		for (x = rect->x; x < rect->x + rect->width; x++)
+			pixels[y * SURFACE_WIDTH + x] = color;
+}
+
+static void
+random_rect(struct rectangle *rect)
+{
+	rect->width = 1 + rand() % (SURFACE_WIDTH / 3);
+	rect->height = 1 + rand() % (SURFACE_HEIGHT / 3);
+	rect->x = rand() % (SURFACE_WIDTH - rect->width + 1);
+	rect->y = rand() % (SURFACE_HEIGHT - rect->height + 1);
+}
+
+/* Compares the surface area of the output with what the client drew,
+ * ignoring the alpha byte which is undefined in an xrgb output. */
+static int
+check_screenshot(struct client *client, const uint32_t *pixels)
+{
+	struct surface *screenshot;
+	const uint32_t *shot;
+	int x, y, bad = 0;
+
+	screenshot = capture_screenshot_of_output(client);
+	assert(screenshot);
+	shot = screenshot->data;
+
+	for (y = 0; y < SURFACE_HEIGHT; y++) {
+		for (x = 0; x < SURFACE_WIDTH; x++) {
+			uint32_t want = pixels[y * SURFACE_WIDTH + x];
+			uint32_t got = shot[(SURFACE_Y + y) * screenshot->width +
+					    SURFACE_X + x];
+
+			if ((want & 0xffffff) == (got & 0xffffff))
+				continue;
+
+			if (bad++ == 0)
+				printf("first mismatch at %d,%d: "
+				       "got %08x, want %08x\n",
+				       x, y, got, want);
+		}
+	}
+
+	free(screenshot);
+
+	return bad;
+}
+
+TEST(buffer_age_random_damage)
+{
+	struct client *client;
+	struct wl_surface *surface;
+	struct wl_buffer *buffer;
+	struct rectangle full = { 0, 0, SURFACE_WIDTH, SURFACE_HEIGHT };
+	struct rectangle rect;
+	uint32_t *pixels;
+	int frame, done, bad = 0;
+
+	client = create_client_and_test_surface(SURFACE_X, SURFACE_Y,
+						SURFACE_WIDTH, SURFACE_HEIGHT);
+	assert(client);
+	surface = client->surface->wl_surface;
+
+	buffer = create_shm_buffer(client, SURFACE_WIDTH, SURFACE_HEIGHT,
+				   (void **) &pixels);
+	fill_rect(pixels, &full, 0xff204060);
+
+	wl_surface_attach(surface, buffer, 0, 0);
+	wl_surface_damage(surface, 0, 0, SURFACE_WIDTH, SURFACE_HEIGHT);
+	frame_callback_set(surface, &done);
+	wl_surface_commit(surface);
+	frame_callback_wait(client, &done);
+
+	/* Each frame damages a different small rect, so the output
+	 * buffers fall behind by a frame's damage every flip. A buffer
+	 * repainted with only the latest damage shows stale rects. */
+	srand(4242);
+	for (frame = 0; frame < NUM_FRAMES; frame++) {
+		random_rect(&rect);
+		fill_rect(pixels, &rect,
+			  0xff000000 | (rand() & 0xffffff));
+
+		wl_surface_attach(surface, buffer, 0, 0);
+		wl_surface_damage(surface, rect.x, rect.y,
+				  rect.width, rect.height);
+		frame_callback_set(surface, &done);
+		wl_surface_commit(surface);
+		frame_callback_wait(client, &done);
+
+		/* Screenshots repaint too, check both buffers every
+		 * so often. */
+		if (frame % 7 == 0) {
+			bad += check_screenshot(client, pixels);
+			bad += check_screenshot(client, pixels);
+		}
+	}
+
+	bad += check_screenshot(client, pixels);
+	bad += check_screenshot(client, pixels);
+
+	printf("%d mismatched pixels\n", bad);
+	assert(bad == 0);
+
+	wl_buffer_destroy(buffer);
+}
@@ -0,0 +1,184 @@
+/*
+ * Copyright © 2026 The Weston Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <time.h>
+
+#include "src/compositor.h"
+#include "shared/helpers.h"
+#include "shared/timespec-util.h"
+#include "benchmark.h"
+
+#define CAPTURE_FRAMES 60
+
+/* Reads back an output both ways once per frame period and checks that
+ * the asynchronous read-back delivers the same pixels. As a benchmark,
+ * also reports what each costs the compositor. */
+struct capture_test {
+	struct weston_compositor *compositor;
+	struct weston_output *output;
+	struct wl_event_source *timer;
+	int frames_requested;
+	int frames_done;
+	int64_t sync_nsec;
+	int64_t async_nsec;
+};
+
+struct capture_frame {
+	struct capture_test *test;
+	void *expected;
+	size_t size;
+};
+
+static void
+capture_check_done(struct capture_test *test)
+{
+	struct weston_output *output = test->output;
+
+	if (test->frames_done < CAPTURE_FRAMES ||
+	    test->frames_requested < CAPTURE_FRAMES)
+		return;
+
+	if (benchmark_enabled())
+		fprintf(stderr, "%dx%d, %d frames: read_pixels %.1f us/frame, "
+			"read_pixels_async %.1f us/frame\n",
+			output->current_mode->width,
+			output->current_mode->height, CAPTURE_FRAMES,
+			test->sync_nsec / 1000.0 / CAPTURE_FRAMES,
+			test->async_nsec / 1000.0 / CAPTURE_FRAMES);
+
+	wl_display_terminate(test->compositor->wl_display);
+}
+
+static void
+capture_done(struct weston_output *output, const void *pixels,
+	     int32_t stride, void *data)
+{
+	struct capture_frame *frame = data;
+	struct capture_test *test = frame->test;
+
+	assert(pixels);
+	assert((size_t) stride * output->current_mode->height == frame->size);
+	assert(memcmp(pixels, frame->expected, frame->size) == 0);
+
+	free(frame->expected);
+	free(frame);
+
+	test->frames_done++;
+	capture_check_done(test);
+}
+
+static int
+capture_tick(void *data)
+{
+	struct capture_test *test = data;
+	struct weston_output *output = test->output;
+	struct weston_compositor *compositor = test->compositor;
+	int32_t width = output->current_mode->width;
+	int32_t height = output->current_mode->height;
+	struct capture_frame *frame;
+	struct timespec t0, t1, t2;
+	int ret;
+
+	frame = zalloc(sizeof *frame);
+	assert(frame);
+	frame->test = test;
+	frame->size = width * height * 4;
+	frame->expected = malloc(frame->size);
+	assert(frame->expected);
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	ret = compositor->renderer->read_pixels(output, compositor->read_format,
+						frame->expected,
+						0, 0, width, height);
+	assert(ret == 0);
+
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	ret = weston_output_read_pixels_async(output, compositor->read_format,
+					      0, 0, width, height,
+					      capture_done, frame);
+	assert(ret == 0);
+	clock_gettime(CLOCK_MONOTONIC, &t2);
+
+	test->sync_nsec += timespec_sub_to_nsec(&t1, &t0);
+	test->async_nsec += timespec_sub_to_nsec(&t2, &t1);
+
+	/* Repaints hand out completed read-backs, keep them coming. */
+	if (++test->frames_requested < CAPTURE_FRAMES) {
+		weston_output_damage(output);
+		wl_event_source_timer_update(test->timer, 16);
+	}
+
+	capture_check_done(test);
+
+	return 0;
+}
+
+static void
+capture_start(void *data)
+{
+	struct weston_compositor *compositor = data;
+	struct wl_event_loop *loop;
+	struct capture_test *test;
+
+	assert(!wl_list_empty(&compositor->output_list));
+
+	/* capture-test.ini selects the pixman renderer; without
+	 * asynchronous read-back there is nothing to test. */
+	if (!compositor->renderer->read_pixels_async) {
+		weston_log("capture-test: renderer has no read_pixels_async\n");
+		weston_compositor_exit_with_code(compositor, EXIT_FAILURE);
+		return;
+	}
+
+	test = zalloc(sizeof *test);
+	assert(test);
+	test->compositor = compositor;
+	test->output = container_of(compositor->output_list.next,
+				    struct weston_output, link);
+
+	loop = wl_display_get_event_loop(compositor->wl_display);
+	test->timer = wl_event_loop_add_timer(loop, capture_tick, test);
+	assert(test->timer);
+	wl_event_source_timer_update(test->timer, 16);
+}
+
+WL_EXPORT int
+module_init(struct weston_compositor *compositor, int *argc, char *argv[])
+{
+	struct wl_event_loop *loop;
+
+	loop = wl_display_get_event_loop(compositor->wl_display);
+
+	wl_event_loop_add_idle(loop, capture_start, compositor);
+
+	return 0;
+}
@@ -0,0 +1,201 @@
+/*
+ * Copyright © 2026 The Weston Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "config.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <assert.h>
+#include <time.h>
+
+#include "shared/helpers.h"
+#include "shared/timespec-util.h"
+#include "weston-test-client-helper.h"
+#include "benchmark.h"
+
+#define NUM_COMMITS 20000
+#define COMMITS_PER_ROUNDTRIP 500
+
+static bool
+near(double a, double b)
+{
+	return a - b < 0.01 && b - a < 0.01;
+}
+
+/* Checks that the surface point x, y lands on bx, by in the buffer,
+ * both as computed from scratch and through the cached surface to
+ * buffer matrix, and returns the serial of that matrix. */
+static uint32_t
+check_buffer_position(struct client *client, double x, double y,
+		      double bx, double by)
+{
+	struct test *test = client->test;
+
+	get_buffer_position(client, x, y);
+
+	fprintf(stderr, "%g,%g maps to %g,%g, matrix %g,%g (serial %u)\n",
+		x, y, test->buffer_x, test->buffer_y,
+		test->buffer_matrix_x, test->buffer_matrix_y,
+		test->buffer_matrix_serial);
+
+	assert(near(test->buffer_x, bx) && near(test->buffer_y, by));
+	assert(near(test->buffer_matrix_x, bx) &&
+	       near(test->buffer_matrix_y, by));
+
+	return test->buffer_matrix_serial;
+}
+
+static void
+commit_buffer(struct client *client, struct wl_buffer *buffer)
+{
+	struct wl_surface *surface = client->surface->wl_surface;
+
+	wl_surface_attach(surface, buffer, 0, 0);
+	wl_surface_damage(surface, 0, 0, 64, 64);
+	wl_surface_commit(surface);
+}
+
+TEST(buffer_matrix_kept_for_new_content)
+{
+	struct client *client;
+	struct wl_buffer *buffers[4];
+	uint32_t serial;
+	unsigned int i;
+
+	client = create_client_and_test_surface(10, 10, 64, 64);
+	assert(client);
+
+	serial = check_buffer_position(client, 10, 20, 10, 20);
+
+	/* New content with the same size and viewport. */
+	for (i = 0; i < ARRAY_LENGTH(buffers); i++) {
+		buffers[i] = create_shm_buffer(client, 64, 64, NULL);
+		commit_buffer(client, buffers[i]);
+		assert(check_buffer_position(client, 10, 20, 10, 20) ==
+		       serial);
+	}
+
+	for (i = 0; i < ARRAY_LENGTH(buffers); i++)
+		wl_buffer_destroy(buffers[i]);
+}
+
+TEST(buffer_matrix_rebuilt_on_change)
+{
+	struct client *client;
+	struct wl_surface *surface;
+	struct wl_buffer *square, *tall;
+	uint32_t serial;
+
+	client = create_client_and_test_surface(10, 10, 64, 64);
+	assert(client);
+	surface = client->surface->wl_surface;
+
+	serial = check_buffer_position(client, 10, 20, 10, 20);
+
+	square = create_shm_buffer(client, 64, 64, NULL);
+	tall = create_shm_buffer(client, 32, 64, NULL);
+
+	/* Buffer scale: the surface is 32x32. */
+	wl_surface_set_buffer_scale(surface, 2);
+	commit_buffer(client, square);
+	assert(check_buffer_position(client, 10, 20, 20, 40) > serial);
+	serial = client->test->buffer_matrix_serial;
+
+	/* Buffer transform: y in the surface runs right to left
+	 * along the buffer rows. */
+	wl_surface_set_buffer_scale(surface, 1);
+	wl_surface_set_buffer_transform(surface, WL_OUTPUT_TRANSFORM_90);
+	commit_buffer(client, square);
+	assert(check_buffer_position(client, 10, 20, 64 - 20, 10) > serial);
+	serial = client->test->buffer_matrix_serial;
+
+	/* Buffer size alone: the surface is now 64x32. */
+	commit_buffer(client, tall);
+	assert(check_buffer_position(client, 10, 20, 32 - 20, 10) > serial);
+	serial = client->test->buffer_matrix_serial;
+
+	/* And it sticks with the new size. */
+	commit_buffer(client, tall);
+	assert(check_buffer_position(client, 10, 20, 32 - 20, 10) == serial);
+
+	wl_buffer_destroy(square);
+	wl_buffer_destroy(tall);
+}
+
+static double
+commit_rate(struct client *client, struct wl_buffer *buffer, int vary_scale)
+{
+	struct wl_surface *surface = client->surface->wl_surface;
+	struct timespec begin, end;
+	int i;
+
+	clock_gettime(CLOCK_MONOTONIC, &begin);
+
+	for (i = 0; i < NUM_COMMITS; i++) {
+		/* Changing the buffer scale forces the compositor to
+		 * rebuild the buffer to surface mapping. */
+		if (vary_scale)
+			wl_surface_set_buffer_scale(surface, 1 + i % 2);
+		wl_surface_attach(surface, buffer, 0, 0);
+		wl_surface_damage(surface, 0, 0, 16, 16);
+		wl_surface_commit(surface);
+
+		if ((i + 1) % COMMITS_PER_ROUNDTRIP == 0)
+			client_roundtrip(client);
+	}
+
+	client_roundtrip(client);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	return NUM_COMMITS / (timespec_sub_to_nsec(&end, &begin) / 1e9);
+}
+
+/* Benchmark: how many commits per second the compositor sustains for a
+ * client that only attaches new content, and for one that also changes
+ * its buffer scale every time. */
+TEST(commit_throughput)
+{
+	struct client *client;
+	struct wl_buffer *buffer;
+	double same, varying;
+
+	if (!benchmark_enabled())
+		return;
+
+	client = create_client_and_test_surface(10, 10, 64, 64);
+	assert(client);
+
+	buffer = create_shm_buffer(client, 64, 64, NULL);
+	assert(buffer);
+
+	same = commit_rate(client, buffer, 0);
+	varying = commit_rate(client, buffer, 1);
+
+	fprintf(stderr, "%d commits: %.0f commits/s unchanged, "
+		"%.0f commits/s with buffer scale changes\n",
+		NUM_COMMITS, same, varying);
+
+	wl_buffer_destroy(buffer);
+}
@@ -0,0 +1,153 @@
+/*
+ * Copyright © 2026 The Weston Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "shared/timespec-util.h"
+#include "weston-test-client-helper.h"
+
+#define TEST_MSEC 1000
+/* Must match occluded-frame-rate in frame-throttle.ini */
+#define OCCLUDED_FRAME_RATE 4
+
+struct frame_counter {
+	struct wl_surface *surface;
+	struct wl_buffer *buffer;
+	int count;
+	int pending;
+};
+
+static void
+frame_done(void *data, struct wl_callback *callback, uint32_t time)
+{
+	struct frame_counter *counter = data;
+
+	wl_callback_destroy(callback);
+	counter->count++;
+	counter->pending = 0;
+}
+
+static const struct wl_callback_listener frame_listener = {
+	frame_done
+};
+
+/* Redraws like a client animating as fast as it is told to. */
+static void
+counter_frame(struct frame_counter *counter)
+{
+	struct wl_callback *callback;
+
+	callback = wl_surface_frame(counter->surface);
+	wl_callback_add_listener(callback, &frame_listener, counter);
+	if (counter->buffer) {
+		wl_surface_attach(counter->surface, counter->buffer, 0, 0);
+		wl_surface_damage(counter->surface, 0, 0, 64, 64);
+	}
+	wl_surface_commit(counter->surface);
+	counter->pending = 1;
+}
+
+static struct wl_subcompositor *
+get_subcompositor(struct client *client)
+{
+	struct global *g;
+
+	wl_list_for_each(g, &client->global_list, link) {
+		if (strcmp(g->interface, "wl_subcompositor") == 0)
+			return wl_registry_bind(client->wl_registry, g->name,
+						&wl_subcompositor_interface, 1);
+	}
+
+	assert(0 && "no wl_subcompositor found");
+	return NULL;
+}
+
+static int64_t
+elapsed_msec(const struct timespec *begin)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return timespec_sub_to_nsec(&now, begin) / 1000000;
+}
+
+TEST(occluded_surface_is_throttled)
+{
+	struct client *client;
+	struct wl_subcompositor *subco;
+	struct wl_subsurface *sub;
+	struct wl_region *opaque;
+	struct frame_counter parent = { 0 }, child = { 0 };
+	struct timespec begin;
+
+	client = create_client_and_test_surface(10, 10, 64, 64);
+	assert(client);
+
+	/* An opaque sub-surface on top covers its parent completely. */
+	subco = get_subcompositor(client);
+	child.surface = wl_compositor_create_surface(client->wl_compositor);
+	sub = wl_subcompositor_get_subsurface(subco, child.surface,
+					      client->surface->wl_surface);
+	wl_subsurface_set_desync(sub);
+
+	opaque = wl_compositor_create_region(client->wl_compositor);
+	wl_region_add(opaque, 0, 0, 64, 64);
+	wl_surface_set_opaque_region(child.surface, opaque);
+	wl_region_destroy(opaque);
+
+	child.buffer = create_shm_buffer(client, 64, 64, NULL);
+	parent.surface = client->surface->wl_surface;
+
+	wl_surface_commit(parent.surface);
+	counter_frame(&child);
+	while (child.pending)
+		assert(wl_display_dispatch(client->wl_display) >= 0);
+	child.count = 0;
+
+	clock_gettime(CLOCK_MONOTONIC, &begin);
+	while (elapsed_msec(&begin) < TEST_MSEC) {
+		if (!parent.pending)
+			counter_frame(&parent);
+		if (!child.pending)
+			counter_frame(&child);
+		assert(wl_display_dispatch(client->wl_display) >= 0);
+	}
+
+	fprintf(stderr, "in %d ms: %d frames visible, %d frames occluded\n",
+		TEST_MSEC, child.count, parent.count);
+
+	/* Allow for the edges of the measurement. */
+	assert(parent.count <= TEST_MSEC * OCCLUDED_FRAME_RATE / 1000 + 2);
+	assert(child.count > 2 * parent.count);
+
+	wl_subsurface_destroy(sub);
+	wl_surface_destroy(child.surface);
+	wl_buffer_destroy(child.buffer);
+	wl_subcompositor_destroy(subco);
+}
@@ -0,0 +1,241 @@
+/*
+ * Copyright © 2026 The Weston Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "config.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "shared/hash.h"
+#include "shared/helpers.h"
+#include "shared/timespec-util.h"
+#include "zunitc/zunitc.h"
+#include "benchmark.h"
+
+/* X servers hand out window ids from a per-client base. */
+#define WINDOW_ID_BASE 0x00a00000
+#define NUM_WINDOWS 4096
+
+static void *
+id_data(uint32_t id)
+{
+	return (void *) (uintptr_t) (id ^ 0x5a5a5a5a);
+}
+
+static void
+count_entry(void *element, void *data)
+{
+	uint32_t *count = data;
+
+	(*count)++;
+}
+
+ZUC_TEST(hash_test, empty)
+{
+	struct hash_table *ht = hash_table_create();
+
+	ZUC_ASSERT_NOT_NULL(ht);
+	ZUC_ASSERT_EQ(0, hash_table_count(ht));
+	ZUC_ASSERT_NULL(hash_table_lookup(ht, 0));
+	ZUC_ASSERT_NULL(hash_table_lookup(ht, WINDOW_ID_BASE));
+
+	hash_table_remove(ht, WINDOW_ID_BASE);
+	ZUC_ASSERT_EQ(0, hash_table_count(ht));
+
+	hash_table_destroy(ht);
+}
+
+ZUC_TEST(hash_test, insert_lookup_remove)
+{
+	struct hash_table *ht = hash_table_create();
+	uint32_t count = 0;
+	uint32_t i;
+
+	ZUC_ASSERT_NOT_NULL(ht);
+
+	for (i = 0; i < NUM_WINDOWS; i++)
+		ZUC_ASSERTG_EQ(0, hash_table_insert(ht, WINDOW_ID_BASE + i,
+						    id_data(WINDOW_ID_BASE + i)),
+			       out);
+	ZUC_ASSERTG_EQ(NUM_WINDOWS, hash_table_count(ht), out);
+
+	for (i = 0; i < NUM_WINDOWS; i++)
+		ZUC_ASSERTG_EQ(id_data(WINDOW_ID_BASE + i),
+			       hash_table_lookup(ht, WINDOW_ID_BASE + i), out);
+	ZUC_ASSERTG_NULL(hash_table_lookup(ht, WINDOW_ID_BASE + NUM_WINDOWS),
+			 out);
+
+	/* Remove every other window, the rest must stay reachable. */
+	for (i = 0; i < NUM_WINDOWS; i += 2)
+		hash_table_remove(ht, WINDOW_ID_BASE + i);
+	ZUC_ASSERTG_EQ(NUM_WINDOWS / 2, hash_table_count(ht), out);
+
+	for (i = 0; i < NUM_WINDOWS; i++) {
+		if (i % 2)
+			ZUC_ASSERTG_EQ(id_data(WINDOW_ID_BASE + i),
+				       hash_table_lookup(ht,
+							 WINDOW_ID_BASE + i),
+				       out);
+		else
+			ZUC_ASSERTG_NULL(hash_table_lookup(ht,
+							   WINDOW_ID_BASE + i),
+					 out);
+	}
+
+	hash_table_for_each(ht, count_entry, &count);
+	ZUC_ASSERTG_EQ(NUM_WINDOWS / 2, count, out);
+
+	for (i = 1; i < NUM_WINDOWS; i += 2)
+		hash_table_remove(ht, WINDOW_ID_BASE + i);
+	ZUC_ASSERTG_EQ(0, hash_table_count(ht), out);
+
+out:
+	hash_table_destroy(ht);
+}
+
+ZUC_TEST(hash_test, insert_replaces)
+{
+	struct hash_table *ht = hash_table_create();
+	int a, b;
+
+	ZUC_ASSERT_NOT_NULL(ht);
+
+	ZUC_ASSERTG_EQ(0, hash_table_insert(ht, 42, &a), out);
+	ZUC_ASSERTG_EQ(0, hash_table_insert(ht, 42, &b), out);
+	ZUC_ASSERTG_EQ(1, hash_table_count(ht), out);
+	ZUC_ASSERTG_EQ(&b, hash_table_lookup(ht, 42), out);
+
+	hash_table_remove(ht, 42);
+	ZUC_ASSERTG_NULL(hash_table_lookup(ht, 42), out);
+
+out:
+	hash_table_destroy(ht);
+}
+
+ZUC_TEST(hash_test, churn)
+{
+	struct hash_table *ht = hash_table_create();
+	uint32_t i, round;
+
+	ZUC_ASSERT_NOT_NULL(ht);
+
+	/* Windows coming and going must not degrade the table: ids are
+	 * never reused, so a table keeping tombstones would fill up. */
+	for (round = 0; round < 64; round++) {
+		uint32_t base = WINDOW_ID_BASE + round * NUM_WINDOWS;
+
+		for (i = 0; i < NUM_WINDOWS; i++)
+			ZUC_ASSERTG_EQ(0, hash_table_insert(ht, base + i,
+							    id_data(base + i)),
+				       out);
+		for (i = 0; i < NUM_WINDOWS; i++)
+			ZUC_ASSERTG_EQ(id_data(base + i),
+				       hash_table_lookup(ht, base + i), out);
+		for (i = 0; i < NUM_WINDOWS; i++)
+			hash_table_remove(ht, base + i);
+		ZUC_ASSERTG_EQ(0, hash_table_count(ht), out);
+	}
+
+out:
+	hash_table_destroy(ht);
+}
+
+ZUC_TEST(hash_test, colliding_keys)
+{
+	struct hash_table *ht = hash_table_create();
+	uint32_t i;
+
+	ZUC_ASSERT_NOT_NULL(ht);
+
+	/* Keys differing only in their high bits, removed in an order
+	 * that exercises the backward shift of probe sequences. */
+	for (i = 0; i < 256; i++)
+		ZUC_ASSERTG_EQ(0, hash_table_insert(ht, i << 24, id_data(i)),
+			       out);
+	for (i = 0; i < 256; i += 3)
+		hash_table_remove(ht, i << 24);
+	for (i = 0; i < 256; i++) {
+		if (i % 3)
+			ZUC_ASSERTG_EQ(id_data(i),
+				       hash_table_lookup(ht, i << 24), out);
+		else
+			ZUC_ASSERTG_NULL(hash_table_lookup(ht, i << 24), out);
+	}
+
+out:
+	hash_table_destroy(ht);
+}
+
+/* Benchmark: reports the cost of the operations the X window manager
+ * does, with a realistic number of windows. */
+ZUC_TEST(hash_test, throughput)
+{
+	struct hash_table *ht;
+	struct timespec t0, t1, t2, t3;
+	const uint32_t rounds = 64;
+	const double ops = rounds * NUM_WINDOWS;
+	uint32_t i, round;
+	uintptr_t sum = 0;
+
+	if (!benchmark_enabled())
+		return;
+
+	ht = hash_table_create();
+	ZUC_ASSERT_NOT_NULL(ht);
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (round = 0; round < rounds; round++)
+		for (i = 0; i < NUM_WINDOWS; i++)
+			hash_table_insert(ht, WINDOW_ID_BASE + i,
+					  id_data(WINDOW_ID_BASE + i));
+
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	for (round = 0; round < rounds; round++)
+		for (i = 0; i < NUM_WINDOWS; i++)
+			sum += (uintptr_t) hash_table_lookup(ht,
+							     WINDOW_ID_BASE + i);
+
+	clock_gettime(CLOCK_MONOTONIC, &t2);
+	for (round = 0; round < rounds; round++) {
+		uint32_t base = WINDOW_ID_BASE + (round + 1) * NUM_WINDOWS;
+
+		for (i = 0; i < NUM_WINDOWS; i++)
+			hash_table_remove(ht, base - NUM_WINDOWS + i);
+		for (i = 0; i < NUM_WINDOWS; i++)
+			hash_table_insert(ht, base + i, id_data(base + i));
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t3);
+
+	printf("%d windows: insert %.1f ns, lookup %.1f ns, "
+	       "remove+insert %.1f ns (checksum %lx)\n", NUM_WINDOWS,
+	       (double) timespec_sub_to_nsec(&t1, &t0) / ops,
+	       (double) timespec_sub_to_nsec(&t2, &t1) / ops,
+	       (double) timespec_sub_to_nsec(&t3, &t2) / ops,
+	       (unsigned long) sum);
+
+	hash_table_destroy(ht);
+}
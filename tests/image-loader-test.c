@@ -0,0 +1,213 @@
+/*
+ * Copyright © 2026 The Weston Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "config.h"
+
+#include <poll.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pixman.h>
+
+#include "shared/helpers.h"
+#include "shared/image-loader.h"
+#include "shared/timespec-util.h"
+#include "zunitc/zunitc.h"
+#include "benchmark.h"
+
+static const char *sample_images[] = {
+	"background.png",
+	"panel.png",
+	"icon_ivi_simple-shm.png",
+	"terminal.png",
+};
+
+static char *
+data_path(const char *name)
+{
+	const char *srcdir = getenv("abs_top_srcdir");
+	char *path;
+
+	if (asprintf(&path, "%s/data/%s", srcdir ? srcdir : ".", name) < 0)
+		return NULL;
+
+	return path;
+}
+
+static pixman_image_t *
+load_sample(const char *name, int min_width, int min_height)
+{
+	char *path = data_path(name);
+	pixman_image_t *image;
+
+	image = load_image_scaled(path, min_width, min_height);
+	free(path);
+
+	return image;
+}
+
+ZUC_TEST(image_loader_test, scaled_is_subsampled)
+{
+	pixman_image_t *full, *quarter;
+	uint32_t *f, *q;
+	int fstride, qstride, x, y;
+
+	full = load_sample("background.png", 0, 0);
+	ZUC_ASSERT_NOT_NULL(full);
+	quarter = load_sample("background.png",
+			      pixman_image_get_width(full) / 4,
+			      pixman_image_get_height(full) / 4);
+	ZUC_ASSERTG_NOT_NULL(quarter, out_full);
+
+	ZUC_ASSERTG_EQ((pixman_image_get_width(full) + 3) / 4,
+		       pixman_image_get_width(quarter), out);
+	ZUC_ASSERTG_EQ((pixman_image_get_height(full) + 3) / 4,
+		       pixman_image_get_height(quarter), out);
+
+	f = pixman_image_get_data(full);
+	q = pixman_image_get_data(quarter);
+	fstride = pixman_image_get_stride(full) / 4;
+	qstride = pixman_image_get_stride(quarter) / 4;
+	for (y = 0; y < pixman_image_get_height(quarter); y++)
+		for (x = 0; x < pixman_image_get_width(quarter); x++)
+			ZUC_ASSERTG_EQ(f[y * 4 * fstride + x * 4],
+				       q[y * qstride + x], out);
+
+out:
+	pixman_image_unref(quarter);
+out_full:
+	pixman_image_unref(full);
+}
+
+ZUC_TEST(image_loader_test, never_below_minimum)
+{
+	pixman_image_t *image;
+
+	/* 1024x768 can only halve to cover 400x300. */
+	image = load_sample("background.png", 400, 300);
+	ZUC_ASSERT_NOT_NULL(image);
+	ZUC_ASSERTG_EQ(512, pixman_image_get_width(image), out);
+	ZUC_ASSERTG_EQ(384, pixman_image_get_height(image), out);
+	pixman_image_unref(image);
+
+	/* Asking for more than there is gives the full image. */
+	image = load_sample("background.png", 4096, 1);
+	ZUC_ASSERT_NOT_NULL(image);
+	ZUC_ASSERTG_EQ(1024, pixman_image_get_width(image), out);
+	ZUC_ASSERTG_EQ(768, pixman_image_get_height(image), out);
+
+out:
+	pixman_image_unref(image);
+}
+
+ZUC_TEST(image_loader_test, async_matches_sync)
+{
+	char *path = data_path("background.png");
+	struct image_load *load;
+	pixman_image_t *sync, *async;
+	struct pollfd pfd;
+	int size, ready;
+
+	sync = load_image(path);
+	ZUC_ASSERTG_NOT_NULL(sync, out_path);
+	size = pixman_image_get_height(sync) * pixman_image_get_stride(sync);
+
+	load = image_load_start(path, 0, 0);
+	ZUC_ASSERTG_NOT_NULL(load, out_sync);
+
+	pfd.fd = image_load_get_fd(load);
+	pfd.events = POLLIN;
+	ready = poll(&pfd, 1, 10000);
+	async = image_load_finish(load);
+
+	ZUC_ASSERTG_EQ(1, ready, out_async);
+	ZUC_ASSERTG_NOT_NULL(async, out_sync);
+	ZUC_ASSERTG_EQ(size, pixman_image_get_height(async) *
+		       pixman_image_get_stride(async), out_async);
+	ZUC_ASSERTG_EQ(0, memcmp(pixman_image_get_data(sync),
+				 pixman_image_get_data(async), size),
+		       out_async);
+
+out_async:
+	if (async)
+		pixman_image_unref(async);
+out_sync:
+	pixman_image_unref(sync);
+out_path:
+	free(path);
+}
+
+ZUC_TEST(image_loader_test, missing_file)
+{
+	struct image_load *load;
+
+	ZUC_ASSERT_NULL(load_image_scaled("/nonexistent.png", 0, 0));
+
+	load = image_load_start("/nonexistent.png", 0, 0);
+	ZUC_ASSERT_NOT_NULL(load);
+	ZUC_ASSERT_NULL(image_load_finish(load));
+}
+
+/* Benchmark: reports how long the sample images take to decode at full
+ * size and reduced to cover a half and a quarter. */
+ZUC_TEST(image_loader_test, throughput)
+{
+	static const int divisors[] = { 1, 2, 4 };
+	const int rounds = 10;
+	unsigned int i, j;
+	int round, w, h;
+	pixman_image_t *image;
+	struct timespec t0, t1;
+
+	if (!benchmark_enabled())
+		return;
+
+	for (i = 0; i < ARRAY_LENGTH(sample_images); i++) {
+		image = load_sample(sample_images[i], 0, 0);
+		ZUC_ASSERT_NOT_NULL(image);
+		w = pixman_image_get_width(image);
+		h = pixman_image_get_height(image);
+		pixman_image_unref(image);
+
+		printf("%s %dx%d:", sample_images[i], w, h);
+		for (j = 0; j < ARRAY_LENGTH(divisors); j++) {
+			clock_gettime(CLOCK_MONOTONIC, &t0);
+			for (round = 0; round < rounds; round++) {
+				image = load_sample(sample_images[i],
+						    w / divisors[j],
+						    h / divisors[j]);
+				ZUC_ASSERT_NOT_NULL(image);
+				pixman_image_unref(image);
+			}
+			clock_gettime(CLOCK_MONOTONIC, &t1);
+
+			printf(" 1/%d %.2f ms", divisors[j],
+			       timespec_sub_to_nsec(&t1, &t0) / 1e6 / rounds);
+		}
+		printf("\n");
+	}
+}
@@ -38,4 +38,7 @@
 
 #define IVI_TEST_SURFACE_COUNT (3)
 
+/* Size of a busy scene, for the commit timings. */
+#define IVI_TEST_MANY_SURFACES (200)
+
 #endif /* IVI_TEST_H */
@@ -30,12 +30,15 @@
 #include <signal.h>
 #include <string.h>
 #include <stdbool.h>
+#include <time.h>
 
 #include "src/compositor.h"
 #include "ivi-shell/ivi-layout-export.h"
 #include "ivi-shell/ivi-layout-private.h"
 #include "ivi-test.h"
+#include "benchmark.h"
 #include "shared/helpers.h"
+#include "shared/timespec-util.h"
 
 struct test_context {
 	struct weston_compositor *compositor;
@@ -548,6 +551,123 @@ test_get_layer_after_destory_layer(struct test_context *ctx)
 	iassert(ivilayer == NULL);
 }
 
+#define MANY_LAYERS 500
+
+static void
+test_layer_lookup_many(struct test_context *ctx)
+{
+	const struct ivi_layout_interface *lyt = ctx->layout_interface;
+	struct ivi_layout_layer *ivilayers[MANY_LAYERS] = {};
+	uint32_t i;
+
+	for (i = 0; i < MANY_LAYERS; i++) {
+		ivilayers[i] = lyt->layer_create_with_dimension(IVI_TEST_LAYER_ID(i), 200, 300);
+		iassert(ivilayers[i] != NULL);
+	}
+
+	for (i = 0; i < MANY_LAYERS; i++)
+		iassert(lyt->get_layer_from_id(IVI_TEST_LAYER_ID(i)) == ivilayers[i]);
+	iassert(lyt->get_layer_from_id(IVI_TEST_LAYER_ID(MANY_LAYERS)) == NULL);
+
+	/* Destroying some layers must leave the others reachable. */
+	for (i = 0; i < MANY_LAYERS; i += 2)
+		lyt->layer_destroy(ivilayers[i]);
+
+	for (i = 0; i < MANY_LAYERS; i++) {
+		if (i % 2)
+			iassert(lyt->get_layer_from_id(IVI_TEST_LAYER_ID(i)) == ivilayers[i]);
+		else
+			iassert(lyt->get_layer_from_id(IVI_TEST_LAYER_ID(i)) == NULL);
+	}
+
+	for (i = 1; i < MANY_LAYERS; i += 2)
+		lyt->layer_destroy(ivilayers[i]);
+
+	for (i = 0; i < MANY_LAYERS; i++)
+		iassert(lyt->get_layer_from_id(IVI_TEST_LAYER_ID(i)) == NULL);
+}
+
+/* Benchmark: logs what a controller pays per id lookup with hundreds of
+ * layers around. */
+static void
+test_layer_lookup_throughput(struct test_context *ctx)
+{
+	const struct ivi_layout_interface *lyt = ctx->layout_interface;
+	struct ivi_layout_layer *ivilayers[MANY_LAYERS] = {};
+	const uint32_t rounds = 1000;
+	struct timespec t0, t1;
+	uint32_t i, round, found = 0;
+
+	if (!benchmark_enabled())
+		return;
+
+	for (i = 0; i < MANY_LAYERS; i++)
+		ivilayers[i] = lyt->layer_create_with_dimension(IVI_TEST_LAYER_ID(i), 200, 300);
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (round = 0; round < rounds; round++)
+		for (i = 0; i < MANY_LAYERS; i++)
+			found += lyt->get_layer_from_id(IVI_TEST_LAYER_ID(i)) != NULL;
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+
+	iassert(found == rounds * MANY_LAYERS);
+
+	weston_log("%d layers: get_layer_from_id %.1f ns\n", MANY_LAYERS,
+		   (double) timespec_sub_to_nsec(&t1, &t0) /
+		   (rounds * MANY_LAYERS));
+
+	for (i = 0; i < MANY_LAYERS; i++)
+		lyt->layer_destroy(ivilayers[i]);
+}
+
+static void
+test_layer_transition_on_frames(struct test_context *ctx)
+{
+	const struct ivi_layout_interface *lyt = ctx->layout_interface;
+	struct ivi_layout_transition_set *transitions;
+	struct weston_animation *animation;
+	struct weston_output *output;
+	struct ivi_layout_layer *ivilayer;
+	const struct ivi_layout_layer_properties *prop;
+
+	if (wl_list_empty(&ctx->compositor->output_list))
+		return;
+
+	output = wl_container_of(ctx->compositor->output_list.next, output, link);
+
+	ivilayer = lyt->layer_create_with_dimension(IVI_TEST_LAYER_ID(0), 200, 300);
+	prop = lyt->get_properties_of_layer(ivilayer);
+	transitions = ivilayer->layout->transitions;
+	animation = &transitions->animation;
+
+	/* Nothing to animate, nothing hooked into the repaint loop. */
+	iassert(wl_list_empty(&animation->link));
+
+	iassert(lyt->layer_set_transition(ivilayer,
+					  IVI_LAYOUT_TRANSITION_LAYER_MOVE,
+					  100) == 0);
+	iassert(lyt->layer_set_destination_rectangle(
+		ivilayer, 100, 0, 200, 300) == IVI_SUCCEEDED);
+	lyt->commit_changes();
+
+	iassert(!wl_list_empty(&animation->link));
+
+	/* Frames are stamped with the output presentation time, the first
+	 * one starts the transition. */
+	animation->frame(animation, output, 1000);
+	iassert(prop->dest_x == 0);
+
+	animation->frame(animation, output, 1050);
+	iassert(prop->dest_x > 0 && prop->dest_x < 100);
+
+	animation->frame(animation, output, 1100);
+	iassert(prop->dest_x == 100);
+
+	iassert(wl_list_empty(&animation->link));
+
+	lyt->layer_destroy(ivilayer);
+}
+
 static void
 test_screen_render_order(struct test_context *ctx)
 {
@@ -911,6 +1031,10 @@ run_internal_tests(void *data)
 	test_commit_changes_after_destination_rectangle_set_layer_destroy(ctx);
 	test_layer_create_duplicate(ctx);
 	test_get_layer_after_destory_layer(ctx);
+	test_layer_lookup_many(ctx);
+	test_layer_lookup_throughput(ctx);
+
+	test_layer_transition_on_frames(ctx);
 
 	test_screen_render_order(ctx);
 	test_screen_bad_render_order(ctx);
@@ -31,13 +31,16 @@
 #include <signal.h>
 #include <string.h>
 #include <assert.h>
+#include <time.h>
 
 #include "src/compositor.h"
 #include "src/weston.h"
 #include "weston-test-server-protocol.h"
 #include "ivi-test.h"
+#include "benchmark.h"
 #include "ivi-shell/ivi-layout-export.h"
 #include "shared/helpers.h"
+#include "shared/timespec-util.h"
 
 struct test_context;
 
@@ -81,6 +84,7 @@ struct test_launcher {
 };
 
 struct test_context {
+	struct weston_compositor *compositor;
 	const struct ivi_layout_interface *layout_interface;
 	struct wl_resource *runner_resource;
 	uint32_t user_flags;
@@ -89,6 +93,7 @@ struct test_context {
 	struct wl_listener surface_created;
 	struct wl_listener surface_removed;
 	struct wl_listener surface_configured;
+	struct wl_listener commit_notified;
 };
 
 static struct test_context static_context;
@@ -99,6 +104,7 @@ destroy_runner(struct wl_resource *resource)
 	assert(static_context.runner_resource == NULL ||
 	       static_context.runner_resource == resource);
 
+	static_context.compositor = NULL;
 	static_context.layout_interface = NULL;
 	static_context.runner_resource = NULL;
 }
@@ -120,6 +126,7 @@ runner_run_handler(struct wl_client *client, struct wl_resource *resource,
 	       static_context.runner_resource == resource);
 
 	launcher = wl_resource_get_user_data(resource);
+	static_context.compositor = launcher->compositor;
 	static_context.layout_interface = launcher->layout_interface;
 	static_context.runner_resource = resource;
 
@@ -399,6 +406,63 @@ RUNNER_TEST(surface_opacity)
 	runner_assert(prop->opacity == wl_fixed_from_double(0.5));
 }
 
+RUNNER_TEST(surface_opacity_keeps_transform)
+{
+	const struct ivi_layout_interface *lyt = ctx->layout_interface;
+	struct ivi_layout_surface *ivisurf;
+	struct ivi_layout_layer *ivilayer;
+	struct weston_surface *surface;
+	struct weston_output *output;
+	struct weston_view *view;
+
+	runner_assert_or_return(!wl_list_empty(&ctx->compositor->output_list));
+	output = container_of(ctx->compositor->output_list.next,
+			      struct weston_output, link);
+
+	ivisurf = lyt->get_surface_from_id(IVI_TEST_SURFACE_ID(0));
+	runner_assert_or_return(ivisurf);
+
+	surface = lyt->surface_get_weston_surface(ivisurf);
+	runner_assert_or_return(!wl_list_empty(&surface->views));
+	view = container_of(surface->views.next, struct weston_view,
+			    surface_link);
+
+	ivilayer = lyt->layer_create_with_dimension(IVI_TEST_LAYER_ID(0),
+						    200, 300);
+	runner_assert_or_return(ivilayer);
+
+	lyt->surface_set_source_rectangle(ivisurf, 0, 0, 20, 30);
+	lyt->surface_set_destination_rectangle(ivisurf, 10, 10, 20, 30);
+	lyt->surface_set_visibility(ivisurf, true);
+	lyt->layer_add_surface(ivilayer, ivisurf);
+	lyt->layer_set_visibility(ivilayer, true);
+	lyt->screen_add_layer(output, ivilayer);
+	lyt->commit_changes();
+
+	runner_assert(view->transform.dirty);
+	/* What the next repaint would do. */
+	weston_view_update_transform(view);
+
+	/* Fading must not recompute the transformation. */
+	lyt->surface_set_opacity(ivisurf, wl_fixed_from_double(0.5));
+	lyt->commit_changes();
+	runner_assert(view->alpha == 0.5);
+	runner_assert(!view->transform.dirty);
+
+	lyt->layer_set_opacity(ivilayer, wl_fixed_from_double(0.5));
+	lyt->commit_changes();
+	runner_assert(view->alpha == 0.25);
+	runner_assert(!view->transform.dirty);
+
+	/* Moving it must. */
+	lyt->surface_set_destination_rectangle(ivisurf, 20, 10, 20, 30);
+	lyt->commit_changes();
+	runner_assert(view->transform.dirty);
+
+	lyt->layer_destroy(ivilayer);
+	lyt->commit_changes();
+}
+
 RUNNER_TEST(surface_orientation)
 {
 	const struct ivi_layout_interface *lyt = ctx->layout_interface;
@@ -552,6 +616,61 @@ RUNNER_TEST(surface_source_rectangle)
 	runner_assert(prop->source_y == 30);
 }
 
+RUNNER_TEST(surface_set_properties)
+{
+	const struct ivi_layout_interface *lyt = ctx->layout_interface;
+	struct ivi_layout_surface *ivisurf;
+	const struct ivi_layout_surface_properties *prop;
+	struct ivi_layout_surface_update updates[3] = {};
+
+	ivisurf = lyt->get_surface_from_id(IVI_TEST_SURFACE_ID(0));
+	runner_assert(ivisurf != NULL);
+
+	prop = lyt->get_properties_of_surface(ivisurf);
+	runner_assert_or_return(prop);
+
+	updates[0].surface = ivisurf;
+	updates[0].property = IVI_LAYOUT_SURFACE_VISIBILITY;
+	updates[0].value.visibility = true;
+	updates[1].surface = ivisurf;
+	updates[1].property = IVI_LAYOUT_SURFACE_DESTINATION_RECTANGLE;
+	updates[1].value.rect.x = 20;
+	updates[1].value.rect.y = 30;
+	updates[1].value.rect.width = 200;
+	updates[1].value.rect.height = 300;
+	updates[2].surface = ivisurf;
+	updates[2].property = IVI_LAYOUT_SURFACE_OPACITY;
+	updates[2].value.opacity = wl_fixed_from_double(2.0);
+
+	/* one bad entry rejects the whole batch */
+	runner_assert(lyt->surface_set_properties(updates, 3) == IVI_FAILED);
+
+	lyt->commit_changes();
+
+	runner_assert(prop->visibility == false);
+	runner_assert(prop->dest_x == 0);
+	runner_assert(prop->dest_width == 1);
+
+	updates[2].value.opacity = wl_fixed_from_double(0.5);
+	runner_assert(lyt->surface_set_properties(updates, 3) == IVI_SUCCEEDED);
+
+	runner_assert(prop->visibility == false);
+	runner_assert(prop->opacity == wl_fixed_from_double(1.0));
+
+	lyt->commit_changes();
+
+	runner_assert(prop->visibility == true);
+	runner_assert(prop->dest_x == 20);
+	runner_assert(prop->dest_y == 30);
+	runner_assert(prop->dest_width == 200);
+	runner_assert(prop->dest_height == 300);
+	runner_assert(prop->opacity == wl_fixed_from_double(0.5));
+
+	runner_assert(lyt->surface_set_properties(NULL, 1) == IVI_FAILED);
+	runner_assert(lyt->surface_set_properties(updates, -1) == IVI_FAILED);
+	runner_assert(lyt->surface_set_properties(NULL, 0) == IVI_SUCCEEDED);
+}
+
 RUNNER_TEST(surface_bad_opacity)
 {
 	const struct ivi_layout_interface *lyt = ctx->layout_interface;
@@ -789,6 +908,70 @@ RUNNER_TEST(layer_bad_render_order)
 	lyt->layer_destroy(ivilayer);
 }
 
+RUNNER_TEST(layer_render_order_into)
+{
+	const struct ivi_layout_interface *lyt = ctx->layout_interface;
+	struct ivi_layout_layer *ivilayer;
+	struct ivi_layout_surface *ivisurfs[IVI_TEST_SURFACE_COUNT] = {};
+	struct ivi_layout_surface *surf_buf[IVI_TEST_SURFACE_COUNT] = {};
+	struct ivi_layout_surface **array = NULL;
+	struct ivi_layout_layer *layer_buf[1] = {};
+	int32_t length = 0;
+	int32_t i;
+
+	ivilayer = lyt->layer_create_with_dimension(IVI_TEST_LAYER_ID(0), 200, 300);
+
+	for (i = 0; i < IVI_TEST_SURFACE_COUNT; i++)
+		ivisurfs[i] = lyt->get_surface_from_id(IVI_TEST_SURFACE_ID(i));
+
+	runner_assert(lyt->layer_set_render_order(
+		      ivilayer, ivisurfs, IVI_TEST_SURFACE_COUNT) == IVI_SUCCEEDED);
+
+	lyt->commit_changes();
+
+	/* counting only, then the full order */
+	runner_assert(lyt->get_surfaces_on_layer_into(
+		      ivilayer, NULL, 0) == IVI_TEST_SURFACE_COUNT);
+	runner_assert(lyt->get_surfaces_on_layer_into(
+		      ivilayer, surf_buf, IVI_TEST_SURFACE_COUNT) ==
+		      IVI_TEST_SURFACE_COUNT);
+	for (i = 0; i < IVI_TEST_SURFACE_COUNT; i++)
+		runner_assert(surf_buf[i] == ivisurfs[i]);
+
+	/* a short buffer is filled as far as it goes */
+	memset(surf_buf, 0, sizeof surf_buf);
+	runner_assert(lyt->get_surfaces_on_layer_into(
+		      ivilayer, surf_buf, 1) == IVI_TEST_SURFACE_COUNT);
+	runner_assert(surf_buf[0] == ivisurfs[0]);
+	runner_assert(surf_buf[1] == NULL);
+
+	/* same answer as the allocating getter */
+	runner_assert(lyt->get_surfaces(&length, &array) == IVI_SUCCEEDED);
+	runner_assert(lyt->get_surfaces_into(NULL, 0) == length);
+	runner_assert(length >= IVI_TEST_SURFACE_COUNT);
+	runner_assert(lyt->get_surfaces_into(
+		      surf_buf, IVI_TEST_SURFACE_COUNT) == length);
+	for (i = 0; i < IVI_TEST_SURFACE_COUNT; i++)
+		runner_assert(surf_buf[i] == array[i]);
+	free(array);
+
+	runner_assert(lyt->get_layers_into(layer_buf, 1) >= 1);
+	runner_assert(lyt->get_layers_on_screen_into(NULL, NULL, 0) ==
+		      IVI_FAILED);
+
+	/* bad arguments */
+	runner_assert(lyt->get_surfaces_on_layer_into(
+		      NULL, surf_buf, IVI_TEST_SURFACE_COUNT) == IVI_FAILED);
+	runner_assert(lyt->get_surfaces_on_layer_into(
+		      ivilayer, NULL, 1) == IVI_FAILED);
+	runner_assert(lyt->get_surfaces_on_layer_into(
+		      ivilayer, surf_buf, -1) == IVI_FAILED);
+	runner_assert(lyt->get_surfaces_into(NULL, 1) == IVI_FAILED);
+	runner_assert(lyt->get_layers_into(layer_buf, -1) == IVI_FAILED);
+
+	lyt->layer_destroy(ivilayer);
+}
+
 RUNNER_TEST(commit_changes_after_render_order_set_surface_destroy)
 {
 	const struct ivi_layout_interface *lyt = ctx->layout_interface;
@@ -814,6 +997,232 @@ RUNNER_TEST(cleanup_layer)
 	lyt->layer_destroy(ivilayer);
 }
 
+static double
+commit_time_ns(const struct ivi_layout_interface *lyt,
+	       void (*change)(const struct ivi_layout_interface *lyt,
+			      uint32_t round, void *data),
+	       void *data)
+{
+	const uint32_t rounds = 1000;
+	struct timespec t0, t1;
+	uint32_t round;
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (round = 0; round < rounds; round++) {
+		change(lyt, round, data);
+		lyt->commit_changes();
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+
+	return (double) timespec_sub_to_nsec(&t1, &t0) / rounds;
+}
+
+static void
+change_nothing(const struct ivi_layout_interface *lyt, uint32_t round,
+	       void *data)
+{
+}
+
+static void
+change_one_surface(const struct ivi_layout_interface *lyt, uint32_t round,
+		   void *data)
+{
+	struct ivi_layout_surface **ivisurfs = data;
+
+	lyt->surface_set_opacity(ivisurfs[round % IVI_TEST_MANY_SURFACES],
+				 wl_fixed_from_double(round % 2 ? 0.5 : 1.0));
+}
+
+static void
+change_layer(const struct ivi_layout_interface *lyt, uint32_t round,
+	     void *data)
+{
+	struct ivi_layout_layer *ivilayer = data;
+
+	lyt->layer_set_opacity(ivilayer,
+			       wl_fixed_from_double(round % 2 ? 0.5 : 1.0));
+}
+
+struct property_counter {
+	struct wl_listener listener;
+	uint32_t count;
+};
+
+static void
+count_property_changed(struct wl_listener *listener, void *data)
+{
+	struct property_counter *counter =
+		container_of(listener, struct property_counter, listener);
+
+	counter->count++;
+}
+
+static struct weston_view *
+get_view(const struct ivi_layout_interface *lyt,
+	 struct ivi_layout_surface *ivisurf)
+{
+	struct weston_surface *surface;
+
+	surface = lyt->surface_get_weston_surface(ivisurf);
+	if (wl_list_empty(&surface->views))
+		return NULL;
+
+	return container_of(surface->views.next,
+			    struct weston_view, surface_link);
+}
+
+/*
+ * The layer ivi-layout shows everything in must hold the views of
+ * exactly the visible surfaces of the render order, topmost first.
+ */
+static void
+check_layout_view_list(struct test_context *ctx,
+		       struct ivi_layout_surface **order, int32_t count)
+{
+	const struct ivi_layout_interface *lyt = ctx->layout_interface;
+	const struct ivi_layout_surface_properties *prop;
+	struct weston_layer_entry *view_list = NULL;
+	struct weston_layer_entry *entry;
+	struct weston_view *view;
+	int32_t i;
+
+	for (i = count - 1; i >= 0 && !view_list; i--) {
+		prop = lyt->get_properties_of_surface(order[i]);
+		if (!prop->visibility)
+			continue;
+
+		view = get_view(lyt, order[i]);
+		runner_assert_or_return(view && view->layer_link.layer);
+		view_list = &view->layer_link.layer->view_list;
+	}
+	runner_assert_or_return(view_list != NULL);
+
+	entry = view_list;
+	for (i = count - 1; i >= 0; i--) {
+		prop = lyt->get_properties_of_surface(order[i]);
+		view = get_view(lyt, order[i]);
+		runner_assert_or_return(view != NULL);
+
+		if (!prop->visibility) {
+			runner_assert(view->layer_link.layer == NULL);
+			continue;
+		}
+
+		entry = container_of(entry->link.next,
+				     struct weston_layer_entry, link);
+		runner_assert_or_return(entry == &view->layer_link);
+	}
+
+	runner_assert(entry->link.next == &view_list->link);
+}
+
+RUNNER_TEST(commit_changes_many_surfaces)
+{
+	const struct ivi_layout_interface *lyt = ctx->layout_interface;
+	struct ivi_layout_surface *ivisurfs[IVI_TEST_MANY_SURFACES] = {};
+	struct ivi_layout_surface *reordered[IVI_TEST_MANY_SURFACES / 2];
+	struct property_counter counters[IVI_TEST_MANY_SURFACES];
+	const struct ivi_layout_surface_properties *prop;
+	struct ivi_layout_layer *ivilayer;
+	struct ivi_layout_surface **array;
+	struct weston_output *output;
+	struct weston_view *view;
+	int32_t length = 0;
+	double idle_ns, surface_ns, layer_ns;
+	uint32_t i;
+
+	runner_assert_or_return(!wl_list_empty(&ctx->compositor->output_list));
+	output = container_of(ctx->compositor->output_list.next,
+			      struct weston_output, link);
+
+	ivilayer = lyt->layer_create_with_dimension(IVI_TEST_LAYER_ID(0),
+						    200, 300);
+	runner_assert_or_return(ivilayer != NULL);
+
+	/* Every third surface is hidden, so that the view list is not
+	 * simply the render order. */
+	for (i = 0; i < IVI_TEST_MANY_SURFACES; i++) {
+		ivisurfs[i] = lyt->get_surface_from_id(IVI_TEST_SURFACE_ID(i));
+		runner_assert_or_return(ivisurfs[i] != NULL);
+
+		lyt->surface_set_source_rectangle(ivisurfs[i], 0, 0, 10, 10);
+		lyt->surface_set_destination_rectangle(ivisurfs[i],
+						       i % 20 * 10, i / 20 * 10,
+						       10, 10);
+		lyt->surface_set_visibility(ivisurfs[i], i % 3 != 2);
+	}
+
+	runner_assert(lyt->layer_set_render_order(
+		      ivilayer, ivisurfs, IVI_TEST_MANY_SURFACES) == IVI_SUCCEEDED);
+	lyt->layer_set_visibility(ivilayer, true);
+	runner_assert(lyt->screen_add_layer(output, ivilayer) == IVI_SUCCEEDED);
+	lyt->commit_changes();
+
+	check_layout_view_list(ctx, ivisurfs, IVI_TEST_MANY_SURFACES);
+
+	for (i = 0; i < IVI_TEST_MANY_SURFACES; i++) {
+		counters[i].count = 0;
+		counters[i].listener.notify = count_property_changed;
+		runner_assert(lyt->surface_add_listener(
+			      ivisurfs[i], &counters[i].listener) == IVI_SUCCEEDED);
+	}
+
+	/* A commit touching one surface must not disturb the others. */
+	lyt->surface_set_opacity(ivisurfs[7], wl_fixed_from_double(0.5));
+	lyt->commit_changes();
+
+	for (i = 0; i < IVI_TEST_MANY_SURFACES; i++) {
+		runner_assert(counters[i].count == (i == 7 ? 1 : 0));
+
+		prop = lyt->get_properties_of_surface(ivisurfs[i]);
+		runner_assert(prop->visibility == (i % 3 != 2));
+		runner_assert(prop->dest_x == (int32_t)(i % 20 * 10));
+		runner_assert(prop->opacity == wl_fixed_from_double(i == 7 ?
+								    0.5 : 1.0));
+	}
+
+	check_layout_view_list(ctx, ivisurfs, IVI_TEST_MANY_SURFACES);
+
+	runner_assert(lyt->get_surfaces_on_layer(
+		      ivilayer, &length, &array) == IVI_SUCCEEDED);
+	runner_assert(length == IVI_TEST_MANY_SURFACES);
+	if (length > 0)
+		free(array);
+
+	/* Keep half of the surfaces, in reverse order. */
+	for (i = 0; i < ARRAY_LENGTH(reordered); i++)
+		reordered[i] = ivisurfs[ARRAY_LENGTH(reordered) - 1 - i];
+
+	runner_assert(lyt->layer_set_render_order(ivilayer, reordered,
+		      ARRAY_LENGTH(reordered)) == IVI_SUCCEEDED);
+	lyt->commit_changes();
+
+	check_layout_view_list(ctx, reordered, ARRAY_LENGTH(reordered));
+
+	for (i = ARRAY_LENGTH(reordered); i < IVI_TEST_MANY_SURFACES; i++) {
+		view = get_view(lyt, ivisurfs[i]);
+		runner_assert(view && view->layer_link.layer == NULL);
+	}
+
+	for (i = 0; i < IVI_TEST_MANY_SURFACES; i++)
+		wl_list_remove(&counters[i].listener.link);
+
+	/* Benchmark: what a commit costs with a realistic scene. */
+	if (benchmark_enabled()) {
+		idle_ns = commit_time_ns(lyt, change_nothing, NULL);
+		surface_ns = commit_time_ns(lyt, change_one_surface, ivisurfs);
+		layer_ns = commit_time_ns(lyt, change_layer, ivilayer);
+
+		weston_log("%d surfaces: commit_changes %.1f us idle, "
+			   "%.1f us for one surface, %.1f us for the layer\n",
+			   IVI_TEST_MANY_SURFACES, idle_ns / 1000,
+			   surface_ns / 1000, layer_ns / 1000);
+	}
+
+	lyt->layer_destroy(ivilayer);
+	lyt->commit_changes();
+}
+
 static void
 test_surface_properties_changed_notification_callback(struct wl_listener *listener, void *data)
 
@@ -875,6 +1284,68 @@ RUNNER_TEST(surface_properties_changed_notification)
 	runner_assert(ctx->user_flags == 0);
 }
 
+static void
+test_commit_notification_callback(struct wl_listener *listener, void *data)
+{
+	struct test_context *ctx =
+			container_of(listener, struct test_context,
+					commit_notified);
+	const struct ivi_layout_interface *lyt = ctx->layout_interface;
+	const struct ivi_layout_commit_event *event = data;
+	int32_t i;
+
+	runner_assert_or_return(event->layer_count == 0);
+	runner_assert_or_return(event->surface_count == IVI_TEST_SURFACE_COUNT);
+
+	for (i = 0; i < event->surface_count; i++) {
+		runner_assert(lyt->get_id_of_surface(event->surfaces[i].surface) ==
+			      IVI_TEST_SURFACE_ID(i));
+		runner_assert(event->surfaces[i].event_mask &
+			      IVI_NOTIFICATION_DEST_RECT);
+	}
+
+	ctx->user_flags++;
+}
+
+RUNNER_TEST(commit_notification)
+{
+	const struct ivi_layout_interface *lyt = ctx->layout_interface;
+	struct ivi_layout_surface *ivisurf;
+	int32_t i;
+
+	/* flush whatever the window setup left pending */
+	lyt->commit_changes();
+	lyt->commit_changes();
+
+	ctx->user_flags = 0;
+	ctx->commit_notified.notify = test_commit_notification_callback;
+
+	runner_assert(lyt->add_listener_commit(NULL) == IVI_FAILED);
+	runner_assert(lyt->add_listener_commit(
+		      &ctx->commit_notified) == IVI_SUCCEEDED);
+
+	lyt->commit_changes();
+
+	runner_assert(ctx->user_flags == 0);
+
+	for (i = 0; i < IVI_TEST_SURFACE_COUNT; i++) {
+		ivisurf = lyt->get_surface_from_id(IVI_TEST_SURFACE_ID(i));
+		runner_assert(lyt->surface_set_destination_rectangle(
+			      ivisurf, i * 20, 30, 200, 300) == IVI_SUCCEEDED);
+	}
+
+	lyt->commit_changes();
+
+	/* one event for the whole commit, not one per surface */
+	runner_assert(ctx->user_flags == 1);
+
+	lyt->commit_changes();
+
+	runner_assert(ctx->user_flags == 1);
+
+	wl_list_remove(&ctx->commit_notified.link);
+}
+
 static void
 test_surface_configure_notification_callback(struct wl_listener *listener, void *data)
 {
@@ -191,11 +191,13 @@ ivi_window_destroy(struct ivi_window *wnd)
 const char * const basic_test_names[] = {
 	"surface_visibility",
 	"surface_opacity",
+	"surface_opacity_keeps_transform",
 	"surface_orientation",
 	"surface_dimension",
 	"surface_position",
 	"surface_destination_rectangle",
 	"surface_source_rectangle",
+	"surface_set_properties",
 	"surface_bad_opacity",
 	"surface_properties_changed_notification",
 	"surface_bad_properties_changed_notification",
@@ -212,6 +214,8 @@ const char * const surface_property_commit_changes_test_names[] = {
 const char * const render_order_test_names[] = {
 	"layer_render_order",
 	"layer_bad_render_order",
+	"layer_render_order_into",
+	"commit_notification",
 };
 
 TEST_P(ivi_layout_runner, basic_test_names)
@@ -389,6 +393,27 @@ TEST(commit_changes_after_render_order_set_surface_destroy)
 	runner_destroy(runner);
 }
 
+TEST(commit_changes_many_surfaces)
+{
+	struct client *client;
+	struct runner *runner;
+	struct ivi_window *winds[IVI_TEST_MANY_SURFACES];
+	uint32_t i;
+
+	client = create_client();
+	runner = client_create_runner(client);
+
+	for (i = 0; i < IVI_TEST_MANY_SURFACES; i++)
+		winds[i] = client_create_ivi_window(client,
+						    IVI_TEST_SURFACE_ID(i));
+
+	runner_run(runner, "commit_changes_many_surfaces");
+
+	for (i = 0; i < IVI_TEST_MANY_SURFACES; i++)
+		ivi_window_destroy(winds[i]);
+	runner_destroy(runner);
+}
+
 TEST(ivi_layout_surface_configure_notification)
 {
 	struct client *client;
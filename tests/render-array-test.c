@@ -0,0 +1,190 @@
+/*
+ * Copyright © 2026 The Weston Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <time.h>
+
+#include "src/compositor.h"
+#include "shared/helpers.h"
+#include "shared/timespec-util.h"
+#include "benchmark.h"
+
+#define NUM_VIEWS 2000
+#define WALK_ROUNDS 1000
+
+/* Maps many views interleaved with unrelated allocations, as a long
+ * running compositor would have them spread over the heap, and checks
+ * that a repaint mirrors the view list into the render array. As a
+ * benchmark, also reports what walking either one costs per view. */
+struct render_array_test {
+	struct weston_compositor *compositor;
+	struct weston_output *output;
+	struct weston_layer layer;
+	struct wl_listener frame_listener;
+	struct weston_surface *surfaces[NUM_VIEWS];
+	void *padding[NUM_VIEWS];
+};
+
+static void
+render_array_bench(struct weston_compositor *compositor, unsigned int n)
+{
+	struct weston_plane *primary = &compositor->primary_plane;
+	struct weston_view_render *r;
+	struct weston_view *view;
+	struct timespec t0, t1, t2;
+	int32_t sum_list = 0, sum_array = 0;
+	unsigned int round;
+
+	/* The per-view test every repaint loop starts with. */
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (round = 0; round < WALK_ROUNDS; round++)
+		wl_list_for_each(view, &compositor->view_list, link)
+			if (view->plane == primary)
+				sum_list += pixman_region32_extents(
+					&view->transform.boundingbox)->x1;
+
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	for (round = 0; round < WALK_ROUNDS; round++)
+		wl_array_for_each(r, &compositor->render_array)
+			if (r->plane == primary)
+				sum_array += r->bbox.x1;
+	clock_gettime(CLOCK_MONOTONIC, &t2);
+
+	assert(sum_list == sum_array);
+
+	fprintf(stderr, "%u views: view list walk %.2f ns/view, "
+		"render array walk %.2f ns/view\n", n,
+		(double) timespec_sub_to_nsec(&t1, &t0) / WALK_ROUNDS / n,
+		(double) timespec_sub_to_nsec(&t2, &t1) / WALK_ROUNDS / n);
+}
+
+static void
+render_array_finish(void *data)
+{
+	struct render_array_test *test = data;
+	struct weston_compositor *compositor = test->compositor;
+	int i;
+
+	for (i = 0; i < NUM_VIEWS; i++) {
+		weston_surface_destroy(test->surfaces[i]);
+		free(test->padding[i]);
+	}
+	wl_list_remove(&test->layer.link);
+	free(test);
+
+	wl_display_terminate(compositor->wl_display);
+}
+
+/* The render array is only valid during the repaint that built it, so
+ * look at it from the frame signal the renderer sends at its end. */
+static void
+render_array_check(struct wl_listener *listener, void *data)
+{
+	struct render_array_test *test =
+		container_of(listener, struct render_array_test,
+			     frame_listener);
+	struct weston_compositor *compositor = test->compositor;
+	struct weston_view_render *r = compositor->render_array.data;
+	struct weston_view *view;
+	struct wl_event_loop *loop;
+	unsigned int n = 0;
+	pixman_box32_t *box;
+
+	wl_list_for_each(view, &compositor->view_list, link) {
+		assert(n < compositor->render_array.size / sizeof *r);
+		assert(r[n].view == view);
+		assert(r[n].plane == view->plane);
+		box = pixman_region32_extents(&view->transform.boundingbox);
+		assert(r[n].bbox.x1 == box->x1 && r[n].bbox.y1 == box->y1 &&
+		       r[n].bbox.x2 == box->x2 && r[n].bbox.y2 == box->y2);
+		n++;
+	}
+	assert(n == compositor->render_array.size / sizeof *r);
+	assert(n >= NUM_VIEWS);
+
+	if (benchmark_enabled())
+		render_array_bench(compositor, n);
+
+	/* Tear the views down outside of the repaint. */
+	wl_list_remove(&test->frame_listener.link);
+	loop = wl_display_get_event_loop(compositor->wl_display);
+	wl_event_loop_add_idle(loop, render_array_finish, test);
+}
+
+static void
+render_array_start(void *data)
+{
+	struct weston_compositor *compositor = data;
+	struct render_array_test *test;
+	struct weston_surface *surface;
+	struct weston_view *view;
+	int i;
+
+	assert(!wl_list_empty(&compositor->output_list));
+
+	test = zalloc(sizeof *test);
+	assert(test);
+	test->compositor = compositor;
+	test->output = container_of(compositor->output_list.next,
+				    struct weston_output, link);
+	weston_layer_init(&test->layer, &compositor->cursor_layer.link);
+
+	for (i = 0; i < NUM_VIEWS; i++) {
+		surface = weston_surface_create(compositor);
+		assert(surface);
+		test->padding[i] = malloc(256 + (i % 7) * 64);
+		assert(test->padding[i]);
+		view = weston_view_create(surface);
+		assert(view);
+
+		surface->width = 64;
+		surface->height = 64;
+		weston_view_set_position(view, (i * 7) % 1000, (i * 13) % 700);
+		weston_layer_entry_insert(&test->layer.view_list,
+					  &view->layer_link);
+		weston_view_update_transform(view);
+		test->surfaces[i] = surface;
+	}
+
+	test->frame_listener.notify = render_array_check;
+	wl_signal_add(&test->output->frame_signal, &test->frame_listener);
+	weston_output_damage(test->output);
+}
+
+WL_EXPORT int
+module_init(struct weston_compositor *compositor, int *argc, char *argv[])
+{
+	struct wl_event_loop *loop;
+
+	loop = wl_display_get_event_loop(compositor->wl_display);
+
+	wl_event_loop_add_idle(loop, render_array_start, compositor);
+
+	return 0;
+}
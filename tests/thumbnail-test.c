@@ -0,0 +1,218 @@
+/*
+ * Copyright © 2026 The Weston Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "config.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <assert.h>
+
+#include "src/compositor.h"
+#include "shared/helpers.h"
+
+#define CONTENT_WIDTH 400
+#define CONTENT_HEIGHT 300
+#define CONTENT_COLOR 0xff336699
+
+/* Stands in for the renderer so that the cache can be checked with any
+ * backend: every surface has solid CONTENT_COLOR contents, or one white
+ * column in four when content_stripes is set, and copies are counted to
+ * tell cache hits from read backs. */
+static int copy_count;
+static bool content_stripes;
+
+static void
+fake_get_content_size(struct weston_surface *surface,
+		      int *width, int *height)
+{
+	*width = CONTENT_WIDTH;
+	*height = CONTENT_HEIGHT;
+}
+
+static int
+fake_copy_content(struct weston_surface *surface,
+		  void *target, size_t size,
+		  int src_x, int src_y, int width, int height)
+{
+	uint32_t *pixels = target;
+	int x, y;
+
+	for (y = 0; y < height; y++) {
+		for (x = 0; x < width; x++) {
+			if (!content_stripes)
+				pixels[y * width + x] = CONTENT_COLOR;
+			else if ((src_x + x) % 4 == 0)
+				pixels[y * width + x] = 0xffffffff;
+			else
+				pixels[y * width + x] = 0xff000000;
+		}
+	}
+	copy_count++;
+
+	return 0;
+}
+
+/* The filter weights are rounded to fixed point, so a channel may be
+ * one off from the exact average. */
+static bool
+pixel_near(uint32_t pixel, uint32_t expected)
+{
+	int shift, a, b;
+
+	for (shift = 0; shift < 32; shift += 8) {
+		a = (pixel >> shift) & 0xff;
+		b = (expected >> shift) & 0xff;
+		if (abs(a - b) > 1)
+			return false;
+	}
+
+	return true;
+}
+
+static void
+check_thumbnail(pixman_image_t *image, int width, int height,
+		uint32_t color)
+{
+	uint32_t *pixels;
+	int stride, x, y;
+
+	assert(image);
+	assert(pixman_image_get_width(image) == width);
+	assert(pixman_image_get_height(image) == height);
+
+	pixels = pixman_image_get_data(image);
+	stride = pixman_image_get_stride(image) / 4;
+	for (y = 0; y < height; y++)
+		for (x = 0; x < width; x++)
+			assert(pixel_near(pixels[y * stride + x], color));
+}
+
+static void
+thumbnail_run(void *data)
+{
+	struct weston_compositor *compositor = data;
+	struct weston_renderer *renderer = compositor->renderer;
+	struct weston_renderer saved = *renderer;
+	struct weston_thumbnail_cache *cache;
+	struct weston_surface *surfaces[3];
+	pixman_image_t *image;
+	int i;
+
+	renderer->surface_get_content_size = fake_get_content_size;
+	renderer->surface_copy_content = fake_copy_content;
+
+	for (i = 0; i < (int) ARRAY_LENGTH(surfaces); i++) {
+		surfaces[i] = weston_surface_create(compositor);
+		assert(surfaces[i]);
+	}
+
+	/* Room for two 100x75 thumbnails, not three. */
+	cache = weston_thumbnail_cache_create(compositor, 2 * 100 * 75 * 4);
+	assert(cache);
+
+	/* Downscaled with the aspect ratio kept. */
+	image = weston_thumbnail_cache_get(cache, surfaces[0], 100, 100);
+	check_thumbnail(image, 100, 75, CONTENT_COLOR);
+	pixman_image_unref(image);
+	assert(copy_count == 1);
+
+	/* Unchanged contents are not read back again. */
+	image = weston_thumbnail_cache_get(cache, surfaces[0], 100, 100);
+	check_thumbnail(image, 100, 75, CONTENT_COLOR);
+	pixman_image_unref(image);
+	assert(copy_count == 1);
+
+	/* Never scaled up. */
+	image = weston_thumbnail_cache_get(cache, surfaces[0], 800, 800);
+	check_thumbnail(image, CONTENT_WIDTH, CONTENT_HEIGHT, CONTENT_COLOR);
+	pixman_image_unref(image);
+	assert(copy_count == 2);
+
+	image = weston_thumbnail_cache_get(cache, surfaces[0], 100, 100);
+	pixman_image_unref(image);
+	assert(copy_count == 3);
+
+	/* New contents are. */
+	surfaces[0]->content_serial++;
+	image = weston_thumbnail_cache_get(cache, surfaces[0], 100, 100);
+	check_thumbnail(image, 100, 75, CONTENT_COLOR);
+	pixman_image_unref(image);
+	assert(copy_count == 4);
+
+	/* The third thumbnail pushes out the least recently used one. */
+	image = weston_thumbnail_cache_get(cache, surfaces[1], 100, 100);
+	pixman_image_unref(image);
+	image = weston_thumbnail_cache_get(cache, surfaces[0], 100, 100);
+	pixman_image_unref(image);
+	image = weston_thumbnail_cache_get(cache, surfaces[2], 100, 100);
+	pixman_image_unref(image);
+	assert(copy_count == 6);
+
+	image = weston_thumbnail_cache_get(cache, surfaces[0], 100, 100);
+	pixman_image_unref(image);
+	assert(copy_count == 6);
+
+	image = weston_thumbnail_cache_get(cache, surfaces[1], 100, 100);
+	pixman_image_unref(image);
+	assert(copy_count == 7);
+
+	/* Downscaling by four averages the one white column in four to a
+	 * quarter grey everywhere, where sampling would pick up only some
+	 * of the columns and give black or white stripes. */
+	content_stripes = true;
+	surfaces[1]->content_serial++;
+	image = weston_thumbnail_cache_get(cache, surfaces[1], 100, 100);
+	check_thumbnail(image, 100, 75, 0xff404040);
+	pixman_image_unref(image);
+	content_stripes = false;
+
+	/* A thumbnail stays valid after its surface and cache are gone. */
+	image = weston_thumbnail_cache_get(cache, surfaces[2], 100, 100);
+	weston_surface_destroy(surfaces[2]);
+	weston_thumbnail_cache_destroy(cache);
+	check_thumbnail(image, 100, 75, CONTENT_COLOR);
+	pixman_image_unref(image);
+
+	weston_surface_destroy(surfaces[0]);
+	weston_surface_destroy(surfaces[1]);
+
+	renderer->surface_get_content_size = saved.surface_get_content_size;
+	renderer->surface_copy_content = saved.surface_copy_content;
+
+	wl_display_terminate(compositor->wl_display);
+}
+
+WL_EXPORT int
+module_init(struct weston_compositor *compositor, int *argc, char *argv[])
+{
+	struct wl_event_loop *loop;
+
+	loop = wl_display_get_event_loop(compositor->wl_display);
+
+	wl_event_loop_add_idle(loop, thumbnail_run, compositor);
+
+	return 0;
+}
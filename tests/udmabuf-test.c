@@ -0,0 +1,456 @@
+/*
+ * Copyright © 2026 The Weston Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <GLES2/gl2.h>
+#include <GLES2/gl2ext.h>
+#include <drm_fourcc.h>
+
+#include "shared/os-compatibility.h"
+#include "src/weston-egl-ext.h"
+#include "zunitc/zunitc.h"
+
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+#endif
+
+/* Not a multiple of the page size, so the last page is only partly
+ * used, like in weston-simple-shm.
+ */
+#define WIDTH 100
+#define HEIGHT 30
+#define STRIDE (WIDTH * 4)
+
+struct udmabuf {
+	int memfd;
+	int dmabuf;
+	size_t size;
+};
+
+static uint32_t
+pattern_pixel(int x, int y)
+{
+	return 0xff000000 | (x * 2) << 16 | (y * 8) << 8 | ((x ^ y) & 0xff);
+}
+
+/* Creates a memfd holding the test pattern and wraps it in a dma-buf.
+ * Returns 0 on success, or -1 with errno set; errno is ENOSYS when
+ * udmabuf is not available at all.
+ */
+static int
+udmabuf_create(struct udmabuf *buf)
+{
+	long page_size = sysconf(_SC_PAGESIZE);
+	uint32_t *pixels;
+	int x, y;
+
+	buf->size = (STRIDE * HEIGHT + page_size - 1) & ~(page_size - 1);
+	buf->dmabuf = -1;
+
+	buf->memfd = os_create_anonymous_file(buf->size);
+	if (buf->memfd < 0)
+		return -1;
+
+	pixels = mmap(NULL, buf->size, PROT_READ | PROT_WRITE, MAP_SHARED,
+		      buf->memfd, 0);
+	if (pixels == MAP_FAILED)
+		goto err;
+
+	for (y = 0; y < HEIGHT; y++)
+		for (x = 0; x < WIDTH; x++)
+			pixels[y * WIDTH + x] = pattern_pixel(x, y);
+
+	munmap(pixels, buf->size);
+
+	buf->dmabuf = os_create_udmabuf(buf->memfd, 0, buf->size);
+	if (buf->dmabuf < 0)
+		goto err;
+
+	return 0;
+
+err:
+	close(buf->memfd);
+	return -1;
+}
+
+static void
+udmabuf_release(struct udmabuf *buf)
+{
+	close(buf->dmabuf);
+	close(buf->memfd);
+}
+
+static bool
+udmabuf_missing(void)
+{
+	return access("/dev/udmabuf", F_OK) < 0;
+}
+
+ZUC_TEST(udmabuf_test, shares_memfd_pages)
+{
+	struct udmabuf buf;
+	uint32_t *shm, *dma;
+	int x, y, mismatches = 0;
+
+	if (udmabuf_missing())
+		ZUC_SKIP("/dev/udmabuf is not available");
+
+	if (udmabuf_create(&buf) < 0 && errno == ENOSYS)
+		ZUC_SKIP("built without udmabuf support");
+	ZUC_ASSERT_TRUE(buf.dmabuf >= 0);
+
+	dma = mmap(NULL, buf.size, PROT_READ, MAP_SHARED, buf.dmabuf, 0);
+	ZUC_ASSERT_TRUE(dma != MAP_FAILED);
+
+	for (y = 0; y < HEIGHT; y++)
+		for (x = 0; x < WIDTH; x++)
+			if (dma[y * WIDTH + x] != pattern_pixel(x, y))
+				mismatches++;
+
+	/* The memfd stays writable and the dma-buf sees the writes
+	 * without any copy, which is what the clients rely on. */
+	shm = mmap(NULL, buf.size, PROT_READ | PROT_WRITE, MAP_SHARED,
+		   buf.memfd, 0);
+	ZUC_ASSERT_TRUE(shm != MAP_FAILED);
+	shm[WIDTH + 1] = 0xff123456;
+
+	ZUC_ASSERT_EQ(0, mismatches);
+	ZUC_ASSERT_EQ(0xff123456, dma[WIDTH + 1]);
+
+	munmap(shm, buf.size);
+	munmap(dma, buf.size);
+	udmabuf_release(&buf);
+}
+
+ZUC_TEST(udmabuf_test, memfd_cannot_shrink)
+{
+	struct udmabuf buf;
+
+	if (udmabuf_missing())
+		ZUC_SKIP("/dev/udmabuf is not available");
+
+	if (udmabuf_create(&buf) < 0 && errno == ENOSYS)
+		ZUC_SKIP("built without udmabuf support");
+	ZUC_ASSERT_TRUE(buf.dmabuf >= 0);
+
+	/* The client must not be able to pull the pages away from under
+	 * the compositor. */
+	ZUC_ASSERT_EQ(-1, ftruncate(buf.memfd, 0));
+	ZUC_ASSERT_EQ(EPERM, errno);
+
+	udmabuf_release(&buf);
+}
+
+struct egl {
+	EGLDisplay display;
+	EGLContext context;
+	PFNEGLCREATEIMAGEKHRPROC create_image;
+	PFNEGLDESTROYIMAGEKHRPROC destroy_image;
+	PFNGLEGLIMAGETARGETTEXTURE2DOESPROC image_target_texture_2d;
+};
+
+static bool
+check_extension(const char *extensions, const char *extension)
+{
+	size_t len = strlen(extension);
+	const char *end = extensions + strlen(extensions);
+
+	while (extensions < end) {
+		size_t n = strcspn(extensions, " ");
+
+		if (n == len && strncmp(extension, extensions, n) == 0)
+			return true;
+
+		extensions += n + 1;
+	}
+
+	return false;
+}
+
+/* Sets up GLES2 on Mesa's surfaceless platform, which runs on llvmpipe
+ * when there is no GPU. Returns false if that or dma-buf import is not
+ * available.
+ */
+static bool
+egl_init(struct egl *egl)
+{
+	static const EGLint config_attribs[] = {
+		EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_ES2_BIT,
+		EGL_NONE
+	};
+	static const EGLint context_attribs[] = {
+		EGL_CONTEXT_CLIENT_VERSION, 2,
+		EGL_NONE
+	};
+	PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display;
+	const char *extensions;
+	EGLConfig config;
+	EGLint n;
+
+	extensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+	if (!extensions ||
+	    !check_extension(extensions, "EGL_MESA_platform_surfaceless"))
+		return false;
+
+	get_platform_display = (void *)
+		eglGetProcAddress("eglGetPlatformDisplayEXT");
+	if (!get_platform_display)
+		return false;
+
+	egl->display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA,
+					    EGL_DEFAULT_DISPLAY, NULL);
+	if (egl->display == EGL_NO_DISPLAY)
+		return false;
+
+	if (!eglInitialize(egl->display, NULL, NULL))
+		return false;
+
+	extensions = eglQueryString(egl->display, EGL_EXTENSIONS);
+	if (!check_extension(extensions, "EGL_EXT_image_dma_buf_import") ||
+	    !check_extension(extensions, "EGL_KHR_surfaceless_context"))
+		goto err;
+
+	if (!eglBindAPI(EGL_OPENGL_ES_API) ||
+	    !eglChooseConfig(egl->display, config_attribs, &config, 1, &n) ||
+	    n < 1)
+		goto err;
+
+	egl->context = eglCreateContext(egl->display, config,
+					EGL_NO_CONTEXT, context_attribs);
+	if (egl->context == EGL_NO_CONTEXT)
+		goto err;
+
+	if (!eglMakeCurrent(egl->display, EGL_NO_SURFACE, EGL_NO_SURFACE,
+			    egl->context))
+		goto err;
+
+	extensions = (const char *) glGetString(GL_EXTENSIONS);
+	if (!extensions || !check_extension(extensions, "GL_OES_EGL_image"))
+		goto err;
+
+	egl->create_image = (void *) eglGetProcAddress("eglCreateImageKHR");
+	egl->destroy_image = (void *) eglGetProcAddress("eglDestroyImageKHR");
+	egl->image_target_texture_2d =
+		(void *) eglGetProcAddress("glEGLImageTargetTexture2DOES");
+
+	return true;
+
+err:
+	eglTerminate(egl->display);
+	return false;
+}
+
+static void
+egl_fini(struct egl *egl)
+{
+	eglMakeCurrent(egl->display, EGL_NO_SURFACE, EGL_NO_SURFACE,
+		       EGL_NO_CONTEXT);
+	eglDestroyContext(egl->display, egl->context);
+	eglTerminate(egl->display);
+	eglReleaseThread();
+}
+
+static GLuint
+compile_shader(GLenum type, const char *source)
+{
+	GLuint shader;
+	GLint status;
+
+	shader = glCreateShader(type);
+	glShaderSource(shader, 1, &source, NULL);
+	glCompileShader(shader);
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+
+	return status ? shader : 0;
+}
+
+/* Draws the texture 1:1 into an RGBA framebuffer and reads it back, the
+ * way gl-renderer samples client buffers.
+ */
+static bool
+draw_texture(GLuint texture, uint8_t *rgba)
+{
+	static const char vertex_source[] =
+		"attribute vec2 position;\n"
+		"varying vec2 texcoord;\n"
+		"void main()\n"
+		"{\n"
+		"   gl_Position = vec4(position, 0.0, 1.0);\n"
+		"   texcoord = (position + 1.0) * 0.5;\n"
+		"}\n";
+	static const char fragment_source[] =
+		"precision mediump float;\n"
+		"varying vec2 texcoord;\n"
+		"uniform sampler2D tex;\n"
+		"void main()\n"
+		"{\n"
+		"   gl_FragColor = texture2D(tex, texcoord);\n"
+		"}\n";
+	static const GLfloat quad[] = {
+		-1.0f, -1.0f,   1.0f, -1.0f,
+		-1.0f,  1.0f,   1.0f,  1.0f
+	};
+	GLuint vertex, fragment, program, target, fbo;
+	GLint status;
+	bool ret = false;
+
+	vertex = compile_shader(GL_VERTEX_SHADER, vertex_source);
+	fragment = compile_shader(GL_FRAGMENT_SHADER, fragment_source);
+	if (!vertex || !fragment)
+		return false;
+
+	program = glCreateProgram();
+	glAttachShader(program, vertex);
+	glAttachShader(program, fragment);
+	glBindAttribLocation(program, 0, "position");
+	glLinkProgram(program);
+	glGetProgramiv(program, GL_LINK_STATUS, &status);
+	if (!status)
+		goto out_program;
+
+	glGenTextures(1, &target);
+	glBindTexture(GL_TEXTURE_2D, target);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, WIDTH, HEIGHT, 0,
+		     GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+
+	glGenFramebuffers(1, &fbo);
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+			       GL_TEXTURE_2D, target, 0);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) !=
+	    GL_FRAMEBUFFER_COMPLETE)
+		goto out_fbo;
+
+	glViewport(0, 0, WIDTH, HEIGHT);
+	glUseProgram(program);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glUniform1i(glGetUniformLocation(program, "tex"), 0);
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, quad);
+	glEnableVertexAttribArray(0);
+	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+	glDisableVertexAttribArray(0);
+
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, WIDTH, HEIGHT, GL_RGBA, GL_UNSIGNED_BYTE, rgba);
+	ret = glGetError() == GL_NO_ERROR;
+
+out_fbo:
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glDeleteFramebuffers(1, &fbo);
+	glDeleteTextures(1, &target);
+out_program:
+	glDeleteProgram(program);
+	glDeleteShader(vertex);
+	glDeleteShader(fragment);
+
+	return ret;
+}
+
+ZUC_TEST(udmabuf_test, gl_import_matches_shm)
+{
+	struct udmabuf buf;
+	struct egl egl;
+	EGLImageKHR image;
+	EGLint attribs[] = {
+		EGL_WIDTH, WIDTH,
+		EGL_HEIGHT, HEIGHT,
+		EGL_LINUX_DRM_FOURCC_EXT, DRM_FORMAT_XRGB8888,
+		EGL_DMA_BUF_PLANE0_FD_EXT, -1,
+		EGL_DMA_BUF_PLANE0_OFFSET_EXT, 0,
+		EGL_DMA_BUF_PLANE0_PITCH_EXT, STRIDE,
+		EGL_NONE
+	};
+	uint8_t *rgba;
+	GLuint texture;
+	bool drawn;
+	int x, y, mismatches = 0;
+
+	if (udmabuf_missing())
+		ZUC_SKIP("/dev/udmabuf is not available");
+
+	if (udmabuf_create(&buf) < 0 && errno == ENOSYS)
+		ZUC_SKIP("built without udmabuf support");
+	ZUC_ASSERT_TRUE(buf.dmabuf >= 0);
+
+	if (!egl_init(&egl)) {
+		udmabuf_release(&buf);
+		ZUC_SKIP("no surfaceless EGL with dma-buf import");
+	}
+
+	/* The same attributes gl-renderer passes for a single plane
+	 * XRGB8888 buffer from zwp_linux_dmabuf_v1. */
+	attribs[7] = buf.dmabuf;
+	image = egl.create_image(egl.display, EGL_NO_CONTEXT,
+				 EGL_LINUX_DMA_BUF_EXT, NULL, attribs);
+	ZUC_ASSERT_TRUE(image != EGL_NO_IMAGE_KHR);
+
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	egl.image_target_texture_2d(GL_TEXTURE_2D, image);
+
+	rgba = malloc(WIDTH * HEIGHT * 4);
+	ZUC_ASSERT_NOT_NULL(rgba);
+	drawn = draw_texture(texture, rgba);
+
+	glDeleteTextures(1, &texture);
+	egl.destroy_image(egl.display, image);
+	egl_fini(&egl);
+	udmabuf_release(&buf);
+
+	/* Row 0 of the read back is row 0 of the buffer, as texture
+	 * coordinate 0 maps to the first line of memory. */
+	for (y = 0; y < HEIGHT; y++) {
+		for (x = 0; x < WIDTH; x++) {
+			uint32_t expected = pattern_pixel(x, y);
+			const uint8_t *p = &rgba[(y * WIDTH + x) * 4];
+
+			if (p[0] != ((expected >> 16) & 0xff) ||
+			    p[1] != ((expected >> 8) & 0xff) ||
+			    p[2] != (expected & 0xff) ||
+			    p[3] != 0xff)
+				mismatches++;
+		}
+	}
+
+	free(rgba);
+
+	ZUC_ASSERT_TRUE(drawn);
+	ZUC_ASSERT_EQ(0, mismatches);
+}
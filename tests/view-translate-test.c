@@ -0,0 +1,185 @@
+/*
+ * Copyright © 2026 The Weston Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <assert.h>
+#include <time.h>
+
+#include "src/compositor.h"
+#include "shared/helpers.h"
+#include "shared/timespec-util.h"
+#include "benchmark.h"
+
+#define NUM_VIEWS 200
+#define NUM_FRAMES 60
+#define SLIDE_HEIGHT 1080
+
+/* Slides two workspaces worth of views the way desktop-shell animates a
+ * workspace switch and checks the resulting geometry. As a benchmark,
+ * also reports the cost of one animation frame, for whole pixel and for
+ * fractional offsets. */
+struct view_translate_test {
+	struct weston_compositor *compositor;
+	struct weston_view *views[NUM_VIEWS];
+	struct weston_transform transforms[NUM_VIEWS];
+};
+
+static void
+slide_frame(struct view_translate_test *test, double d)
+{
+	struct weston_transform *transform;
+	int i;
+
+	for (i = 0; i < NUM_VIEWS; i++) {
+		transform = &test->transforms[i];
+		weston_matrix_init(&transform->matrix);
+		weston_matrix_translate(&transform->matrix, 0.0,
+					i % 2 ? d - SLIDE_HEIGHT : d, 0.0);
+		weston_view_geometry_dirty(test->views[i]);
+	}
+
+	for (i = 0; i < NUM_VIEWS; i++)
+		weston_view_update_transform(test->views[i]);
+}
+
+static double
+slide_run(struct view_translate_test *test, double step)
+{
+	struct timespec t0, t1;
+	int frame;
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (frame = 0; frame < NUM_FRAMES; frame++)
+		slide_frame(test, frame * step);
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+
+	return (double) timespec_sub_to_nsec(&t1, &t0) / NUM_FRAMES;
+}
+
+/* Does not assert, so that a failure still leaves the views to be torn
+ * down and the transforms unlinked before the compositor exits. */
+static bool
+check_view(struct weston_view *view, int x, int y)
+{
+	pixman_box32_t *bbox, *opaque;
+	float gx, gy;
+
+	if (!view->transform.enabled) {
+		weston_log("view expected at %d,%d is not transformed\n",
+			   x, y);
+		return false;
+	}
+
+	bbox = pixman_region32_extents(&view->transform.boundingbox);
+	opaque = pixman_region32_extents(&view->transform.opaque);
+	weston_view_to_global_float(view, 10, 20, &gx, &gy);
+
+	if (bbox->x1 != x || bbox->y1 != y ||
+	    bbox->x2 != x + view->surface->width ||
+	    bbox->y2 != y + view->surface->height ||
+	    opaque->x1 != x || opaque->y1 != y ||
+	    gx != x + 10 || gy != y + 20) {
+		weston_log("view expected at %d,%d: bounding box %d,%d-%d,%d, "
+			   "opaque from %d,%d, 10,20 maps to %f,%f\n", x, y,
+			   bbox->x1, bbox->y1, bbox->x2, bbox->y2,
+			   opaque->x1, opaque->y1, gx, gy);
+		return false;
+	}
+
+	return true;
+}
+
+static void
+view_translate_run(void *data)
+{
+	struct weston_compositor *compositor = data;
+	struct view_translate_test *test;
+	struct weston_surface *surface;
+	struct weston_view *view;
+	double whole_ns, fraction_ns;
+	bool ok = true;
+	int i;
+
+	test = zalloc(sizeof *test);
+	assert(test);
+	test->compositor = compositor;
+
+	for (i = 0; i < NUM_VIEWS; i++) {
+		surface = weston_surface_create(compositor);
+		assert(surface);
+		view = weston_view_create(surface);
+		assert(view);
+
+		surface->width = 400;
+		surface->height = 300;
+		pixman_region32_union_rect(&surface->opaque, &surface->opaque,
+					   0, 0, 400, 300);
+		weston_view_set_position(view, (i * 7) % 1500, (i * 13) % 700);
+
+		wl_list_insert(view->geometry.transformation_list.prev,
+			       &test->transforms[i].link);
+		test->views[i] = view;
+	}
+
+	slide_frame(test, 100);
+	for (i = 0; i < NUM_VIEWS; i++)
+		ok = check_view(test->views[i], (i * 7) % 1500,
+				(i * 13) % 700 +
+				(i % 2 ? 100 - SLIDE_HEIGHT : 100)) && ok;
+
+	if (benchmark_enabled()) {
+		whole_ns = slide_run(test, 18.0);
+		fraction_ns = slide_run(test, 18.3);
+
+		fprintf(stderr, "%d views: slide frame %.1f us with whole "
+			"pixel offsets, %.1f us with fractional offsets\n",
+			NUM_VIEWS, whole_ns / 1000, fraction_ns / 1000);
+	}
+
+	for (i = 0; i < NUM_VIEWS; i++) {
+		wl_list_remove(&test->transforms[i].link);
+		weston_surface_destroy(test->views[i]->surface);
+	}
+	free(test);
+
+	weston_compositor_exit_with_code(compositor,
+					 ok ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+WL_EXPORT int
+module_init(struct weston_compositor *compositor, int *argc, char *argv[])
+{
+	struct wl_event_loop *loop;
+
+	loop = wl_display_get_event_loop(compositor->wl_display);
+
+	wl_event_loop_add_idle(loop, view_translate_run, compositor);
+
+	return 0;
+}
@@ -125,6 +125,18 @@ get_n_egl_buffers(struct client *client)
 	return client->test->n_egl_buffers;
 }
 
+/* Map a point of the client surface to buffer coordinates, see the
+ * buffer_position event for what ends up in client->test. */
+void
+get_buffer_position(struct client *client, double x, double y)
+{
+	weston_test_get_buffer_position(client->test->weston_test,
+					client->surface->wl_surface,
+					wl_fixed_from_double(x),
+					wl_fixed_from_double(y));
+	wl_display_roundtrip(client->wl_display);
+}
+
 static void
 pointer_handle_enter(void *data, struct wl_pointer *wl_pointer,
 		     uint32_t serial, struct wl_surface *wl_surface,
@@ -489,10 +501,26 @@ test_handle_capture_screenshot_done(void *data, struct weston_test *weston_test)
 	test->buffer_copy_done = 1;
 }
 
+static void
+test_handle_buffer_position(void *data, struct weston_test *weston_test,
+			    wl_fixed_t x, wl_fixed_t y,
+			    wl_fixed_t matrix_x, wl_fixed_t matrix_y,
+			    uint32_t matrix_serial)
+{
+	struct test *test = data;
+
+	test->buffer_x = wl_fixed_to_double(x);
+	test->buffer_y = wl_fixed_to_double(y);
+	test->buffer_matrix_x = wl_fixed_to_double(matrix_x);
+	test->buffer_matrix_y = wl_fixed_to_double(matrix_y);
+	test->buffer_matrix_serial = matrix_serial;
+}
+
 static const struct weston_test_listener test_listener = {
 	test_handle_pointer_position,
 	test_handle_n_egl_buffers,
 	test_handle_capture_screenshot_done,
+	test_handle_buffer_position,
 };
 
 static void
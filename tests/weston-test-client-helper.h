@@ -69,6 +69,11 @@ struct test {
 	int pointer_y;
 	uint32_t n_egl_buffers;
 	int buffer_copy_done;
+	double buffer_x;
+	double buffer_y;
+	double buffer_matrix_x;
+	double buffer_matrix_y;
+	uint32_t buffer_matrix_serial;
 };
 
 struct input {
@@ -175,6 +180,9 @@ frame_callback_wait_nofail(struct client *client, int *done);
 int
 get_n_egl_buffers(struct client *client);
 
+void
+get_buffer_position(struct client *client, double x, double y);
+
 void
 skip(const char *fmt, ...);
 
@@ -523,6 +523,29 @@ capture_screenshot(struct wl_client *client,
 				     capture_screenshot_done, resource);
 }
 
+static void
+get_buffer_position(struct wl_client *client, struct wl_resource *resource,
+		    struct wl_resource *surface_resource,
+		    wl_fixed_t x, wl_fixed_t y)
+{
+	struct weston_surface *surface =
+		wl_resource_get_user_data(surface_resource);
+	struct weston_vector v = {
+		{ wl_fixed_to_double(x), wl_fixed_to_double(y), 0.0f, 1.0f }
+	};
+	float bx, by;
+
+	weston_surface_to_buffer_float(surface, v.f[0], v.f[1], &bx, &by);
+	weston_matrix_transform(&surface->surface_to_buffer_matrix, &v);
+
+	weston_test_send_buffer_position(resource,
+					 wl_fixed_from_double(bx),
+					 wl_fixed_from_double(by),
+					 wl_fixed_from_double(v.f[0] / v.f[3]),
+					 wl_fixed_from_double(v.f[1] / v.f[3]),
+					 surface->buffer_matrix_serial);
+}
+
 static const struct weston_test_interface test_implementation = {
 	move_surface,
 	move_pointer,
@@ -533,6 +556,7 @@ static const struct weston_test_interface test_implementation = {
 	device_add,
 	get_n_buffers,
 	capture_screenshot,
+	get_buffer_position,
 };
 
 static void
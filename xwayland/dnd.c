@@ -40,7 +40,7 @@
 
 #include "cairo-util.h"
 #include "compositor.h"
-#include "hash.h"
+#include "shared/hash.h"
 
 static void
 weston_dnd_start(struct weston_wm *wm, xcb_window_t owner)
@@ -273,7 +273,11 @@ weston_wm_handle_selection_notify(struct weston_wm *wm,
 	}
 }
 
-static const size_t incr_chunk_size = 64 * 1024;
+/* Bounds of the size of the property chunks used to send the data of
+ * a Wayland selection to an X client. Anything larger than a chunk is
+ * sent with the INCR protocol, one chunk per round trip. */
+#define SELECTION_MIN_CHUNK_SIZE (64 * 1024)
+#define SELECTION_MAX_CHUNK_SIZE (4 * 1024 * 1024)
 
 static void
 weston_wm_send_selection_notify(struct weston_wm *wm, xcb_atom_t property)
@@ -359,11 +363,15 @@ weston_wm_read_data_source(int fd, uint32_t mask, void *data)
 	void *p;
 
 	current = wm->source_data.size;
-	if (wm->source_data.size < incr_chunk_size)
-		p = wl_array_add(&wm->source_data, incr_chunk_size);
-	else
+	if (wm->source_data.size < wm->selection_chunk_size) {
+		/* Never read more than a chunk, which is as much as a
+		 * single property change can carry. */
+		p = wl_array_add(&wm->source_data, wm->selection_chunk_size);
+		available = wm->selection_chunk_size - current;
+	} else {
 		p = (char *) wm->source_data.data + wm->source_data.size;
-	available = wm->source_data.alloc - current;
+		available = wm->source_data.alloc - current;
+	}
 
 	len = read(fd, p, available);
 	if (len == -1) {
@@ -373,13 +381,14 @@ weston_wm_read_data_source(int fd, uint32_t mask, void *data)
 		wm->property_source = NULL;
 		close(fd);
 		wl_array_release(&wm->source_data);
+		return 1;
 	}
 
-	weston_log("read %d (available %d, mask 0x%x) bytes: \"%.*s\"\n",
-		len, available, mask, len, (char *) p);
+	weston_log("read %d (available %d, mask 0x%x) bytes\n",
+		len, available, mask);
 
 	wm->source_data.size = current + len;
-	if (wm->source_data.size >= incr_chunk_size) {
+	if (wm->source_data.size >= wm->selection_chunk_size) {
 		if (!wm->incr) {
 			weston_log("got %zu bytes, starting incr\n",
 				wm->source_data.size);
@@ -390,7 +399,7 @@ weston_wm_read_data_source(int fd, uint32_t mask, void *data)
 					    wm->selection_request.property,
 					    wm->atom.incr,
 					    32, /* format */
-					    1, &incr_chunk_size);
+					    1, &wm->selection_chunk_size);
 			wm->selection_property_set = 1;
 			wm->flush_property_on_delete = 1;
 			wl_event_source_remove(wm->property_source);
@@ -679,9 +688,20 @@ weston_wm_selection_init(struct weston_wm *wm)
 {
 	struct weston_seat *seat;
 	uint32_t values[1], mask;
+	uint32_t max_request;
 
 	wm->selection_request.requestor = XCB_NONE;
 
+	/* Use chunks as large as a ChangeProperty request can carry, in
+	 * units of 4 bytes and leaving room for the request header, so
+	 * that large transfers need few INCR round trips. */
+	max_request = xcb_get_maximum_request_length(wm->conn);
+	if (max_request > SELECTION_MAX_CHUNK_SIZE / 4)
+		max_request = SELECTION_MAX_CHUNK_SIZE / 4;
+	wm->selection_chunk_size = (max_request - 16) * 4;
+	if (wm->selection_chunk_size < SELECTION_MIN_CHUNK_SIZE)
+		wm->selection_chunk_size = SELECTION_MIN_CHUNK_SIZE;
+
 	values[0] = XCB_EVENT_MASK_PROPERTY_CHANGE;
 	wm->selection_window = xcb_generate_id(wm->conn);
 	xcb_create_window(wm->conn,
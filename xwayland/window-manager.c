@@ -41,7 +41,7 @@
 
 #include "cairo-util.h"
 #include "compositor.h"
-#include "hash.h"
+#include "shared/hash.h"
 #include "shared/helpers.h"
 
 struct wm_size_hints {
@@ -123,6 +123,24 @@ struct motif_wm_hints {
 #define _NET_WM_MOVERESIZE_MOVE_KEYBOARD    10   /* move via keyboard */
 #define _NET_WM_MOVERESIZE_CANCEL           11   /* cancel operation */
 
+/* The window properties tracked by the window manager */
+enum window_property_index {
+	WINDOW_PROP_CLASS,
+	WINDOW_PROP_NAME,
+	WINDOW_PROP_TRANSIENT_FOR,
+	WINDOW_PROP_PROTOCOLS,
+	WINDOW_PROP_NORMAL_HINTS,
+	WINDOW_PROP_NET_STATE,
+	WINDOW_PROP_NET_WINDOW_TYPE,
+	WINDOW_PROP_NET_NAME,
+	WINDOW_PROP_NET_PID,
+	WINDOW_PROP_MOTIF_HINTS,
+	WINDOW_PROP_CLIENT_MACHINE,
+	WINDOW_PROP_COUNT
+};
+
+#define WINDOW_PROP_ALL ((1 << WINDOW_PROP_COUNT) - 1)
+
 struct weston_wm_window {
 	struct weston_wm *wm;
 	xcb_window_t id;
@@ -135,7 +153,9 @@ struct weston_wm_window {
 	struct wl_listener surface_destroy_listener;
 	struct wl_event_source *repaint_source;
 	struct wl_event_source *configure_source;
-	int properties_dirty;
+	uint32_t properties_dirty;	/* properties to request */
+	uint32_t properties_pending;	/* requested, reply not read */
+	xcb_get_property_cookie_t property_cookie[WINDOW_PROP_COUNT];
 	int pid;
 	char *machine;
 	char *class;
@@ -368,6 +388,7 @@ dump_property(struct weston_wm *wm,
 	}
 }
 
+#ifdef WM_DEBUG
 static void
 read_and_dump_property(struct weston_wm *wm,
 		       xcb_window_t window, xcb_atom_t property)
@@ -383,6 +404,7 @@ read_and_dump_property(struct weston_wm *wm,
 
 	free(reply);
 }
+#endif
 
 /* We reuse some predefined, but otherwise useles atoms */
 #define TYPE_WM_PROTOCOLS	XCB_ATOM_CUT_BUFFER0
@@ -390,59 +412,176 @@ read_and_dump_property(struct weston_wm *wm,
 #define TYPE_NET_WM_STATE	XCB_ATOM_CUT_BUFFER2
 #define TYPE_WM_NORMAL_HINTS	XCB_ATOM_CUT_BUFFER3
 
+struct window_property {
+	xcb_atom_t atom;
+	xcb_atom_t type;
+	int offset;
+};
+
 static void
-weston_wm_window_read_properties(struct weston_wm_window *window)
+weston_wm_get_window_properties(struct weston_wm *wm,
+				struct window_property *props)
 {
-	struct weston_wm *wm = window->wm;
-	struct weston_shell_interface *shell_interface =
-		&wm->server->compositor->shell_interface;
-
 #define F(field) offsetof(struct weston_wm_window, field)
-	const struct {
-		xcb_atom_t atom;
-		xcb_atom_t type;
-		int offset;
-	} props[] = {
-		{ XCB_ATOM_WM_CLASS, XCB_ATOM_STRING, F(class) },
-		{ XCB_ATOM_WM_NAME, XCB_ATOM_STRING, F(name) },
-		{ XCB_ATOM_WM_TRANSIENT_FOR, XCB_ATOM_WINDOW, F(transient_for) },
-		{ wm->atom.wm_protocols, TYPE_WM_PROTOCOLS, F(protocols) },
-		{ wm->atom.wm_normal_hints, TYPE_WM_NORMAL_HINTS, F(protocols) },
-		{ wm->atom.net_wm_state, TYPE_NET_WM_STATE },
-		{ wm->atom.net_wm_window_type, XCB_ATOM_ATOM, F(type) },
-		{ wm->atom.net_wm_name, XCB_ATOM_STRING, F(name) },
-		{ wm->atom.net_wm_pid, XCB_ATOM_CARDINAL, F(pid) },
-		{ wm->atom.motif_wm_hints, TYPE_MOTIF_WM_HINTS, 0 },
-		{ wm->atom.wm_client_machine, XCB_ATOM_WM_CLIENT_MACHINE, F(machine) },
+	const struct window_property p[WINDOW_PROP_COUNT] = {
+		[WINDOW_PROP_CLASS] =
+			{ XCB_ATOM_WM_CLASS, XCB_ATOM_STRING, F(class) },
+		[WINDOW_PROP_NAME] =
+			{ XCB_ATOM_WM_NAME, XCB_ATOM_STRING, F(name) },
+		[WINDOW_PROP_TRANSIENT_FOR] =
+			{ XCB_ATOM_WM_TRANSIENT_FOR, XCB_ATOM_WINDOW, F(transient_for) },
+		[WINDOW_PROP_PROTOCOLS] =
+			{ wm->atom.wm_protocols, TYPE_WM_PROTOCOLS, F(protocols) },
+		[WINDOW_PROP_NORMAL_HINTS] =
+			{ wm->atom.wm_normal_hints, TYPE_WM_NORMAL_HINTS, F(protocols) },
+		[WINDOW_PROP_NET_STATE] =
+			{ wm->atom.net_wm_state, TYPE_NET_WM_STATE },
+		[WINDOW_PROP_NET_WINDOW_TYPE] =
+			{ wm->atom.net_wm_window_type, XCB_ATOM_ATOM, F(type) },
+		[WINDOW_PROP_NET_NAME] =
+			{ wm->atom.net_wm_name, XCB_ATOM_STRING, F(name) },
+		[WINDOW_PROP_NET_PID] =
+			{ wm->atom.net_wm_pid, XCB_ATOM_CARDINAL, F(pid) },
+		[WINDOW_PROP_MOTIF_HINTS] =
+			{ wm->atom.motif_wm_hints, TYPE_MOTIF_WM_HINTS, 0 },
+		[WINDOW_PROP_CLIENT_MACHINE] =
+			{ wm->atom.wm_client_machine, XCB_ATOM_WM_CLIENT_MACHINE, F(machine) },
 	};
 #undef F
 
-	xcb_get_property_cookie_t cookie[ARRAY_LENGTH(props)];
+	memcpy(props, p, sizeof p);
+}
+
+/* Properties that have to be re-read together: the EWMH name takes
+ * precedence over the ICCCM one, and the pid is validated against
+ * the client machine. */
+#define WINDOW_PROP_GROUP_NAME \
+	(1 << WINDOW_PROP_NAME | 1 << WINDOW_PROP_NET_NAME)
+#define WINDOW_PROP_GROUP_PID \
+	(1 << WINDOW_PROP_NET_PID | 1 << WINDOW_PROP_CLIENT_MACHINE)
+
+static void
+weston_wm_window_invalidate_property(struct weston_wm_window *window,
+				     xcb_atom_t atom)
+{
+	struct window_property props[WINDOW_PROP_COUNT];
+	uint32_t i;
+
+	weston_wm_get_window_properties(window->wm, props);
+
+	for (i = 0; i < WINDOW_PROP_COUNT; i++) {
+		if (props[i].atom != atom)
+			continue;
+
+		window->properties_dirty |= 1 << i;
+		if (window->properties_dirty & WINDOW_PROP_GROUP_NAME)
+			window->properties_dirty |= WINDOW_PROP_GROUP_NAME;
+		if (window->properties_dirty & WINDOW_PROP_GROUP_PID)
+			window->properties_dirty |= WINDOW_PROP_GROUP_PID;
+	}
+}
+
+/* Sends the GetProperty requests for all dirty properties without
+ * waiting for the replies, so that the requests for many windows are
+ * in flight at the same time. A request already in flight for a
+ * property that changed again is superseded. */
+static void
+weston_wm_window_request_properties(struct weston_wm_window *window)
+{
+	struct weston_wm *wm = window->wm;
+	struct window_property props[WINDOW_PROP_COUNT];
+	uint32_t i;
+
+	if (!window->properties_dirty)
+		return;
+
+	weston_wm_get_window_properties(wm, props);
+
+	for (i = 0; i < WINDOW_PROP_COUNT; i++) {
+		if (!(window->properties_dirty & (1 << i)))
+			continue;
+
+		if (window->properties_pending & (1 << i))
+			xcb_discard_reply(wm->conn,
+					  window->property_cookie[i].sequence);
+
+		window->property_cookie[i] =
+			xcb_get_property(wm->conn,
+					 0, /* delete */
+					 window->id,
+					 props[i].atom,
+					 XCB_ATOM_ANY, 0, 2048);
+	}
+
+	window->properties_pending |= window->properties_dirty;
+	window->properties_dirty = 0;
+}
+
+static void
+weston_wm_window_discard_properties(struct weston_wm_window *window)
+{
+	uint32_t i;
+
+	for (i = 0; i < WINDOW_PROP_COUNT; i++)
+		if (window->properties_pending & (1 << i))
+			xcb_discard_reply(window->wm->conn,
+					  window->property_cookie[i].sequence);
+
+	window->properties_pending = 0;
+}
+
+/* Resets the state derived from a property before its new value, if
+ * any, is applied. */
+static void
+weston_wm_window_reset_property(struct weston_wm_window *window,
+				const struct window_property *prop)
+{
+	switch (prop->type) {
+	case TYPE_WM_PROTOCOLS:
+		window->delete_window = 0;
+		break;
+	case TYPE_WM_NORMAL_HINTS:
+		window->size_hints.flags = 0;
+		break;
+	case TYPE_MOTIF_WM_HINTS:
+		window->decorate =
+			window->override_redirect ? 0 : MWM_DECOR_EVERYTHING;
+		window->motif_hints.flags = 0;
+		break;
+	default:
+		break;
+	}
+}
+
+static void
+weston_wm_window_read_properties(struct weston_wm_window *window)
+{
+	struct weston_wm *wm = window->wm;
+	struct weston_shell_interface *shell_interface =
+		&wm->server->compositor->shell_interface;
+	struct window_property props[WINDOW_PROP_COUNT];
 	xcb_get_property_reply_t *reply;
 	void *p;
 	uint32_t *xid;
 	xcb_atom_t *atom;
-	uint32_t i;
+	uint32_t i, j;
 	char name[1024];
 
-	if (!window->properties_dirty)
+	weston_wm_window_request_properties(window);
+	if (!window->properties_pending)
 		return;
-	window->properties_dirty = 0;
 
-	for (i = 0; i < ARRAY_LENGTH(props); i++)
-		cookie[i] = xcb_get_property(wm->conn,
-					     0, /* delete */
-					     window->id,
-					     props[i].atom,
-					     XCB_ATOM_ANY, 0, 2048);
+	weston_wm_get_window_properties(wm, props);
 
-	window->decorate = window->override_redirect ? 0 : MWM_DECOR_EVERYTHING;
-	window->size_hints.flags = 0;
-	window->motif_hints.flags = 0;
-	window->delete_window = 0;
+	for (i = 0; i < WINDOW_PROP_COUNT; i++)  {
+		if (!(window->properties_pending & (1 << i)))
+			continue;
 
-	for (i = 0; i < ARRAY_LENGTH(props); i++)  {
-		reply = xcb_get_property_reply(wm->conn, cookie[i], NULL);
+		weston_wm_window_reset_property(window, &props[i]);
+
+		reply = xcb_get_property_reply(wm->conn,
+					       window->property_cookie[i],
+					       NULL);
 		if (!reply)
 			/* Bad window, typically */
 			continue;
@@ -479,8 +618,8 @@ weston_wm_window_read_properties(struct weston_wm_window *window)
 			break;
 		case TYPE_WM_PROTOCOLS:
 			atom = xcb_get_property_value(reply);
-			for (i = 0; i < reply->value_len; i++)
-				if (atom[i] == wm->atom.wm_delete_window) {
+			for (j = 0; j < reply->value_len; j++)
+				if (atom[j] == wm->atom.wm_delete_window) {
 					window->delete_window = 1;
 					break;
 				}
@@ -493,12 +632,12 @@ weston_wm_window_read_properties(struct weston_wm_window *window)
 		case TYPE_NET_WM_STATE:
 			window->fullscreen = 0;
 			atom = xcb_get_property_value(reply);
-			for (i = 0; i < reply->value_len; i++) {
-				if (atom[i] == wm->atom.net_wm_state_fullscreen)
+			for (j = 0; j < reply->value_len; j++) {
+				if (atom[j] == wm->atom.net_wm_state_fullscreen)
 					window->fullscreen = 1;
-				if (atom[i] == wm->atom.net_wm_state_maximized_vert)
+				if (atom[j] == wm->atom.net_wm_state_maximized_vert)
 					window->maximized_vert = 1;
-				if (atom[i] == wm->atom.net_wm_state_maximized_horz)
+				if (atom[j] == wm->atom.net_wm_state_maximized_horz)
 					window->maximized_horz = 1;
 			}
 			break;
@@ -522,6 +661,8 @@ weston_wm_window_read_properties(struct weston_wm_window *window)
 		free(reply);
 	}
 
+	window->properties_pending = 0;
+
 	if (window->pid > 0) {
 		gethostname(name, sizeof(name));
 		for (i = 0; i < sizeof(name); i++) {
@@ -1151,14 +1292,17 @@ weston_wm_handle_property_notify(struct weston_wm *wm, xcb_generic_event_t *even
 	if (!wm_lookup_window(wm, property_notify->window, &window))
 		return;
 
-	window->properties_dirty = 1;
+	weston_wm_window_invalidate_property(window, property_notify->atom);
+	weston_wm_window_request_properties(window);
 
+#ifdef WM_DEBUG
 	wm_log("XCB_PROPERTY_NOTIFY: window %d, ", property_notify->window);
 	if (property_notify->state == XCB_PROPERTY_DELETE)
 		wm_log("deleted\n");
 	else
 		read_and_dump_property(wm, property_notify->window,
 				       property_notify->atom);
+#endif
 
 	if (property_notify->atom == wm->atom.net_wm_name ||
 	    property_notify->atom == XCB_ATOM_WM_NAME)
@@ -1188,7 +1332,7 @@ weston_wm_window_create(struct weston_wm *wm,
 
 	window->wm = wm;
 	window->id = id;
-	window->properties_dirty = 1;
+	window->properties_dirty = WINDOW_PROP_ALL;
 	window->override_redirect = override;
 	window->width = width;
 	window->height = height;
@@ -1204,6 +1348,8 @@ weston_wm_window_create(struct weston_wm *wm,
 	free(geometry_reply);
 
 	hash_table_insert(wm->window_hash, id, window);
+
+	weston_wm_window_request_properties(window);
 }
 
 static void
@@ -1216,6 +1362,8 @@ weston_wm_window_destroy(struct weston_wm_window *window)
 	if (window->cairo_surface)
 		cairo_surface_destroy(window->cairo_surface);
 
+	weston_wm_window_discard_properties(window);
+
 	if (window->frame_id) {
 		xcb_reparent_window(wm->conn, window->id, wm->wm_window, 0, 0);
 		xcb_destroy_window(wm->conn, window->frame_id);
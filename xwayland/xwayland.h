@@ -86,6 +86,7 @@ struct weston_wm {
 	xcb_timestamp_t selection_timestamp;
 	int selection_property_set;
 	int flush_property_on_delete;
+	uint32_t selection_chunk_size;
 	struct wl_listener selection_listener;
 
 	xcb_window_t dnd_window;